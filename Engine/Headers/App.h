@@ -2,6 +2,9 @@
 
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
 #include "Maths.h"
 #include "TimeManager.h"
 #include "PostProcessor.h"
@@ -26,6 +29,8 @@ namespace Core
         const char* windowName;
         bool maximized = false, vsync = false;
         int fps = 60;
+        bool uploadThread = true; // Upload resources to OpenGL from a thread with a shared context.
+        bool hotReload    = true; // Reload the shaders, textures and obj files that are modified while the app runs.
     };
 
     struct AppInputs
@@ -58,20 +63,49 @@ namespace Core
         bool inPlayMode        = false;
         bool playModePaused    = false;
 
+        // Thread creating the resources to load.
+        std::thread loaderThread;
+        void StopLoading();
+
         // Variables for chrono async and and synchronous loading.
         std::chrono::steady_clock::time_point begin;
         std::chrono::steady_clock::time_point end;
         bool chronoHasEnded = false;
 
-        // Benchmark resources.
+        // Time to first useful frame: until the models in view are all in OpenGL.
+        std::chrono::steady_clock::time_point loadingBegin;
+        bool      firstUsefulFrameReached = true;
+        long long firstUsefulFrameTotalNs = 0;
+        void UpdateLoadPriorities();
+
+        // Benchmark resources, the first load is cold (without mesh cache) and the next ones are warm.
         void LoadBenchmark();
         int  cptLoad            = 0;
         bool chronoStarted      = false;
+        std::chrono::steady_clock::time_point coldLoadEnd;
+
+        // Rendering benchmark: GPU time of the scene's draws with the sub-meshes' triangles in the obj files' order, then optimized.
+        // The draws are timed by queries used in turn, whose results are read once available so the GPU is never waited for.
+        static constexpr int DrawTimeQueryCount = 3;
+        void RenderBenchmark();
+        int          renderBenchmarkPass = -1; // -1 when not benchmarking, 0 without index optimization, 1 with it.
+        unsigned int drawTimeQueries    [DrawTimeQueryCount] = {};
+        int          drawTimeQueryPasses[DrawTimeQueryCount] = { -1, -1, -1 }; // Pass timed by each query, -1 once its result was read.
+        int          drawTimeQueryIndex  = 0;
+        int          drawTimeFrames[2]   = { 0, 0 };
+        uint64_t     drawTimeTotalNs[2]  = { 0, 0 };
+        bool         indexOptimizationSetting = true;
+        bool         shouldReloadAll          = false;
+
+        // Thread running the benchmark started from the stats window, joined before the resources are destroyed.
+        std::thread      benchmarkThread;
+        std::atomic_bool benchmarkRunning = false;
 
     public:
         int  maxLoad           = 10;
         bool shouldReloadScene = false;
         bool isInBenchmark     = false;
+        int  renderBenchmarkFrameCount = 300;
 
         AppStates                  state = AppStates::StartMenu;
         AppInputs                  inputs;
@@ -118,9 +152,16 @@ namespace Core
         void LoadDefaultResources();
         void LoadResources();
         void SendLoadedResources();
+        std::vector<Resources::ResourceHandle<Resources::IResource>> resourcesToSend; // Loaded resources that couldn't be sent to OpenGL yet.
         bool UnloadResources();
         void LoadExampleScene();
         void Benchmark();
+        void StartRenderBenchmark();
+        bool IsInRenderBenchmark() const { return renderBenchmarkPass >= 0; }
+
+        // Runs a benchmark on its own thread to keep rendering, returns false if one is already running.
+        bool StartBenchmarkTask(const std::function<void()>& benchmark);
+        bool IsBenchmarkTaskRunning() const { return benchmarkRunning.load(); }
         void UnloadScene();
         bool ReloadAll();
 
@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include "MappedFile.h"
+
+namespace Core
+{
+    // Identifies the processed data of a source file: its path, size and modification time, and the importer (with its version and settings) that processed it.
+    // Editing the source file or changing the importer gives another key, so stale data is never read and is eventually collected.
+    struct AssetCacheKey
+    {
+        std::string source;
+        std::string importer;
+        uint32_t    importerVersion = 0;
+        uint64_t    settings        = 0; // Import settings the processed data depends on.
+        uint64_t    sourceSize      = 0;
+        int64_t     sourceTime      = 0;
+        bool        valid           = false; // False if the source file can't be found, nothing is then cached.
+
+        AssetCacheKey(const std::string& _source, const std::string& _importer, const uint32_t& _importerVersion, const uint64_t& _settings = 0);
+
+        // Stable hash of the whole key, which names the entry's file.
+        uint64_t GetHash() const;
+    };
+
+    // Processed data of an asset, read in place from its mapped cache file.
+    class CachedAsset
+    {
+    private:
+        MappedFile  file;
+        const char* data = nullptr;
+        size_t      size = 0;
+
+    public:
+        // Maps the entry of the given key, returns false if it isn't cached (or not written yet).
+        bool Open(const AssetCacheKey& key);
+        void Close();
+
+        const char* GetData() const { return data; }
+        size_t      GetSize() const { return size; }
+    };
+
+    // Content-addressed cache of the processed assets of all importers, stored in Binaries/.
+    // Entries are written by a background thread and read by mapping their file, and the least recently used ones are removed once the cache is bigger than its size cap.
+    class AssetCache
+    {
+    public:
+        static constexpr const char* Directory       = "Binaries";
+        static constexpr uint64_t    DefaultSizeCap  = (uint64_t)1 << 30;
+        static constexpr size_t      MaxPendingBytes = (size_t)256 << 20; // Writes queued while this many bytes wait to be written are dropped.
+
+    private:
+        struct Entry
+        {
+            std::string importer;
+            uint64_t    bytes   = 0;
+            uint64_t    lastUse = 0; // Value of the use clock when the entry was last written or read.
+        };
+        struct PendingWrite
+        {
+            uint64_t          hash;
+            std::string       importer;
+            std::vector<char> data;
+        };
+
+        static std::mutex                           mutex;
+        static std::condition_variable              writeCondition;
+        static std::condition_variable              idleCondition;
+        static std::unordered_map<uint64_t, Entry>  entries;
+        static std::deque<PendingWrite>             pendingWrites;
+        static size_t                               pendingBytes;
+        static uint64_t                             totalBytes;
+        static uint64_t                             useClock;
+        static std::atomic<uint64_t>                sizeCap;
+        static std::thread                          writer;
+        static bool                                 writing, stopWriter, indexLoaded, indexDirty;
+
+        // The index keeps the importer and last use of each entry between runs, it is loaded on first use (the mutex must be locked).
+        static void LoadIndex();
+        static void SaveIndex();
+        static std::string GetEntryName(const uint64_t& hash);
+
+        static void WriterLife();
+        static bool WriteEntry(const PendingWrite& write);
+        static void CollectGarbage(const uint64_t& keptHash);
+
+        // Called by cached assets when they are opened, to keep them from being collected.
+        static void Touch(const uint64_t& hash);
+        friend class CachedAsset;
+
+    public:
+        // Queues the data to be written as the key's entry by the writer thread, the caller doesn't wait for the disk.
+        static void Write(const AssetCacheKey& key, std::vector<char>&& data);
+
+        // Waits until all queued writes are done.
+        static void Flush();
+
+        // Removes the entries of the given importer, or all of them if it is empty.
+        static void Clear(const std::string& importer = "");
+
+        // Writes the queued entries and the index, then stops the writer thread.
+        static void Shutdown();
+
+        static void     SetSizeCap(const uint64_t& bytes);
+        static uint64_t GetSizeCap()   { return sizeCap.load(); }
+        static uint64_t GetTotalBytes();
+        static size_t   GetEntryCount();
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+struct GLFWwindow;
+
+namespace Resources
+{
+    // Upload submitted to the upload thread, fenced once its commands are sent to the GPU.
+    struct GpuUpload
+    {
+        std::atomic_bool done  = false;
+        void*            fence = nullptr;
+    };
+
+    // Thread with its own OpenGL context shared with the render thread, which creates buffers and textures off the render thread.
+    // The objects it creates can be used by the render thread once their upload is ready (vertex arrays aren't shared and should be created by the render thread).
+    class GpuUploader
+    {
+    private:
+        GLFWwindow* context = nullptr;
+        std::thread thread;
+
+        std::mutex              mutex;
+        std::condition_variable taskCondition;
+        std::condition_variable doneCondition;
+        std::deque<std::pair<std::shared_ptr<GpuUpload>, std::function<void()>>> tasks;
+        std::atomic_bool        stopThread = false;
+
+        void ThreadLife();
+
+    public:
+        // Creates the upload context from the main thread (GLFW requires it), sharing the given window's objects.
+        GpuUploader(GLFWwindow* sharedWindow);
+        ~GpuUploader();
+
+        GpuUploader(const GpuUploader&)            = delete;
+        GpuUploader(GpuUploader&&)                 = delete;
+        GpuUploader& operator=(const GpuUploader&) = delete;
+        GpuUploader& operator=(GpuUploader&&)      = delete;
+
+        // Runs the task on the upload thread with the upload context current.
+        std::shared_ptr<GpuUpload> Submit(const std::function<void()>& task);
+
+        // Returns true once the upload's commands were executed by the GPU (should be called by the render thread).
+        static bool IsReady(const std::shared_ptr<GpuUpload>& upload);
+
+        // Waits until the upload's task was executed (or dropped because the thread stopped), then frees its fence.
+        void Release(std::shared_ptr<GpuUpload>& upload);
+
+        // Stops the thread after its current task, remaining tasks are dropped.
+        void Stop();
+
+        bool IsRunning()          const { return thread.joinable(); }
+        int  GetQueuedTaskCount();
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <unordered_map>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "IResource.h"
+
+namespace Resources
+{
+    class ResourceManager;
+
+    // Watches the files of loaded shaders, textures and obj files, and reloads the ones that are modified.
+    // Modified files are loaded into copies of their resources by the job system, which are swapped with the current resources once they are uploaded.
+    class HotReloader
+    {
+    private:
+        ResourceManager& resourceManager;
+
+        // The watch thread checks the modification time of the watched files regularly.
+        std::thread             thread;
+        std::atomic_bool        stopThread = false;
+        std::mutex              sleepMutex;
+        std::condition_variable sleepCondition;
+
+        // Files are only reported once their modification time stops changing, so they aren't reloaded while they are being written.
+        struct WatchedFile
+        {
+            std::filesystem::file_time_type writeTime;
+            bool                            modified = false;
+        };
+        std::unordered_map<std::string, WatchedFile> watchedFiles;
+        void ThreadLife();
+
+        // Files that were modified since the last frame.
+        std::mutex                                         modifiedMutex;
+        std::vector<std::pair<std::string, ResourceTypes>> modifiedFiles;
+
+        // Copies of the resources being reloaded, with the jobs loading them.
+        struct Reload
+        {
+            IResource*      copy = nullptr;
+            Core::JobHandle job;
+        };
+        std::unordered_map<std::string, Reload> reloads;
+        IResource* CreateCopy(const std::string& name, const ResourceTypes& type);
+        bool       SendCopyToOpenGL(IResource* copy, size_t& totalVertexCount);
+        void       SwapWithCopy(IResource* copy, size_t& totalVertexCount);
+        void       DeleteCopy(IResource* copy);
+
+    public:
+        static constexpr int CheckIntervalMs = 250;
+
+        HotReloader(ResourceManager& _resourceManager);
+        ~HotReloader();
+
+        HotReloader(const HotReloader&)            = delete;
+        HotReloader(HotReloader&&)                 = delete;
+        HotReloader& operator=(const HotReloader&) = delete;
+        HotReloader& operator=(HotReloader&&)      = delete;
+
+        // Starts watching files, and stops watching them and cancels the reloads in progress.
+        void Start();
+        void Stop();
+        bool IsRunning() const { return thread.joinable(); }
+
+        // Starts reloading the modified files and swaps the reloaded resources that are ready (should be called by the render thread every frame).
+        void Update(size_t& totalVertexCount);
+
+        int GetReloadCount() const { return (int)reloads.size(); }
+    };
+}
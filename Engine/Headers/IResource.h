@@ -1,6 +1,10 @@
 #pragma once
 #include <atomic>
 #include <string>
+#include <mutex>
+#include <cstdint>
+#include "JobSystem.h"
+#include "ResourceTracker.h"
 
 namespace Resources
 {
@@ -24,22 +28,91 @@ namespace Resources
     class IResource
     {
     protected:
-        std::atomic_bool loaded       = false;
-        std::atomic_bool sentToOpenGL = false;
-        std::string      name = "";
-        ResourceTypes    type;
+        std::atomic_bool   loaded       = false;
+        std::atomic_bool   sentToOpenGL = false;
+        std::atomic_bool   loadingCancelled = false;
+        std::string        name = "";
+        ResourceTypes      type;
+        Core::JobHandle    loadingJob;
+        mutable std::mutex loadingJobMutex;
+
+        // Slot of the resource in the resource manager, used by handles.
+        const ResourceSlots* slots = nullptr;
+        uint32_t slotIndex      = 0;
+        uint32_t slotGeneration = 0;
+        friend class ResourceSlots;
+
+        // References held by scene models, materials and sub-meshes, only unreferenced resources can be evicted.
+        std::atomic_int               refCount      = 0;
+        mutable std::atomic<uint64_t> lastUsedFrame = 0;
+
+        // Tracker of the resource manager the resource is registered in, notified when its state changes (by the loading threads too).
+        std::atomic<ResourceTracker*> tracker = nullptr;
+        std::atomic<size_t>           trackedBytes = 0; // Memory of the resource counted in its tracker's total.
+        friend class ResourceTracker;
+
+        // Marks the resource as needing to be sent to OpenGL again.
+        void ResetOpenGLTransfer()
+        {
+            ResourceTracker* resourceTracker = tracker.load();
+            if (sentToOpenGL.exchange(false) && resourceTracker != nullptr) {
+                resourceTracker->OnOpenGLTransferReset();
+                resourceTracker->UpdateUsedMemory(this);
+            }
+        }
 
     public:
         virtual ~IResource() {}
-        std::string   GetName() const { return name; }
-        ResourceTypes GetType() const { return type; }
+        std::string          GetName()           const { return name;           }
+        ResourceTypes        GetType()           const { return type;           }
+        const ResourceSlots* GetSlots()          const { return slots;          }
+        uint32_t             GetSlotIndex()      const { return slotIndex;      }
+        uint32_t             GetSlotGeneration() const { return slotGeneration; }
+
+        void     AddRef()                              { refCount.fetch_add(1);  }
+        void     RemoveRef()                           { refCount.fetch_sub(1);  }
+        int      GetRefCount()                   const { return refCount.load(); }
+        void     MarkUsed(const uint64_t& frame) const { lastUsedFrame.store(frame, std::memory_order_relaxed); }
+        uint64_t GetLastUsedFrame()              const { return lastUsedFrame.load(std::memory_order_relaxed);  }
+
+        // Memory used by the resource's data in RAM and in VRAM, in bytes.
+        virtual size_t GetCpuBytes() const { return 0; }
+        virtual size_t GetGpuBytes() const { return 0; }
+
+        // Deletes the resource's OpenGL objects on the render thread, so the rest of it can be deleted by any thread.
+        virtual void DeleteOpenGLObjects() {}
 
         virtual void  Load()         = 0;
         virtual void  SendToOpenGL() = 0;
         // virtual void* CreateCopy()   = 0;
         bool          IsLoaded()        const { return loaded.load();       }
-        void          SetLoadingDone()        { loaded.store(true);         }
         bool          WasSentToOpenGL() const { return sentToOpenGL.load(); }
-        void          SetOpenGLTransferDone() { sentToOpenGL.store(true);   }
+        void SetLoadingDone()
+        {
+            ResourceTracker* resourceTracker = tracker.load();
+            if (!loaded.exchange(true) && resourceTracker != nullptr) {
+                resourceTracker->UpdateUsedMemory(this);
+                resourceTracker->OnLoadingDone(this);
+            }
+        }
+        void SetOpenGLTransferDone()
+        {
+            ResourceTracker* resourceTracker = tracker.load();
+            if (!sentToOpenGL.exchange(true) && resourceTracker != nullptr) {
+                resourceTracker->OnOpenGLTransferDone();
+                resourceTracker->UpdateUsedMemory(this);
+            }
+        }
+
+        // Makes the main thread check the resource again on the next frame (used when parts of it finish loading).
+        void          NotifyStateChanged()    { if (ResourceTracker* resourceTracker = tracker.load()) resourceTracker->PushChanged(this); }
+
+        // Loads check this regularly and stop early when the resource is about to be deleted.
+        bool          IsLoadingCancelled() const { return loadingCancelled.load(); }
+        void          CancelLoading()            { loadingCancelled.store(true);   }
+
+        // Job loading the resource, done once the resource and everything it created are loaded.
+        Core::JobHandle GetLoadingJob() const                    { std::lock_guard<std::mutex> guard(loadingJobMutex); return loadingJob; }
+        void            SetLoadingJob(const Core::JobHandle& job) { std::lock_guard<std::mutex> guard(loadingJobMutex); loadingJob = job;  }
     };
 }
\ No newline at end of file
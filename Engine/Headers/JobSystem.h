@@ -0,0 +1,174 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace Core
+{
+    // Background jobs (resource loads) are only picked up by idle workers, and are never run by threads waiting on other jobs.
+    enum class JobPriority
+    {
+        Normal,
+        Background,
+    };
+
+    class JobSystem;
+
+    // A unit of work that can be executed by any of the job system's workers.
+    struct Job
+    {
+        JobSystem*            system = nullptr;
+        std::function<void()> task;
+        JobPriority           priority = JobPriority::Normal;
+        std::shared_ptr<Job>  parent;
+
+        // Queued background jobs with the highest importance are started first (children inherit their parent's).
+        std::atomic<float> importance = 0;
+
+        // Background jobs spawned by this one, which are given the importance set on it.
+        std::mutex                      childrenMutex;
+        std::vector<std::weak_ptr<Job>> children;
+
+        // The job itself and all of its unfinished children.
+        std::atomic_int unfinishedJobs = 1;
+
+        // Number of jobs that need to finish before this one can be queued.
+        std::atomic_int pendingDependencies = 0;
+
+        // Jobs waiting for this one to finish.
+        std::mutex                        continuationsMutex;
+        std::vector<std::shared_ptr<Job>> continuations;
+        std::atomic_bool                  finished = false;
+
+        // Cancelled jobs are finished without executing their task.
+        std::atomic_bool cancelled = false;
+    };
+
+    // Reference to a scheduled job, used to wait on it or to chain other jobs after it.
+    class JobHandle
+    {
+    private:
+        std::shared_ptr<Job> job;
+
+    public:
+        JobHandle() {}
+        JobHandle(const std::shared_ptr<Job>& _job) : job(_job) {}
+
+        bool IsValid() const { return job != nullptr; }
+        bool IsDone()  const { return job == nullptr || job->finished.load(); }
+        void Wait()    const;
+
+        void SetImportance(const float& importance) const;
+
+        const std::shared_ptr<Job>& GetJob() const { return job; }
+    };
+
+    class JobSystem
+    {
+    private:
+        // Job system used by the engine (the first one to be created).
+        static JobSystem* instance;
+
+        // Each worker owns a deque it pushes to and pops from the back, other workers steal from its front.
+        // The last deque is used for jobs scheduled from threads that aren't workers.
+        struct WorkerQueue
+        {
+            std::mutex                       mutex;
+            std::deque<std::shared_ptr<Job>> jobs;
+        };
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+        std::deque<std::shared_ptr<Job>>          backgroundJobs;
+        std::mutex                                backgroundMutex;
+        std::vector<std::thread>                  threads;
+
+        // Idle workers sleep until jobs are queued.
+        std::atomic_bool        stopThreads = false;
+        std::atomic_int         queuedJobs  = 0;
+        std::atomic_int         queuedBackgroundJobs = 0;
+        std::mutex              sleepMutex;
+        std::condition_variable sleepCondition;
+
+        // Threads waiting on a job sleep once they can't help with it, until a job finishes or another one is queued.
+        std::atomic_int         waitingThreads = 0;
+        std::atomic<uint64_t>   waitEpoch      = 0;
+        std::mutex              waitMutex;
+        std::condition_variable waitCondition;
+        void WakeWaiters();
+
+        // Statistics on the workers' activity.
+        std::atomic_int        busyWorkers = 0;
+        std::atomic<long long> busyTimeNs  = 0;
+        long long              lastSampledBusyTimeNs = 0;
+        std::chrono::steady_clock::time_point lastSampleTime;
+        float                  lastUtilization = 0;
+
+        void WorkerLife(const int& workerIndex);
+        void Push      (const std::shared_ptr<Job>& job);
+        void Execute   (const std::shared_ptr<Job>& job);
+        void Finish    (const std::shared_ptr<Job>& job);
+        std::shared_ptr<Job> PopJob(const bool& allowBackground, const Job* root = nullptr);
+
+    public:
+        // Creates a job system with the given number of workers (0 to size it from the hardware, negative for none).
+        JobSystem(const int& threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&)            = delete;
+        JobSystem(JobSystem&&)                 = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+        JobSystem& operator=(JobSystem&&)      = delete;
+
+        static JobSystem* Get() { return instance; }
+
+        // Returns the job being executed by the calling thread, to schedule children of it.
+        static JobHandle CurrentJob();
+
+        // Stops all workers after their current job, queued jobs are dropped.
+        void Stop();
+
+        // Queues a job, optionally as a child of another job which will only be done once all its children are.
+        JobHandle Schedule(const std::function<void()>& task, const JobPriority& priority = JobPriority::Normal, const JobHandle& parent = JobHandle());
+
+        // Queues a job that will only start once all of the given jobs are done.
+        JobHandle Schedule(const std::function<void()>& task, const std::vector<JobHandle>& dependencies, const JobPriority& priority = JobPriority::Normal);
+
+        // Queues a job that will start once the given job is done.
+        JobHandle Then(const JobHandle& job, const std::function<void()>& continuation, const JobPriority& priority = JobPriority::Normal);
+
+        // Cancels the given job, returns true if it was still queued and could be removed from the queue.
+        bool Cancel(const JobHandle& job);
+
+        // Sets the importance of the job and of its unfinished background children.
+        void SetImportance(const JobHandle& job, const float& importance);
+
+        // Waits until the given job is done, executing it or the normal priority jobs it spawned in the meantime.
+        void Wait(const JobHandle& job);
+
+        // Executes a queued normal priority job, only one from the given job's tree if it is valid.
+        bool ExecuteOneJob(const JobHandle& root = JobHandle());
+
+        // Calls body(i) for every i in [begin, end), splitting the range in chunks of grainSize indices.
+        template <typename F> void ParallelFor(const size_t& begin, const size_t& end, const size_t& grainSize, const F& body);
+
+        // Statistics.
+        int   GetThreadCount()     const { return (int)threads.size(); }
+        int   GetBusyWorkerCount() const { return busyWorkers.load();  }
+        int   GetQueuedJobCount()  const { return queuedJobs.load() + queuedBackgroundJobs.load(); }
+        float SampleUtilization();
+
+        // Returns the number of workers to use on this machine (keeps a core for the render thread).
+        static int GetDefaultThreadCount();
+
+        // Logs the time taken by a parallel loop and a fine-grained task tree with 1 to N cores.
+        static void Benchmark();
+    };
+}
+
+#include "JobSystem.inl"
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include "JobSystem.h"
+
+
+// Calls body(i) for every i in [begin, end), the calling thread works on the first chunk and helps with the others while waiting.
+template <typename F> inline void Core::JobSystem::ParallelFor(const size_t& begin, const size_t& end, const size_t& grainSize, const F& body)
+{
+    if (begin >= end)
+        return;
+
+    // Run the whole range on this thread if it can't be split or if there are no workers to help.
+    const size_t grain = std::max(grainSize, (size_t)1);
+    if (end - begin <= grain || threads.size() <= 0)
+    {
+        for (size_t i = begin; i < end; i++)
+            body(i);
+        return;
+    }
+
+    // Create a root job that will be done once all of its chunks are.
+    std::shared_ptr<Job> root = std::make_shared<Job>();
+    root->system = this;
+    for (size_t chunkStart = begin + grain; chunkStart < end; chunkStart += grain)
+    {
+        const size_t chunkEnd = std::min(chunkStart + grain, end);
+        Schedule([&body, chunkStart, chunkEnd]() {
+            for (size_t i = chunkStart; i < chunkEnd; i++)
+                body(i);
+        }, JobPriority::Normal, JobHandle(root));
+    }
+
+    // Process the first chunk on this thread and wait for the others.
+    for (size_t i = begin; i < begin + grain; i++)
+        body(i);
+    Finish(root);
+    Wait(JobHandle(root));
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace Core
+{
+    // Steps of the loading of a resource, recorded by the threads that do them.
+    enum class LoadPhase
+    {
+        Queued,  // Waiting in the job system's queue.
+        Load,    // Whole loading job of the resource.
+        Read,    // Reading the resource's file.
+        Parse,   // Parsing obj and mtl files.
+        Decode,  // Decoding images.
+        Mipmaps, // Generating and compressing the mipmaps of textures.
+        Upload,  // Sending the resource's data to OpenGL.
+        Count,
+    };
+
+    struct LoadEvent
+    {
+        std::string resource;
+        LoadPhase   phase;
+        int         threadIndex;
+        long long   startNs, endNs; // Relative to the start of the timeline.
+    };
+
+    // Timeline of the loading phases of all resources, to find out what loads are bound on and which threads are idle.
+    class LoadTimeline
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        static std::mutex               mutex;
+        static std::vector<LoadEvent>   events;
+        static std::vector<std::string> threadNames;
+        static Clock::time_point        origin;
+
+    public:
+        // Adds a phase of the given resource, done by the calling thread.
+        static void Record(const std::string& resource, const LoadPhase& phase, const Clock::time_point& start, const Clock::time_point& end);
+
+        // Threads are given an index the first time they record a phase, and can be named to be told apart in the timeline.
+        static int  GetThreadIndex();
+        static void SetThreadName(const std::string& name);
+
+        // Removes all events and starts the timeline from now.
+        static void Clear();
+
+        static std::vector<LoadEvent>   GetEvents();
+        static std::vector<std::string> GetThreadNames();
+        static const char*              GetPhaseName(const LoadPhase& phase);
+
+        // Writes the events in the Chrome trace format (viewable in chrome://tracing or Perfetto), returns false if the file can't be written.
+        static bool ExportChromeTrace(const std::string& filename);
+    };
+
+    // Records the time between its creation and its destruction as a phase of the given resource.
+    class ScopedLoadPhase
+    {
+    private:
+        std::string                     resource;
+        LoadPhase                       phase;
+        LoadTimeline::Clock::time_point start;
+
+    public:
+        ScopedLoadPhase(const std::string& _resource, const LoadPhase& _phase)
+            : resource(_resource), phase(_phase), start(LoadTimeline::Clock::now()) {}
+        ~ScopedLoadPhase() { LoadTimeline::Record(resource, phase, start, LoadTimeline::Clock::now()); }
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace Core
+{
+    // Read-only view of a whole file mapped in memory, so it can be parsed in place without copying it.
+    class MappedFile
+    {
+    private:
+        const char* data = nullptr;
+        size_t      size = 0;
+        void*       fileHandle    = nullptr;
+        void*       mappingHandle = nullptr;
+
+    public:
+        MappedFile() {}
+        ~MappedFile() { Close(); }
+
+        MappedFile(const MappedFile&)            = delete;
+        MappedFile(MappedFile&&)                 = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&)      = delete;
+
+        // Maps the given file, returns false if it can't be opened (empty files are opened without being mapped).
+        bool Open(const std::string& filename);
+        void Close();
+
+        const char* GetData() const { return data; }
+        size_t      GetSize() const { return size; }
+        const char* GetEnd()  const { return data + size; }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IResource.h"
+#include "ResourceRef.h"
 #include "Color.h"
 
 namespace Resources
@@ -10,17 +11,20 @@ namespace Resources
 
     class Material : public IResource
     {
+    private:
+        std::atomic_bool defined = false; // Set once its mtl file is parsed.
+
     public:
         Core::Maths::RGB ambient, diffuse, specular, emission;
         float shininess = 32, transparency = 1;
 
-        Texture* ambientTexture  = nullptr;
-        Texture* diffuseTexture  = nullptr;
-        Texture* specularTexture = nullptr;
-        Texture* emissionTexture = nullptr;
-        Texture* shininessMap    = nullptr;
-        Texture* alphaMap        = nullptr;
-        Texture* normalMap       = nullptr;
+        ResourceRef<Texture> ambientTexture;
+        ResourceRef<Texture> diffuseTexture;
+        ResourceRef<Texture> specularTexture;
+        ResourceRef<Texture> emissionTexture;
+        ResourceRef<Texture> shininessMap;
+        ResourceRef<Texture> alphaMap;
+        ResourceRef<Texture> normalMap;
 
         Material(const std::string& _name);
         void Load() override;
@@ -28,6 +32,13 @@ namespace Resources
         void SetParams(const Core::Maths::RGB& _ambient, const Core::Maths::RGB& _diffuse, const Core::Maths::RGB& _specular, const Core::Maths::RGB& _emission, const float& _shininess);
         void SendDataToShader(const unsigned int& shaderProgramId, const unsigned int& sampler) const;
 
+        // Back faces are culled for opaque materials.
+        bool CullsBackFaces() const;
+
+        // Materials are created by obj files before their mtl file defines their parameters and textures.
+        void SetDefined()       { defined.store(true);  }
+        bool IsDefined()  const { return defined.load(); }
+
         static ResourceTypes GetResourceType() { return ResourceTypes::Material; }
     };
 }
\ No newline at end of file
@@ -19,6 +19,9 @@ namespace Resources
 
         void Load()         override;
         void SendToOpenGL() override;
+        size_t GetCpuBytes() const override;
+        size_t GetGpuBytes() const override;
+        void DeleteOpenGLObjects() override;
         bool AreAllSubMeshesLoaded();
         bool AreAllSubMeshesInOpenGL();
 
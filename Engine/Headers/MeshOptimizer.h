@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include "Vector3.h"
+
+namespace Core::Maths
+{
+    struct TangentVertex;
+}
+
+namespace Resources
+{
+    // Efficiency of the post-transform vertex cache for a triangle order, simulated with a FIFO cache.
+    struct VertexCacheStats
+    {
+        float acmr = 0; // Average cache miss ratio: transformed vertices per triangle (0.5 at best, 3 at worst).
+        float atvr = 0; // Average transform to vertex ratio: transformed vertices per vertex (1 at best).
+    };
+
+    // Range of triangles drawn together, with bounds used to skip it when it is out of view or facing away from the camera.
+    struct Meshlet
+    {
+        unsigned int         firstIndex = 0, indexCount = 0;
+        Core::Maths::Vector3 center;          // Bounding sphere.
+        float                radius     = 0;
+        Core::Maths::Vector3 coneAxis;        // Average normal of the triangles.
+        float                coneCutoff = 0;  // Cosine of the largest angle between the axis and a normal, the cone isn't used if it isn't positive.
+    };
+
+    // Reorders the triangles and vertices of indexed meshes to render them faster.
+    class MeshOptimizer
+    {
+    public:
+        // Size of the simulated vertex cache when analyzing triangle orders.
+        static constexpr unsigned int AnalyzedCacheSize = 16;
+
+        static VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, const size_t& vertexCount);
+
+        // Reorders the triangles so that they reuse the vertices transformed by the previous ones (Forsyth's algorithm).
+        static void OptimizeVertexCache(std::vector<unsigned int>& indices, const size_t& vertexCount);
+
+        // Splits the triangles in clusters where the vertex cache gets flushed, and sorts the clusters to draw the outer ones first.
+        // Clusters are made smaller as long as their miss ratio stays under the threshold times the one of the whole cluster.
+        static void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Core::Maths::TangentVertex>& vertices, const float& threshold = 1.05f);
+
+        // Reorders the vertices in the order their triangles use them, so they are fetched sequentially.
+        static void OptimizeVertexFetch(std::vector<Core::Maths::TangentVertex>& vertices, std::vector<unsigned int>& indices);
+
+        // Removes triangles by collapsing the edges that change the surface the least (quadric error metric), without adding or moving vertices.
+        // Stops at the target index count or before the error (distance to the original surface, in mesh units) exceeds the target one.
+        // Returns the reached error.
+        static float Simplify(std::vector<unsigned int>& indices, const std::vector<Core::Maths::TangentVertex>& vertices, const size_t& targetIndexCount, const float& targetError);
+
+        // Splits the triangles in meshlets of consecutive triangles using at most the given number of vertices, so that each meshlet is a range of indices.
+        // The triangles aren't reordered, meshlets are built after the other optimizations so they keep their vertex cache and overdraw order.
+        static std::vector<Meshlet> BuildMeshlets(const std::vector<unsigned int>& indices, const std::vector<Core::Maths::TangentVertex>& vertices, const unsigned int& maxVertices = 64, const unsigned int& maxTriangles = 124);
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace Resources
+{
+    // Kind of data stored in a texture, which decides how its mipmaps are filtered and how it is compressed.
+    enum class TextureUsage
+    {
+        Color,
+        NormalMap,
+        AlphaMap,
+    };
+
+    // Builds the mip chains of textures on the CPU with stb_image_resize, so that they don't have to be generated by OpenGL.
+    class MipGenerator
+    {
+    public:
+        // Alpha above which pixels count as covered, alpha maps keep the same proportion of covered pixels in all of their levels.
+        static constexpr float AlphaCoverageReference = 0.5f;
+
+        // Fills the levels with the pixels followed by each of their mipmaps down to 1x1, the offsets hold the start of each level followed by the end of the last one.
+        // Colors are filtered in linear space (the pixels are sRGB), normal maps are filtered as vectors and normalized again, and alpha maps keep their alpha coverage.
+        static void Generate(const unsigned char* pixels, const int& width, const int& height, const int& colorChannels, const TextureUsage& usage,
+                             std::vector<unsigned char>& levels, std::vector<size_t>& levelOffsets);
+
+        // Number of levels down to 1x1, including the full size one.
+        static int GetLevelCount(const int& width, const int& height);
+    };
+}
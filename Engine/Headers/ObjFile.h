@@ -1,34 +1,88 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "IResource.h"
+#include "SubMesh.h"
 
+namespace Core
+{
+    struct AssetCacheKey;
+}
 
 namespace Resources
 {
     class ResourceManager;
     class Mesh;
     class ShaderProgram;
+    class Material;
+
+    // Faces parsed by one of the chunks of an obj file, as a range of the chunk's vertex indices.
+    struct ObjFaceRun
+    {
+        size_t chunk, first, count;
+    };
+
+    // Sub-mesh whose vertices are created from its faces once the whole file is parsed.
+    struct ObjSubMeshFaces
+    {
+        Mesh*    meshGroup;
+        SubMesh* subMesh;
+        std::vector<ObjFaceRun> faces;
+    };
 
     class ObjFile : public IResource
     {
     private:
+        // Files loaded by a job are split in chunks of at least this size, parsed by multiple workers.
+        static constexpr size_t MinChunkSize = (size_t)1 << 20;
+
+        // Meshes cached by another version are ignored.
+        static constexpr uint32_t    CacheVersion  = 8;
+        static constexpr const char* CacheImporter = "mesh";
+
         ResourceManager& resourceManager;
-        void ParseObjVertexValues(const std::string& line, std::vector<float>& values, const int& startIndex, const int& valCount);
-        void ParseObjObjectLine  (const std::string& line, Mesh*& meshGroup);
-        void ParseObjGroupLine   (const std::string& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram);
-        void ParseObjUsemtlLine  (const std::string& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram);
-        void ParseObjIndices     (const std::string& line, std::stringstream& fileContents, Mesh*& meshGroup, std::array<std::vector<float>, 3>& vertexData, const ShaderProgram* meshShaderProgram);
+
+        // Reloaded copies create their meshes outside of the resource manager, to swap them with the current ones once they are uploaded.
+        bool reloadedCopy   = false;
+        bool chunkedParsing = true;
+        bool useCache       = true;
+        std::vector<ObjSubMeshFaces> subMeshFaces;
+        std::vector<std::string>     mtlLibs;
+
+        Mesh* CreateMesh(const std::string& meshName);
+        void AddMtlLib(const std::string& mtlLib);
+        Material* GetMaterial(const std::string& materialName);
+        void EndSubMesh(Mesh* meshGroup);
+        void ParseObjObjectLine(const std::string_view& line, Mesh*& meshGroup);
+        void ParseObjGroupLine (const std::string_view& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram);
+        void ParseObjUsemtlLine(const std::string_view& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram);
+
+        void ParseObjFaces     (const ObjFaceRun& faces, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram);
+        void SetMeshesLoadingDone();
+
+        // Parses the obj file, returns false if the loading was cancelled.
+        bool ParseFile(const ShaderProgram* shaderProgram, const Core::AssetCacheKey& cacheKey, std::string& details);
+
+        // The processed meshes are kept in the asset cache, and read from there until the obj file or the mesh processing settings change.
+        bool LoadFromCache(const ShaderProgram* shaderProgram, const Core::AssetCacheKey& cacheKey);
+        void WriteCache   (const Core::AssetCacheKey& cacheKey) const;
 
     public:
         std::vector<IResource*> createdResources;
 
-        ObjFile(const std::string& _name, ResourceManager& _resourceManager);
+        ObjFile(const std::string& _name, ResourceManager& _resourceManager, const bool& _reloadedCopy = false);
         
         void Load()         override;
         void SendToOpenGL() override;
 
         static ResourceTypes GetResourceType() { return ResourceTypes::ObjFile; }
+
+        // Removes all cached meshes, so the next loads parse the obj files.
+        static void ClearCache();
+
+        // Parses the given obj files a number of times, in chunks and serially, and logs the parsing throughput.
+        static void Benchmark(ResourceManager& resourceManager, const std::vector<std::string>& filenames, const int& iterations = 5);
     };
 }
\ No newline at end of file
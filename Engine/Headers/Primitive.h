@@ -1,5 +1,6 @@
 #pragma once
 #include "Maths.h"
+#include "ResourceRef.h"
 #include <vector>
 
 namespace Resources
@@ -39,7 +40,7 @@ namespace Core::Physics
 	protected:
 		bool transformAllocated = false;
 		const Resources::ShaderProgram* shaderProgram = nullptr;
-		      Resources::Material*      material      = nullptr;
+		Resources::ResourceRef<Resources::Material> material;
 
 	public:
 		PrimitiveTypes type;
@@ -53,7 +54,7 @@ namespace Core::Physics
 		      Resources::Material*      GetMaterial()      { return material; }
 
 		void SetShaderProgram(const Resources::ShaderProgram* _shaderProgram) { shaderProgram = _shaderProgram; }
-		void SetMaterial     (      Resources::Material*      _material)      { material      = _material; }
+		void SetMaterial     (      Resources::Material*      _material);
 
 		static std::string GetPrimitiveName(PrimitiveTypes);
 	};
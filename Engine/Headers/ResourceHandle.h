@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace Resources
+{
+    class IResource;
+
+    // Table of all registered resources, indexed by resource handles.
+    // Slots are allocated by chunks that never move, so handles can be resolved without locking.
+    class ResourceSlots
+    {
+    public:
+        static constexpr uint32_t ChunkSize = 1024;
+        static constexpr uint32_t MaxChunks = 1024;
+
+    private:
+        // A slot's generation is incremented every time its resource is removed, which invalidates the handles to it.
+        struct Slot
+        {
+            std::atomic<IResource*> resource   = nullptr;
+            std::atomic<uint32_t>   generation = 1;
+        };
+        std::array<std::atomic<Slot*>, MaxChunks> chunks = {};
+        uint32_t              slotCount = 0;
+        std::vector<uint32_t> freeSlots;
+        std::mutex            mutex;
+
+    public:
+        ResourceSlots() {}
+        ~ResourceSlots();
+
+        ResourceSlots(const ResourceSlots&)            = delete;
+        ResourceSlots(ResourceSlots&&)                 = delete;
+        ResourceSlots& operator=(const ResourceSlots&) = delete;
+        ResourceSlots& operator=(ResourceSlots&&)      = delete;
+
+        // Gives a slot to the resource, or frees its slot.
+        void Register  (IResource* resource);
+        void Unregister(IResource* resource);
+
+        // Returns the resource in the given slot, or nullptr if it was removed since the handle was created.
+        IResource* Resolve(const uint32_t& index, const uint32_t& generation) const
+        {
+            const Slot* chunk = chunks[index / ChunkSize].load(std::memory_order_acquire);
+            if (chunk == nullptr)
+                return nullptr;
+            const Slot& slot = chunk[index % ChunkSize];
+            IResource* resource = slot.resource.load(std::memory_order_acquire);
+            return (slot.generation.load(std::memory_order_acquire) == generation ? resource : nullptr);
+        }
+    };
+
+    // Typed reference to a resource that stays safe to use after the resource is deleted (it then resolves to nullptr).
+    template <typename T> class ResourceHandle
+    {
+    private:
+        const ResourceSlots* slots = nullptr;
+        uint32_t index      = 0;
+        uint32_t generation = 0;
+
+    public:
+        ResourceHandle() {}
+        ResourceHandle(const ResourceSlots* _slots, const uint32_t& _index, const uint32_t& _generation)
+            : slots(_slots), index(_index), generation(_generation) {}
+
+        T*         Get()         const { return (T*)GetResource(); }
+        IResource* GetResource() const { return (slots != nullptr ? slots->Resolve(index, generation) : nullptr); }
+        bool       IsValid()     const { return GetResource() != nullptr; }
+
+        operator T*()    const { return Get(); }
+        T* operator->()  const { return Get(); }
+    };
+}
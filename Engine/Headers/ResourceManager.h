@@ -1,10 +1,16 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
+#include <mutex>
 #include "IResource.h"
+#include "ResourceHandle.h"
+#include "ResourceTracker.h"
 #include "Textures.h"
 #include "Cubemap.h"
 #include "TextureSampler.h"
+#include "UploadStreamer.h"
+#include "GpuUploader.h"
 #include "Material.h"
 #include "SubMesh.h"
 #include "Mesh.h"
@@ -12,19 +18,66 @@
 #include "ObjFile.h"
 #include "MtlFile.h"
 #include "ThreadManager.h"
+#include "HotReloader.h"
 
 namespace Resources
 {
     class ResourceManager
     {
+        friend class HotReloader;
+
     private:
         static bool asyncLoad;
         static Resources::TextureSampler* sampler;
+        static Resources::UploadStreamer* uploadStreamer;
+        static Resources::GpuUploader*    gpuUploader;
         std::unordered_map<std::string, IResource*> resources;
 		std::atomic_flag resourceLock = ATOMIC_FLAG_INIT;
 
+        // Names are only looked up when creating or getting a resource, handles then access it through its slot.
+        ResourceSlots   slots;
+        ResourceTracker tracker;
+        template <typename T> ResourceHandle<T> MakeHandle(IResource* resource) const { return ResourceHandle<T>(&slots, resource->GetSlotIndex(), resource->GetSlotGeneration()); }
+        void Register  (const std::string& name, IResource* resource);
+        void Unregister(IResource* resource);
+        template <typename T> T* NewResource(const std::string& name);
+
+        // File that created each mesh, material and texture, kept across reloads to know which file to load first for a given mesh.
+        std::mutex                                   resourceSourcesMutex;
+        std::unordered_map<std::string, std::string> resourceSources;
+
+        // Meshes of each obj file (saved between runs) and the loading job of the file creating each mesh, recorded when the job is created.
+        static constexpr const char* MeshSourcesName = "MeshSources.txt";
+        std::unordered_map<std::string, std::vector<std::string>> fileMeshes;
+        std::unordered_map<std::string, Core::JobHandle>          meshLoadingJobs;
+        void LoadMeshSources();
+        void SaveMeshSources();
+
+        // Unreferenced resources are evicted when the memory budget is exceeded, and reloaded from their source file when they are needed again.
+        // Only their OpenGL objects are deleted on the render thread, the rest is deleted by jobs.
+        static constexpr uint64_t EvictionInterval = 30;
+        static uint64_t frameIndex;
+        size_t   memoryBudget      = 0;
+        int      evictedCount      = 0;
+        uint64_t lastEvictionFrame = 0;
+        std::mutex                                                             evictedResourcesMutex;
+        std::unordered_map<std::string, std::pair<ResourceTypes, std::string>> evictedResources;
+        std::vector<Core::JobHandle>                                           evictionJobs;
+        bool   EvictLeastRecentlyUsed();
+        void   DeleteEvicted(const std::vector<std::string>& names);
+        void   WaitForEvictionJobs();
+        bool   ReloadEvicted(const std::string& name);
+        void   CreateOfType(const ResourceTypes& type, const std::string& name);
+
+        // Set while loads are cancelled, resources created in the meantime aren't loaded.
+        std::atomic_bool loadsCancelled = false;
+        void QueueLoad(IResource* resource);
+
     public:
         Core::ThreadManager threadManager;
+
+        // Reloads the shaders, textures and obj files that are modified while the app runs (destroyed before the thread manager).
+        HotReloader hotReloader;
         std::vector<std::pair<ResourceTypes, std::string>> pyResourceCreationQueue;
 
         ResourceManager();
@@ -35,23 +88,58 @@ namespace Resources
 		ResourceManager& operator=(const ResourceManager&) = delete;
 		ResourceManager& operator=(ResourceManager&&)      = delete;
 
-        template <typename T> T* Create(const std::string& name);
-        template <typename T> T* Get   (const std::string& name);
-        template <typename T> T* Find  (const std::string& searchTerm);
-        void                     Delete(const std::string& name);
-        bool                     Reset ();
+        template <typename T> ResourceHandle<T> Create(const std::string& name);
+        template <typename T> ResourceHandle<T> Get   (const std::string& name);
+        template <typename T> T*                Find  (const std::string& searchTerm);
+        template <typename T> ResourceHandle<T> Lookup(const std::string& name); // Like Get, but doesn't create or reload the resource if it isn't there.
+        void                                    Delete(const std::string& name);
+        bool                                    Reset ();
 
         void CreateSampler();
         static TextureSampler* GetSampler() { return sampler; }
 
+        // Textures and sub-meshes are uploaded through this streamer when it exists, a bit every frame.
+        void CreateUploadStreamer();
+        static UploadStreamer* GetUploadStreamer() { return uploadStreamer; }
+
+        // When it exists, textures and sub-meshes are uploaded by a thread with a shared OpenGL context instead.
+        void CreateGpuUploader(GLFWwindow* sharedWindow);
+        static GpuUploader* GetGpuUploader() { return gpuUploader; }
+
         std::unordered_map<std::string, IResource*>& GetResources() { return resources; }
 
-        bool AreAllResourcesLoaded();
-        bool AreAllResourcesInOpenGL();
+        // Calls visit(name, resource) for every resource while holding the resource lock, so workers can't create resources in the meantime.
+        // The visitor must not create, get or delete resources.
+        template <typename F> void ForEachResource(const F& visit);
+
+        // Cancels all loads until the next reset, so workers stop working on resources that are about to be deleted.
+        void CancelLoads();
+
+        bool AreAllResourcesLoaded()   const { return tracker.AreAllResourcesLoaded();   }
+        bool AreAllResourcesInOpenGL() const { return tracker.AreAllResourcesInOpenGL(); }
+
+        // Appends handles to the resources that finished loading (or parts of them) since the last call.
+        void PopChangedResources(std::vector<ResourceHandle<IResource>>& changed) { tracker.PopChanged(&slots, changed); }
+
         static void SetAsyncLoading(const bool& async) { asyncLoad = async; }
         static bool AsyncLoading()                     { return asyncLoad;  }
 
         void CheckForNewPyResources();
+
+        // Loading priorities: resources loading the meshes with the highest priority are loaded first.
+        void SetResourceSource(const std::string& resourceName, const std::string& fileName);
+        void SetMeshSource    (const std::string& meshName,     const std::string& fileName, const Core::JobHandle& loadingJob);
+        void SetLoadPriorities(const std::unordered_map<std::string, float>& meshPriorities);
+
+        // Called once per frame, evicts the least recently used resources while the memory budget is exceeded.
+        void EvictResources();
+
+        // Memory budget for the resources in RAM and VRAM, in bytes (0 for no budget).
+        void   SetMemoryBudget(const size_t& bytes) { memoryBudget = bytes; }
+        size_t GetMemoryBudget()  const { return memoryBudget; }
+        size_t GetUsedMemory()    const { return tracker.GetUsedMemory(); }
+        int    GetEvictedCount()  const { return evictedCount; }
+        static uint64_t GetFrameIndex() { return frameIndex;   }
     };
 }
 
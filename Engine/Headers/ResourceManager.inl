@@ -8,165 +8,107 @@
 using namespace Resources;
 
 
-// Creates a new resource of the specified type and returns it.
-template <typename T> inline T* ResourceManager::Create(const std::string& name)
+// Allocates a new resource of the specified type.
+template <typename T> inline T* ResourceManager::NewResource(const std::string& name)
 {
-    // Make sure the given type is supported.
-    bool isSupported = std::is_base_of<IResource, T>::value;
-    Assert(isSupported, (std::string("Specified resource type not supported for: ") + name).c_str());
-    
-    while (resourceLock.test_and_set()) {}
-    if (resources.count(name) > 0) 
-    {
-        // Return any previous resource.
-        if (resources[name]->GetType() == T::GetResourceType()) 
-        {
-            if (AsyncLoading())
-                threadManager.AddTask(resources[name]);
-            else
-                resources[name]->Load();
-	        resourceLock.clear();
-            return (T*)resources[name];
-        }
-
-        // Delete any previous resource with a different type.
-        else {
-            DebugLogWarning("Resource created twice with different types: " + name);
-            Delete(name);
-        }
-    }
-
-    // Create the resource.
-    resources[name] = (IResource*)(new T(name));
-	resourceLock.clear();
-
-    // Load and return the resource.
-    if (AsyncLoading())
-        threadManager.AddTask(resources[name]);
-    else
-        resources[name]->Load();
-    return (T*)resources[name];
+    return new T(name);
 }
 
-template <> inline ObjFile* ResourceManager::Create(const std::string& name)
+template <> inline ObjFile* ResourceManager::NewResource(const std::string& name)
 {
-    while (resourceLock.test_and_set()) {}
-    if (resources.count(name) > 0) 
-    {
-        // Return any previous resource.
-        if (resources[name]->GetType() == ObjFile::GetResourceType()) {
-            if (AsyncLoading())
-                threadManager.AddTask(resources[name]);
-            else
-                resources[name]->Load();
-	        resourceLock.clear();
-            return (ObjFile*)resources[name];
-        }
-
-        // Delete any previous resource with a different type.
-        else {
-            DebugLogWarning("Resource created twice with different types: " + name);
-            Delete(name);
-        }
-    }
+    return new ObjFile(name, *this);
+}
 
-    // Create the resource.
-    resources[name] = (IResource*)(new ObjFile(name, *this));
-	resourceLock.clear();
-    
-    // Load and return the resource.
-    if (AsyncLoading())
-        threadManager.AddTask(resources[name]);
-    else
-        resources[name]->Load();
-    return (ObjFile*)resources[name];
+template <> inline MtlFile* ResourceManager::NewResource(const std::string& name)
+{
+    return new MtlFile(name, *this);
 }
 
-template <> inline MtlFile* ResourceManager::Create(const std::string& name)
+// Creates a new resource of the specified type and returns a handle to it.
+template <typename T> inline ResourceHandle<T> ResourceManager::Create(const std::string& name)
 {
+    // Make sure the given type is supported.
+    bool isSupported = std::is_base_of<IResource, T>::value;
+    Assert(isSupported, (std::string("Specified resource type not supported for: ") + name).c_str());
+    
     while (resourceLock.test_and_set()) {}
-    if (resources.count(name) > 0) 
+    std::unordered_map<std::string, IResource*>::iterator it = resources.find(name);
+    if (it != resources.end()) 
     {
         // Return any previous resource.
-        if (resources[name]->GetType() == MtlFile::GetResourceType()) {
-            resources[name]->Load();
+        if (it->second->GetType() == T::GetResourceType()) 
+        {
+            IResource*        resource = it->second;
+            ResourceHandle<T> handle   = MakeHandle<T>(resource);
 	        resourceLock.clear();
-            return (MtlFile*)resources[name];
+            QueueLoad(resource);
+            return handle;
         }
 
         // Delete any previous resource with a different type.
-        else {
-            DebugLogWarning("Resource created twice with different types: " + name);
-            Delete(name);
-        }
+        DebugLogWarning("Resource created twice with different types: " + name);
+	    resourceLock.clear();
+        Delete(name);
+        while (resourceLock.test_and_set()) {}
     }
 
     // Create the resource.
-    resources[name] = (IResource*)(new MtlFile(name, *this));
+    T* resource = NewResource<T>(name);
+    Register(name, resource);
+    ResourceHandle<T> handle = MakeHandle<T>(resource);
 	resourceLock.clear();
     
     // Load and return the resource.
-    resources[name]->Load();
-    return (MtlFile*)resources[name];
+    QueueLoad(resource);
+    return handle;
 }
 
-// Attempts to find a resource of the specified type with the specified name and return it.
-template <typename T> inline T* ResourceManager::Get(const std::string& name)
+// Attempts to find a resource of the specified type with the specified name and return a handle to it.
+template <typename T> inline ResourceHandle<T> ResourceManager::Get(const std::string& name)
 {
     // Make sure the given type is supported.
     bool isSupported = std::is_base_of<IResource, T>::value;
     Assert(isSupported, (std::string("Specified resource type not supported for: ") + name).c_str());
     
     while (resourceLock.test_and_set()) {}
-    if (resources.count(name) <= 0)
-    {
-        DebugLogWarning("Not found resource was created: " + name);
-        resources[name] = (IResource*)(new T(name));
-    }
-    if (resources[name]->GetType() != T::GetResourceType())
+    std::unordered_map<std::string, IResource*>::iterator it = resources.find(name);
+    IResource* resource = (it != resources.end() ? it->second : nullptr);
+    if (resource == nullptr)
     {
-	    resourceLock.clear();
-        DebugLogWarning("Resource found with the wrong type: " + name);
-        return nullptr;
-    }
-	resourceLock.clear();
-    return (T*)resources[name];
-}
-
-template <> inline ObjFile* ResourceManager::Get(const std::string& name)
-{
-    while (resourceLock.test_and_set()) {}
-    if (resources.count(name) <= 0)
-    {
-        DebugLogWarning("Not found resource was created: " + name);
-        resources[name] = (IResource*)(new ObjFile(name, *this));
+        // Reload the resource if it was evicted.
+        resourceLock.clear();
+        if (ReloadEvicted(name))
+            return Get<T>(name);
+        while (resourceLock.test_and_set()) {}
+
+        it = resources.find(name);
+        resource = (it != resources.end() ? it->second : nullptr);
+        if (resource == nullptr) {
+            DebugLogWarning("Not found resource was created: " + name);
+            resource = NewResource<T>(name);
+            Register(name, resource);
+        }
     }
-    if (resources[name]->GetType() != ObjFile::GetResourceType())
+    if (resource->GetType() != T::GetResourceType())
     {
 	    resourceLock.clear();
         DebugLogWarning("Resource found with the wrong type: " + name);
-        return nullptr;
+        return ResourceHandle<T>();
     }
+    ResourceHandle<T> handle = MakeHandle<T>(resource);
 	resourceLock.clear();
-    return (ObjFile*)resources[name];
+    return handle;
 }
 
-template <> inline MtlFile* ResourceManager::Get(const std::string& name)
+template <typename T> inline ResourceHandle<T> ResourceManager::Lookup(const std::string& name)
 {
     while (resourceLock.test_and_set()) {}
-    if (resources.count(name) <= 0)
-    {
-        DebugLogWarning("Not found resource was created: " + name);
-        resources[name] = (IResource*)(new MtlFile(name, *this));
-    }
-    if (resources[name]->GetType() != MtlFile::GetResourceType())
-    {
-	    resourceLock.clear();
-        DebugLogWarning("Resource found with the wrong type: " + name);
-        return nullptr;
-    }
-	resourceLock.clear();
-    return (MtlFile*)resources[name];
+    std::unordered_map<std::string, IResource*>::iterator it = resources.find(name);
+    ResourceHandle<T> handle;
+    if (it != resources.end() && it->second->GetType() == T::GetResourceType())
+        handle = MakeHandle<T>(it->second);
+    resourceLock.clear();
+    return handle;
 }
 
 // Attempts to find a resource of the specified type which name contains the specified search term and return it.
@@ -193,3 +135,11 @@ template <typename T> inline T* ResourceManager::Find(const std::string& searchT
     }
     return resource;
 }
+
+template <typename F> inline void ResourceManager::ForEachResource(const F& visit)
+{
+    while (resourceLock.test_and_set()) {}
+    for (const std::pair<const std::string, IResource*>& it : resources)
+        visit(it.first, it.second);
+    resourceLock.clear();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "IResource.h"
+#include "ResourceHandle.h"
+
+namespace Resources
+{
+    // Counted reference to a resource, which keeps it from being evicted.
+    // It resolves to nullptr once the resource is deleted, resources that aren't in the resource manager are referenced without counting.
+    template <typename T> class ResourceRef
+    {
+    private:
+        ResourceHandle<T> handle;
+        T*                unregistered = nullptr;
+
+        void AddRef()    const { if (IResource* resource = handle.GetResource()) resource->AddRef();    }
+        void RemoveRef() const { if (IResource* resource = handle.GetResource()) resource->RemoveRef(); }
+        void Set(T* resource);
+
+    public:
+        ResourceRef() {}
+        ResourceRef(T* resource) { Set(resource); }
+        ResourceRef(const ResourceRef& other) : handle(other.handle), unregistered(other.unregistered) { AddRef(); }
+        ~ResourceRef() { RemoveRef(); }
+
+        ResourceRef& operator=(T* resource);
+        ResourceRef& operator=(const ResourceRef& other);
+
+        T* Get() const { return (unregistered != nullptr ? unregistered : handle.Get()); }
+        operator T*()   const { return Get(); }
+        T* operator->() const { return Get(); }
+    };
+}
+
+#include "ResourceRef.inl"
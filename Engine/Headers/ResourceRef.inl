@@ -0,0 +1,40 @@
+#pragma once
+#include "ResourceRef.h"
+
+namespace Resources
+{
+    template <typename T> inline void ResourceRef<T>::Set(T* resource)
+    {
+        handle       = ResourceHandle<T>();
+        unregistered = nullptr;
+        if (resource == nullptr)
+            return;
+
+        if (resource->GetSlots() == nullptr) {
+            unregistered = resource;
+            return;
+        }
+        handle = ResourceHandle<T>(resource->GetSlots(), resource->GetSlotIndex(), resource->GetSlotGeneration());
+        resource->AddRef();
+    }
+
+    template <typename T> inline ResourceRef<T>& ResourceRef<T>::operator=(T* resource)
+    {
+        if (resource != Get()) {
+            RemoveRef();
+            Set(resource);
+        }
+        return *this;
+    }
+
+    template <typename T> inline ResourceRef<T>& ResourceRef<T>::operator=(const ResourceRef<T>& other)
+    {
+        if (this != &other) {
+            other.AddRef();
+            RemoveRef();
+            handle       = other.handle;
+            unregistered = other.unregistered;
+        }
+        return *this;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include "ResourceHandle.h"
+
+namespace Resources
+{
+    class IResource;
+
+    // Keeps track of the registered resources' state, so the main thread doesn't have to scan all of them every frame.
+    class ResourceTracker
+    {
+    private:
+        // Number of registered resources that aren't loaded or sent to OpenGL yet.
+        std::atomic_int unloadedCount = 0;
+        std::atomic_int notInOpenGLCount = 0;
+
+        // Memory used by the registered resources, in bytes, updated when their state changes instead of summed every frame.
+        std::atomic<size_t> usedMemory = 0;
+
+        // Lock-free stack of the resources that changed state, pushed by the loading threads and emptied by the main thread.
+        struct ChangedNode
+        {
+            uint32_t     slotIndex;
+            uint32_t     slotGeneration;
+            ChangedNode* next;
+        };
+        std::atomic<ChangedNode*> changedHead = nullptr;
+
+    public:
+        ResourceTracker() {}
+        ~ResourceTracker();
+
+        ResourceTracker(const ResourceTracker&)            = delete;
+        ResourceTracker(ResourceTracker&&)                 = delete;
+        ResourceTracker& operator=(const ResourceTracker&) = delete;
+        ResourceTracker& operator=(ResourceTracker&&)      = delete;
+
+        // Starts or stops tracking the resource (it should already have a slot).
+        void Register  (IResource* resource);
+        void Unregister(IResource* resource);
+
+        // Called by resources when their state changes.
+        void OnLoadingDone        (IResource* resource);
+        void OnOpenGLTransferDone ();
+        void OnOpenGLTransferReset();
+        void PushChanged          (IResource* resource);
+        void UpdateUsedMemory     (IResource* resource);
+
+        // Appends handles to the resources that changed state since the last call, in the order they changed.
+        void PopChanged(const ResourceSlots* slots, std::vector<ResourceHandle<IResource>>& changed);
+
+        bool AreAllResourcesLoaded()   const { return unloadedCount.load()    <= 0; }
+        bool AreAllResourcesInOpenGL() const { return notInOpenGLCount.load() <= 0; }
+        size_t GetUsedMemory()         const { return usedMemory.load(); }
+    };
+}
@@ -50,6 +50,13 @@ namespace Scenes
         Physics::Primitive* AddCollider(SceneNode* node, const Physics::PrimitiveTypes& type, const std::vector<Core::Maths::TangentVertex>& vertices);
         Physics::Primitive* AddCollider(SceneNode* node, const Physics::PrimitiveTypes& type, const std::vector<Core::Maths::Vector3>& vertices);
 
+        // Fits the collider to the bounds of the given mesh's sub-meshes, which are kept whatever geometry they retain in RAM.
+        Physics::Primitive* AddCollider(SceneNode* node, const Physics::PrimitiveTypes& type, const Resources::Mesh* meshGroup);
+
+        // Sets the loading priority of the meshes used by models from their size on screen and visibility.
+        // Returns true once the meshes of all visible models are in OpenGL.
+        bool EvaluateLoadPriorities(const Render::Camera& camera, std::unordered_map<std::string, float>& meshPriorities);
+
         void StartPlayMode();
         void UpdateAndDrawAll(const Render::Camera& camera, const Render::LightManager& lightManager, const bool& dontUpdateScripts = false);
         void ClearAll();
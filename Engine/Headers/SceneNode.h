@@ -4,6 +4,7 @@
 #include <vector>
 #include "Maths.h"
 #include "Physics.h"
+#include "ResourceRef.h"
 
 namespace Resources
 {
@@ -99,8 +100,28 @@ namespace Scenes
 
     class SceneModel : public SceneNode
     {
+    private:
+        std::vector<unsigned int> subMeshLods; // Level of detail drawn for each sub-mesh in the last frame.
+
     public:
-        Resources::Mesh* meshGroup  = nullptr;
+        Resources::ResourceRef<Resources::Mesh> meshGroup;
+
+        // Sub-meshes are drawn with the coarsest level of detail whose error is smaller than this many pixels on screen.
+        // A coarser level is only used once its error is smaller by the hysteresis ratio, so that models don't alternate between levels.
+        static bool  useLods;
+        static float lodPixelError;
+        static constexpr float LodHysteresis = 0.25f;
+
+        // Full detail sub-meshes only draw their meshlets that are in view and facing the camera.
+        static bool useMeshletCulling;
+
+        // Triangles drawn by the models this frame, the ones in culled meshlets, and the ones they would have drawn at full detail.
+        static size_t drawnTriangleCount;
+        static size_t culledTriangleCount;
+        static size_t fullDetailTriangleCount;
+
+        // Deletes the buffer of the meshlet draw commands, must be called before the OpenGL context is destroyed.
+        static void ReleaseDrawBuffers();
 
         SceneModel(const size_t& _id, const std::string& _name, Resources::Mesh* _meshGroup, SceneNode* _parent = nullptr);
         void Draw(const Render::Camera& camera, const Render::LightManager& lightManager);
@@ -115,7 +136,7 @@ namespace Scenes
     public:
         size_t instanceCount;
         std::vector<Transform> instanceTransforms;
-        Resources::Mesh* meshGroup = nullptr;
+        Resources::ResourceRef<Resources::Mesh> meshGroup;
 
         bool wasLoaded = false;
 
@@ -130,7 +151,7 @@ namespace Scenes
     class SceneSkybox : public SceneNode
     {
     private:
-        Resources::Mesh* skyboxMesh = nullptr;
+        Resources::ResourceRef<Resources::Mesh> skyboxMesh;
 
     public:
         Resources::Cubemap* cubemap = nullptr;
@@ -3,6 +3,7 @@
 #include "IResource.h"
 #include <vector>
 #include <string>
+#include <utility>
 
 namespace Resources
 {
@@ -19,6 +20,9 @@ namespace Resources
         void Load()         override;
         void SendToOpenGL() override;
 
+        // Takes the shader compiled by a reloaded copy of this resource, which gets the current one.
+        void SwapData(VertexShader& reloaded) { std::swap(id, reloaded.id); }
+
         unsigned int GetId() const { return id; }
         static ResourceTypes GetResourceType() { return ResourceTypes::VertexShader; }
     };
@@ -36,6 +40,9 @@ namespace Resources
         void Load()         override;
         void SendToOpenGL() override;
 
+        // Takes the shader compiled by a reloaded copy of this resource, which gets the current one.
+        void SwapData(FragmentShader& reloaded) { std::swap(id, reloaded.id); }
+
         unsigned int GetId() const { return id; }
         static ResourceTypes GetResourceType() { return ResourceTypes::FragmentShader; }
     };
@@ -53,6 +60,9 @@ namespace Resources
         void Load()         override;
         void SendToOpenGL() override;
 
+        // Takes the shader compiled by a reloaded copy of this resource, which gets the current one.
+        void SwapData(ComputeShader& reloaded) { std::swap(id, reloaded.id); }
+
         unsigned int GetId() const { return id; }
         static ResourceTypes GetResourceType() { return ResourceTypes::ComputeShader; }
     };
@@ -73,6 +83,10 @@ namespace Resources
         void Load()         override;
         void SendToOpenGL() override;
 
+        // Links the attached shaders again after one of them was reloaded, the previous program is kept if linking fails.
+        bool UsesShader(const IResource* shader) const;
+        bool Relink();
+
         unsigned int GetId() const { return id; }
         static ResourceTypes GetResourceType() { return ResourceTypes::ShaderProgram; }
     };
@@ -3,54 +3,198 @@
 #include <vector>
 #include <array>
 #include <string>
-#include <sstream>
+#include <memory>
+#include <cstdint>
 #include "IResource.h"
+#include "ResourceRef.h"
+#include "Vector3.h"
+#include "MeshOptimizer.h"
 
-namespace Core::Maths
+namespace Core
 {
-    struct TangentVertex;
+    class JobSystem;
+    namespace Maths { struct TangentVertex; }
 }
 
 namespace Resources
 {
     class Material;
+    struct GpuUpload;
     class ShaderProgram;
 
+    // Vertex values parsed from obj files (positions, uvs and normals) and the face indices pointing to them.
+    using ObjVertexData    = std::array<std::vector<float>,    3>;
+    using ObjVertexIndices = std::array<std::vector<uint32_t>, 3>;
+
+    // Range of the index buffer drawn at a level of detail, and its distance to the full detail surface in mesh units.
+    struct SubMeshLod
+    {
+        unsigned int firstIndex = 0, indexCount = 0;
+        float        error      = 0;
+    };
+
+    // Geometry kept in RAM once a sub-mesh is in OpenGL, its bounds are always kept.
+    enum class GeometryRetention
+    {
+        Bounds,    // Only the bounding box.
+        Positions, // Vertex positions quantized to 16 bits in the bounds.
+        Full,      // All vertex attributes.
+    };
+
     class SubMesh
     {
+    public:
+        // Number of levels of detail, including the full detail one.
+        static constexpr unsigned int MaxLodCount = 4;
+
     private:
         std::string      name;
         unsigned int     vertexCount  = 0;
+        unsigned int     indexCount   = 0;
+        unsigned int     unweldedVertexCount = 0; // One vertex per face corner, before welding.
         std::atomic_bool loaded       = false;
         std::atomic_bool sentToOpenGL = false;
         const ShaderProgram* shaderProgram = nullptr;
-              Material*      material      = nullptr;
+        ResourceRef<Material> material;
 
         std::vector<Core::Maths::TangentVertex> vertices;
         std::vector<unsigned int>               indices;
 
+        // Bounding box of the vertices.
+        Core::Maths::Vector3 boundsMin, boundsMax;
+
+        // Compact copy of the vertices: 16-bit positions in the bounds, half float uvs and octahedral normals,
+        // followed by a separate stream of octahedral tangents and bitangent signs. Indices are 16-bit when possible.
+        std::vector<unsigned char>  compactVertices;
+        std::vector<unsigned short> compactIndices;
+        bool compact      = false; // The buffers use the compact vertices.
+        bool hasTangents  = true;  // The tangent stream was uploaded.
+        bool shortIndices = false; // The index buffer uses 16-bit indices.
+
+        static std::atomic_bool vertexCompression;
+
+        // Vertex cache efficiency of the triangles in the obj file's order and after optimizing them.
+        VertexCacheStats cacheStatsBefore, cacheStatsAfter;
+        static std::atomic_bool indexOptimization;
+
+        // Levels of detail, the indices of the simplified ones follow the full detail indices in the same buffer.
+        std::vector<SubMeshLod> lods;
+        static std::atomic_bool lodGeneration;
+
+        // Ranges of the full detail indices that can be skipped when they are out of view or facing away from the camera.
+        std::vector<Meshlet> meshlets;
+
+        // Geometry kept after the upload: the quantized positions (3 per vertex) replace the vertices unless they are fully retained.
+        GeometryRetention     retention = GeometryRetention::Full;
+        std::vector<uint16_t> retainedPositions;
+        static std::atomic<GeometryRetention> geometryRetention;
+
         unsigned int VBO = 0;
         unsigned int EBO = 0;
 
+        // Bytes already uploaded to the vertex and index buffers, which are uploaded over multiple frames.
+        size_t uploadedVertexBytes = 0;
+        size_t uploadedIndexBytes  = 0;
+
+        // Upload by the upload thread, if there is one.
+        std::shared_ptr<GpuUpload> upload;
+        bool uploadSubmitted = false;
+
     public:
         unsigned int VAO = 0;
 
         SubMesh(const std::string& _name, const ShaderProgram* _shaderProgram);
         ~SubMesh();
 
-        void LoadVertices(std::stringstream& fileContents, const std::array<std::vector<float>, 3>& vertexData);
+        // Deletes the buffers on the render thread, so the rest of the sub-mesh can be deleted by any thread.
+        void DeleteOpenGLObjects();
+
+        // Adds the vertices of the given range of face indices, face corners with the same indices share their vertex.
+        void LoadVertices(const ObjVertexData& vertexData, const ObjVertexIndices& vertexIndices, const size_t& first, const size_t& count);
+
+        // Merges the vertices that have the same position, uv and normal, once all of them are loaded.
+        void WeldVertices();
+
+        // Computes the tangents and bitangents of the welded vertices, with the given job system's workers if there is one.
+        void GenerateTangents(Core::JobSystem* jobSystem);
+
+        // Reorders the triangles for the vertex cache and overdraw and the vertices for fetching, if index optimization is enabled.
+        void OptimizeIndices();
+
+        // Splits the triangles in meshlets, before the levels of detail are appended to the indices.
+        void BuildMeshlets();
+
+        // Appends simplified copies of the indices with half as many triangles each, if LOD generation is enabled.
+        void GenerateLods();
+
+        // Sets the vertices and indices read from the mesh cache.
+        void SetCachedVertices(const Core::Maths::TangentVertex* cachedVertices, const size_t& cachedVertexCount, const unsigned int* cachedIndices, const size_t& cachedIndexCount,
+                               const unsigned int& cachedUnweldedVertexCount, const Core::Maths::Vector3& cachedBoundsMin, const Core::Maths::Vector3& cachedBoundsMax);
+
+        // Fills the compact vertices and indices from the welded ones, if vertex compression is enabled.
+        void CompressVertices();
+        void SetCachedVertexCacheStats(const VertexCacheStats& before, const VertexCacheStats& after) { cacheStatsBefore = before; cacheStatsAfter = after; }
+        void SetCachedLods    (const SubMeshLod* cachedLods,     const size_t& cachedLodCount)     { lods    .assign(cachedLods,     cachedLods     + cachedLodCount);     }
+        void SetCachedMeshlets(const Meshlet*    cachedMeshlets, const size_t& cachedMeshletCount) { meshlets.assign(cachedMeshlets, cachedMeshlets + cachedMeshletCount); }
         bool SendVerticesToOpenGL(size_t& totalVertexCount);
 
+        // Sub-meshes loaded while vertex compression is enabled are uploaded with the compact vertices.
+        static void SetVertexCompression(const bool& enabled) { vertexCompression.store(enabled); }
+        static bool VertexCompression()                       { return vertexCompression.load(); }
+
+        // Sub-meshes parsed while index optimization is enabled are optimized.
+        static void SetIndexOptimization(const bool& enabled) { indexOptimization.store(enabled); }
+        static bool IndexOptimization()                       { return indexOptimization.load(); }
+
+        // Sub-meshes parsed while LOD generation is enabled get simplified levels of detail.
+        static void SetLodGeneration(const bool& enabled) { lodGeneration.store(enabled); }
+        static bool LodGeneration()                       { return lodGeneration.load(); }
+
+        // Sub-meshes sent to OpenGL afterwards release the geometry that isn't retained.
+        static void              SetGeometryRetention(const GeometryRetention& _retention) { geometryRetention.store(_retention); }
+        static GeometryRetention GetGeometryRetention()                                    { return geometryRetention.load(); }
+        static const char*       GetGeometryRetentionName(const GeometryRetention& _retention);
+
+        // Vertex positions still in RAM, decoded from the quantized ones after the upload. Empty if only the bounds were retained.
+        std::vector<Core::Maths::Vector3> GetPositions() const;
+        GeometryRetention                 GetRetention() const { return retention; }
+
+        // Sub-meshes without levels of detail have a single one with all of their indices.
+        unsigned int GetLodCount() const { return (lods.empty() ? 1 : (unsigned int)lods.size()); }
+        SubMeshLod   GetLod(const unsigned int& level) const;
+
+        // Memory used by the vertices in RAM and by the buffers in VRAM, in bytes.
+        // The vertices only hold all of their attributes until the upload when geometry isn't fully retained.
+        size_t GetCpuBytes() const;
+        size_t GetGpuBytes() const;
+
+        // Vertex count and buffer size without welding, with one vertex per face corner.
+        unsigned int GetUnweldedVertexCount() const { return unweldedVertexCount; }
+        size_t       GetUnweldedGpuBytes()    const;
+
+        // Buffer size with the uncompressed vertices and 32-bit indices.
+        size_t GetUncompressedGpuBytes() const;
+
         std::string          GetName()          const { return name;                }
         unsigned int         GetVertexCount()   const { return vertexCount;         }
+        unsigned int         GetIndexCount()    const { return indexCount;          }
         bool                 IsLoaded()         const { return loaded.load();       }
         void                 SetLoadingDone()         { loaded.store(true);         }
         bool                 WasSentToOpenGL()  const { return sentToOpenGL.load(); }
+        bool                 IsCompact()        const { return compact;             }
+        bool                 HasTangents()      const { return hasTangents;         }
+        bool                 HasShortIndices()  const { return shortIndices;        }
         const ShaderProgram* GetShaderProgram() const { return shaderProgram;       }
               Material*      GetMaterial()            { return material;            }
-        const std::vector<Core::Maths::TangentVertex>& GetVertices() const { return vertices; }
+        const std::vector<Core::Maths::TangentVertex>& GetVertices()         const { return vertices;         } // Empty after the upload unless geometry is fully retained.
+        const std::vector<unsigned int>&               GetIndices()          const { return indices;          }
+        const Core::Maths::Vector3&                    GetBoundsMin()        const { return boundsMin;        }
+        const Core::Maths::Vector3&                    GetBoundsMax()        const { return boundsMax;        }
+        const VertexCacheStats&                        GetCacheStatsBefore() const { return cacheStatsBefore; }
+        const VertexCacheStats&                        GetCacheStatsAfter()  const { return cacheStatsAfter;  }
+        const std::vector<Meshlet>&                    GetMeshlets()         const { return meshlets;         }
 
         void SetShaderProgram(const ShaderProgram* _shaderProgram) { shaderProgram = _shaderProgram; }
-        void SetMaterial     (      Material*      _material)      { material = _material; }
+        void SetMaterial     (      Material*      _material);
     };
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+
+namespace Core
+{
+    class JobSystem;
+    namespace Maths { struct TangentVertex; }
+}
+
+namespace Resources
+{
+    // Generates the tangents and bitangents of indexed meshes, used for normal mapping.
+    class TangentSpace
+    {
+    public:
+        // Gives each vertex the sum of its triangles' tangents and bitangents, made orthonormal with its normal.
+        // Triangles are processed in parallel batches with SIMD when available, the result doesn't depend on the thread count.
+        static void Generate(std::vector<Core::Maths::TangentVertex>& vertices, const std::vector<unsigned int>& indices, Core::JobSystem* jobSystem, const bool& useSimd = true);
+
+        // Name of the instruction set used for the triangles ("AVX2", "SSE2" or "scalar").
+        static const char* GetSimdName();
+
+        // Generates the tangents of a large grid with the scalar and SIMD paths, on one thread and on all of the given job system's workers, and logs their times.
+        static void Benchmark(Core::JobSystem& jobSystem);
+    };
+}
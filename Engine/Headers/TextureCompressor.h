@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace Core
+{
+    class JobSystem;
+}
+
+namespace Resources
+{
+    // Block compression formats of textures, made of 4x4 pixel blocks.
+    enum class TextureCompression
+    {
+        None,
+        BC1, // RGB, 8 bytes per block.
+        BC3, // RGBA, 16 bytes per block.
+        BC4, // Single channel, 8 bytes per block.
+        BC5, // Two channels (x and y of normal maps), 16 bytes per block.
+    };
+
+    // Compresses texture pixels in block formats with stb_dxt, so that they take 4 to 8 times less memory in VRAM.
+    class TextureCompressor
+    {
+    public:
+        // Format for pixels with the given channel count: normal maps keep their first two channels, grey and alpha pixels are expanded to RGBA, and opaque ones use BC1.
+        static TextureCompression ChooseFormat(const unsigned char* pixels, const int& width, const int& height, const int& colorChannels, const bool& isNormalMap);
+
+        // Compresses each level of a mip chain made by the mip generator, block rows are split between the job system's workers if there is one.
+        // The compressed levels are stored one after the other in the blocks, the offsets hold the start of each level followed by the end of the last one.
+        static void Compress(const std::vector<unsigned char>& levels, const std::vector<size_t>& levelOffsets, const int& width, const int& height, const int& colorChannels,
+                             const TextureCompression& format, std::vector<unsigned char>& blocks, std::vector<size_t>& blockOffsets, Core::JobSystem* jobSystem);
+
+        static size_t       GetLevelBytes (const TextureCompression& format, const int& width, const int& height);
+        static size_t       GetBlockBytes (const TextureCompression& format);
+        static unsigned int GetGlFormat   (const TextureCompression& format);
+        static const char*  GetFormatName (const TextureCompression& format);
+
+        // Decodes the given image files, generates their mipmaps and compresses them on one thread and on all of the given job system's workers, and logs their times and sizes.
+        static void Benchmark(const std::vector<std::string>& filenames, Core::JobSystem& jobSystem);
+    };
+}
@@ -1,32 +1,90 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+#include <atomic>
 #include "IResource.h"
 #include "Color.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+
+namespace Core
+{
+    struct AssetCacheKey;
+    class  CachedAsset;
+}
 
 namespace Resources
 {
     class TextureSampler;
+    class UploadStreamer;
+    struct GpuUpload;
 
     // Static, unchanging texture.
     class Texture : public IResource
     {
     private:
         unsigned int id = 0;
-        bool hashed = false;
         int width, height, colorChannels;
-        unsigned char* data;
+        void FreeData();
+
+        // Pixels of each mip level, or their blocks when the texture is compressed, one level after the other.
+        // Levels read from the asset cache stay in the mapped cache file and are copied from there to the staging buffer.
+        TextureCompression         compression = TextureCompression::None;
+        std::vector<unsigned char> levels;
+        std::unique_ptr<Core::CachedAsset> cachedLevels;
+        std::vector<size_t>        levelOffsets; // Start of each level, followed by the end of the last one.
+        size_t                     gpuBytes = 0;
+        static std::atomic_bool    compressionEnabled;
+        void ComputeLevelOffsets();
+        const unsigned char* GetLevelData() const;
+
+        // The mip levels are kept in the asset cache, keyed by the image file, this version and the compression and usage of the texture.
+        static constexpr uint32_t CacheVersion = 4;
+        bool ReadCache (const Core::AssetCacheKey& cacheKey);
+        void WriteCache(const Core::AssetCacheKey& cacheKey) const;
+
+        // Number of rows (block rows when compressed) already uploaded in the current mip level, textures are uploaded over multiple frames.
+        int uploadedRows  = 0;
+        int uploadedLevel = 0;
+        bool CreateStorage();
+        bool UploadLevels(UploadStreamer* streamer);
+        void FinishUpload();
+
+        // Upload by the upload thread, if there is one.
+        std::shared_ptr<GpuUpload> upload;
+        bool uploadSubmitted = false;
 
     public:
         Texture(const std::string& _name);
         Texture(const int& _width, const int& _height);
         void Load() override;
         void SendToOpenGL() override;
+        size_t GetCpuBytes() const override;
+        size_t GetGpuBytes() const override;
+        void DeleteOpenGLObjects() override;
         ~Texture();
 
+        // Size the texture would take in VRAM without compression, with its mipmaps.
+        size_t GetUncompressedGpuBytes() const;
+
+        // Textures loaded while texture compression is enabled are block compressed on the loading worker.
+        static void SetCompressionEnabled(const bool& enabled) { compressionEnabled.store(enabled); }
+        static bool CompressionEnabled()                       { return compressionEnabled.load(); }
+
+        // Textures marked as normal maps or alpha maps before they are created get mipmaps filtered for their data.
+        // Normal maps are compressed with two channels (BC5), the shader rebuilds the third one.
+        static void         MarkUsage(const std::string& textureName, const TextureUsage& usage);
+        static TextureUsage GetUsage (const std::string& textureName);
+
+        // Takes the OpenGL texture uploaded by a reloaded copy of this resource, which gets the current one.
+        void SwapData(Texture& reloaded);
+
         unsigned int GetId()     { return id;     }
         int GetWidth()           { return width;  }
         int GetHeight()          { return height; }
         int GetColorChannels()   { return colorChannels; }
+        TextureCompression GetCompression() const { return compression; }
         static ResourceTypes GetResourceType() { return ResourceTypes::Texture; }
     };
 
@@ -36,7 +94,20 @@ namespace Resources
     private:
         unsigned int id = 0;
         int width, height, colorChannels;
-        unsigned char* data;
+
+        // Pixels followed by their mipmaps, which are generated again when the pixels are updated.
+        std::vector<unsigned char> levels;
+        std::vector<size_t>        levelOffsets;
+        void UploadLevels();
+
+        // Mipmaps of the updated pixels are generated by a worker in these levels, one update at a time, and uploaded by UpdateTextures once they are done.
+        std::vector<unsigned char> rebuiltLevels;
+        std::vector<size_t>        rebuiltLevelOffsets;
+        Core::JobHandle            rebuildJob;
+        bool                       dirty = false, rebuilding = false;
+
+        static std::mutex                   updatedTexturesMutex;
+        static std::vector<DynamicTexture*> updatedTextures; // Textures that are dirty or rebuilding their mipmaps.
 
     public:
         DynamicTexture(const std::string& _name);
@@ -47,8 +118,13 @@ namespace Resources
 
         Core::Maths::RGBA GetPixel(const int& x, const int& y);
         void SetPixel(const int& x, const int& y, const Core::Maths::RGBA& color, bool updateTexture = true);
+
+        // Marks the pixels as updated, the texture is sent to OpenGL with their new mipmaps in a later frame.
         void UpdateTexture();
 
+        // Starts generating the mipmaps of the updated textures and uploads the ones that are done, called once per frame by the render thread.
+        static void UpdateTextures();
+
         unsigned int GetId()   { return id;     }
         int GetWidth()         { return width;  }
         int GetHeight()        { return height; }
@@ -1,9 +1,11 @@
 #pragma once
+#include <deque>
 #include <vector>
-#include <thread>
 #include <atomic>
+#include <mutex>
 #include <string>
 #include "IResource.h"
+#include "JobSystem.h"
 #include <functional>
 
 namespace Resources
@@ -16,21 +18,12 @@ namespace Core
 	class ThreadManager
 	{
 	private:
-		// Used to make all threads end.
-		std::atomic_bool stopThreads = false;
-
-		// Use as a substitue as lock / unlock.
-		std::atomic_flag lock = ATOMIC_FLAG_INIT;
-
-		// List of tasks and list of threads.
-		std::vector<Resources::IResource*> tasks;
-		std::vector<std::thread>           threads;
-
-		// Used to start all of the threads.
-		void LaunchThreads(int maxThread);
+		// Job system running the loading tasks, shared with the rest of the engine.
+		JobSystem jobSystem;
 
 	public:
-		ThreadManager(const int& maxThread);
+		// Creates a thread manager with the given number of workers (0 to size it from the hardware).
+		ThreadManager(const int& maxThread = 0);
 		~ThreadManager();
 
 		// Delete all the copy constructors.
@@ -39,10 +32,24 @@ namespace Core
 		ThreadManager& operator=(const ThreadManager&) = delete;
 		ThreadManager& operator=(ThreadManager&&)      = delete;
 
-		// Adds new task to the list.
-		void AddTask(Resources::IResource* resource);
+		// Queues a job loading the given resource, as a child of the calling loading job if there is one.
+		JobHandle AddTask(Resources::IResource* resource);
+
+		// Cancels the loading of the given resource and removes it from the queue if it hasn't started.
+		void CancelTask(Resources::IResource* resource);
+
+		// Waits until the given resource isn't being loaded anymore.
+		void WaitForTask(Resources::IResource* resource);
+
+		// Stops all workers and waits for them to finish their current task.
+		void Stop();
+
+		JobSystem& GetJobSystem() { return jobSystem; }
 
-		// Function on which the threads run.
-		void Life();
+		// Statistics.
+		int   GetThreadCount()     const { return jobSystem.GetThreadCount();     }
+		int   GetBusyWorkerCount() const { return jobSystem.GetBusyWorkerCount(); }
+		int   GetQueuedTaskCount() const { return jobSystem.GetQueuedJobCount();  }
+		float SampleUtilization()        { return jobSystem.SampleUtilization();  }
 	};
 }
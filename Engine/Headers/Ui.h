@@ -66,6 +66,7 @@ namespace Core
         static void ShowMaterialUi  (Resources::Material* material);
         static void ShowRemoveNodeUi(Scenes::SceneNode*&  node);
         static void ShowPhysicsUi   (Scenes::SceneNode*   node);
+        static void ShowLoadTimelineUi();
 
 		static void ShowStartMenu        ();
 		static void ShowOptionsMenu      ();
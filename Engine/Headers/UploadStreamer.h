@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <chrono>
+
+namespace Resources
+{
+    // Streams resource data to the GPU through a persistently mapped staging buffer, with a budget of bytes and time per frame.
+    // The buffer is split in one segment per frame in flight, each segment is only reused once the GPU is done reading it.
+    class UploadStreamer
+    {
+    public:
+        static constexpr int    FramesInFlight = 3;
+        static constexpr size_t Alignment      = 16;
+
+    private:
+        unsigned int   buffer      = 0;
+        unsigned char* mappedData  = nullptr;
+        size_t         segmentSize = 0;
+        std::array<void*, FramesInFlight> segmentFences = {};
+
+        // Current frame's segment.
+        int    segment          = 0;
+        size_t segmentOffset    = 0;
+        bool   segmentAvailable = false;
+        std::chrono::steady_clock::time_point frameStart;
+
+        // Budget of each frame.
+        size_t byteBudget = 8 << 20;
+        float  timeBudget = 4.f;
+
+        // Statistics.
+        size_t uploadedBytes      = 0;
+        size_t totalUploadedBytes = 0;
+        int    hitchCount         = 0;
+        float  lastFrameTime      = 0;
+        float  throughput         = 0;
+        size_t throughputBytes    = 0;
+        std::chrono::steady_clock::time_point throughputStart;
+
+    public:
+        // Creates the staging buffer (an OpenGL context should be current).
+        UploadStreamer(const size_t& stagingSize = 48 << 20);
+        ~UploadStreamer();
+
+        UploadStreamer(const UploadStreamer&)            = delete;
+        UploadStreamer(UploadStreamer&&)                 = delete;
+        UploadStreamer& operator=(const UploadStreamer&) = delete;
+        UploadStreamer& operator=(UploadStreamer&&)      = delete;
+
+        // Should surround all uploads of a frame.
+        void BeginFrame();
+        void EndFrame();
+
+        // Returns the number of bytes that can still be staged this frame (0 once the time budget is spent).
+        size_t GetAvailableBytes() const;
+        bool   HasTimeLeft()       const;
+
+        // Copies data to the staging buffer and returns its offset in it (size should be at most GetAvailableBytes()).
+        size_t Stage(const void* data, const size_t& size);
+        unsigned int GetBufferId() const { return buffer; }
+
+        void   SetByteBudget(const size_t& bytes) { byteBudget = bytes;   }
+        void   SetTimeBudget(const float&  ms)    { timeBudget = ms;      }
+        size_t GetByteBudget()  const             { return byteBudget;  }
+        float  GetTimeBudget()  const             { return timeBudget;  }
+        size_t GetSegmentSize() const             { return segmentSize; }
+
+        // Statistics.
+        float  GetThroughput()         const { return throughput;         } // In MB/s, over the last second.
+        float  GetLastFrameTime()      const { return lastFrameTime;      } // In ms.
+        int    GetHitchCount()         const { return hitchCount;         } // Frames that went over the time budget.
+        size_t GetTotalUploadedBytes() const { return totalUploadedBytes; }
+    };
+}
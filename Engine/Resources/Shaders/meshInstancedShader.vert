@@ -15,13 +15,35 @@ out mat3 tbnMatrix;
 uniform mat4 mvpMatrix;
 uniform mat4 modelMat;
 
+// Compact vertices have positions normalized in the bounds, octahedral normals and tangents, and a bitangent sign.
+uniform bool compactVertices;
+uniform vec3 boundsMin;
+uniform vec3 boundsSize;
+
+vec3 OctahedralDecode(vec2 encoded)
+{
+	vec3  direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold      = max(-direction.z, 0.0);
+	direction.xy   += vec2(direction.x >= 0.0 ? -fold : fold, direction.y >= 0.0 ? -fold : fold);
+	return normalize(direction);
+}
+
 void main()
 {
-	gl_Position    = mvpMatrix * instanceMatrix * vec4(aPos, 1.0);
-	FragPos        = (modelMat * instanceMatrix * vec4(aPos, 1.0)).xyz;
+	vec3 pos = aPos, normal = aNormal, tangent = aTangent, bitangent = aBitangent;
+	if (compactVertices)
+	{
+		pos       = boundsMin + aPos * boundsSize;
+		normal    = OctahedralDecode(aNormal.xy);
+		tangent   = OctahedralDecode(aTangent.xy);
+		bitangent = cross(normal, tangent) * aTangent.z;
+	}
+
+	gl_Position    = mvpMatrix * instanceMatrix * vec4(pos, 1.0);
+	FragPos        = (modelMat * instanceMatrix * vec4(pos, 1.0)).xyz;
 	TexCoords      = aTexCoord;
-	Normal         = normalize((modelMat * instanceMatrix * vec4(aNormal, 0.0))).xyz;
-	vec3 Tangent   = normalize(vec3(modelMat * instanceMatrix * vec4(aTangent,   0.0)));
-	vec3 Bitangent = normalize(vec3(modelMat * instanceMatrix * vec4(aBitangent, 0.0)));
+	Normal         = normalize((modelMat * instanceMatrix * vec4(normal, 0.0))).xyz;
+	vec3 Tangent   = normalize(vec3(modelMat * instanceMatrix * vec4(tangent,   0.0)));
+	vec3 Bitangent = normalize(vec3(modelMat * instanceMatrix * vec4(bitangent, 0.0)));
 	tbnMatrix      = mat3(Tangent, Bitangent, Normal);
 }
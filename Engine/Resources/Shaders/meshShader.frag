@@ -43,6 +43,7 @@ in mat3 tbnMatrix;
 // Textures to apply to the model.
 uniform sampler2D ambientTexture,    diffuseTexture,    specularTexture,    emissionTexture,    shininessMap,    alphaMap,    normalMap;
 uniform bool      useAmbientTexture, useDiffuseTexture, useSpecularTexture, useEmissionTexture, useShininessMap, useAlphaMap, useNormalMap;
+uniform bool      hasTangents; // Compact vertices don't have tangents when their material has no normal map.
 vec3              ambientTexVal,     diffuseTexVal,     specularTexVal,     emissionTexVal;
 
 // Material to apply to the model.
@@ -146,9 +147,11 @@ void main()
 
 	// Get normal from normal map.
 	vec3 normal = Normal;
-	if (useNormalMap)
+	if (useNormalMap && hasTangents)
 	{
-		normal = texture(normalMap, TexCoords).rgb * 2.0 - 1.0;
+		// Compressed normal maps only store x and y, so z is rebuilt from them.
+		normal.xy = texture(normalMap, TexCoords).rg * 2.0 - 1.0;
+		normal.z  = sqrt(max(1.0 - dot(normal.xy, normal.xy), 0.0));
 		normal = normalize(tbnMatrix * normal); // TODO: optimize this.
 	}
 
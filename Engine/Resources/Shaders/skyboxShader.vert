@@ -6,8 +6,14 @@ out vec3 TexCoords;
 
 uniform mat4 viewProjMat;
 
+// Compact vertices have positions normalized in the bounds.
+uniform bool compactVertices;
+uniform vec3 boundsMin;
+uniform vec3 boundsSize;
+
 void main()
 {
-    TexCoords = aPos;
-    gl_Position = viewProjMat * vec4(aPos, 1.0);
+    vec3 pos = (compactVertices ? boundsMin + aPos * boundsSize : aPos);
+    TexCoords = pos;
+    gl_Position = viewProjMat * vec4(pos, 1.0);
 }
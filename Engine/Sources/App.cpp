@@ -20,6 +20,8 @@
 #include "PyScript.h"
 #include "AsteroidRotation.h"
 #include "Cubemap.h"
+#include "LoadTimeline.h"
+#include "AssetCache.h"
 
 using namespace Core;
 using namespace Core::Physics;
@@ -110,6 +112,7 @@ App::App(const AppInitializer& init)
 
     // Set the app's log file.
     DebugSetAndClearLogFile("Logs/app.log");
+    LoadTimeline::SetThreadName("Main thread");
     Ui::SetAppPtr(this);
     Ui::FramebufferResizeCallback(init.width, init.height);
 
@@ -117,8 +120,19 @@ App::App(const AppInitializer& init)
     cameraManager.engineCamera = new EngineCamera({ GetWindowW(), GetWindowH(), 0.1f, 1000.f, 80.f });
     cameraManager.screenScaleCameras.push_back(cameraManager.engineCamera);
 
-    // Create the resource manager's texture sampler.
+    // Textures are block compressed when the driver supports S3TC.
+    if (!GLAD_GL_EXT_texture_compression_s3tc) {
+        DebugLogWarning("S3TC texture compression isn't supported, textures will be uploaded uncompressed.");
+        Texture::SetCompressionEnabled(false);
+    }
+
+    // Create the resource manager's texture sampler and upload streamer.
     resourceManager.CreateSampler();
+    resourceManager.CreateUploadStreamer();
+    if (init.uploadThread)
+        resourceManager.CreateGpuUploader(window);
+    if (init.hotReload)
+        resourceManager.hotReloader.Start();
 
     // Maximize the window.
     if (init.maximized)
@@ -157,6 +171,8 @@ void App::InitPyInterpreter()
 
 App::~App()
 {
+    if (benchmarkThread.joinable())
+        benchmarkThread.join();
     delete cameraManager.engineCamera;
     DebugSaveLogFile();
     sceneGraph.~SceneGraph(); // Destroy all objects before stopping the Python interpreter.
@@ -174,6 +190,8 @@ void App::Run()
         if (time.CanStartNextFrame()) 
         {
             SendLoadedResources();
+            DynamicTexture::UpdateTextures();
+            UpdateLoadPriorities();
             if (!chronoHasEnded)
             {
                 if (resourceManager.AreAllResourcesInOpenGL() && !isInBenchmark)
@@ -187,11 +205,25 @@ void App::Run()
                 }
             }
             Render();
+            resourceManager.EvictResources();
         }
     }
 
-    // Destroy the thread manager first to kill all threads before unallocating any memory.
-    resourceManager.threadManager.~ThreadManager();
+    // Let the running benchmark end, then stop the thread manager to kill all threads before unallocating any memory.
+    if (benchmarkThread.joinable()) {
+        if (benchmarkRunning)
+            DebugLog("Waiting for the running benchmark to end.");
+        benchmarkThread.join();
+    }
+    StopLoading();
+    SceneModel::ReleaseDrawBuffers();
+    resourceManager.hotReloader.Stop();
+    resourceManager.threadManager.Stop();
+    if (GpuUploader* uploader = ResourceManager::GetGpuUploader())
+        uploader->Stop();
+
+    // Write the assets that are still queued for the cache, and its index.
+    AssetCache::Shutdown();
 }
 
 
@@ -365,6 +397,10 @@ void App::Render()
         shouldReloadScene = false;
     }
 
+    // Reload the resources and scene when the rendering benchmark changes the index optimization.
+    if (shouldReloadAll && ReloadAll())
+        shouldReloadAll = false;
+
     // Reload the Python scripts if necessary.
     if (inputs.reloadPyScripts && !inPlayMode) {
         pybind11::finalize_interpreter();
@@ -381,7 +417,17 @@ void App::RenderEditor()
 
     // Draw all scene objects.
     bool shouldUpdateScripts = inPlayMode && !playModePaused && resourceManager.AreAllResourcesLoaded();
+    if (IsInRenderBenchmark())
+        RenderBenchmark();
+    const bool timeDraws = IsInRenderBenchmark() && !shouldReloadAll && resourceManager.AreAllResourcesInOpenGL() && drawTimeQueryPasses[drawTimeQueryIndex] < 0;
+    if (timeDraws)
+        glBeginQuery(GL_TIME_ELAPSED, drawTimeQueries[drawTimeQueryIndex]);
     sceneGraph.UpdateAndDrawAll(*camera, lightManager, !shouldUpdateScripts);
+    if (timeDraws) {
+        glEndQuery(GL_TIME_ELAPSED);
+        drawTimeQueryPasses[drawTimeQueryIndex] = renderBenchmarkPass;
+        drawTimeQueryIndex = (drawTimeQueryIndex + 1) % DrawTimeQueryCount;
+    }
 
     // Update engine camera transform.
     if (!inSceneView)
@@ -477,9 +523,14 @@ void App::LoadDefaultResources()
 
 void App::LoadResources()
 {
+    LoadTimeline::Clear();
+    loadingBegin            = std::chrono::steady_clock::now();
+    firstUsefulFrameReached = false;
     LoadDefaultResources();
 
-    std::thread t{ [&]() {
+    if (loaderThread.joinable())
+        loaderThread.join();
+    loaderThread = std::thread{ [&]() {
             if(!isInBenchmark)
                 begin = std::chrono::steady_clock::now();
 
@@ -527,44 +578,101 @@ void App::LoadResources()
             resourceManager.Create<ObjFile>("Resources/Assets/MercuryPlanet/Mercury 1K.obj");
         }
     };
-    t.detach();
 }
 
 void App::SendLoadedResources()
 {
-    bool textureSentThisFrame = false;
     resourceManager.CheckForNewPyResources();
 
-    // Find resources that just finished loading and send their data to openGL.
-    std::unordered_map<std::string, IResource*>& resources = resourceManager.GetResources();
-    for (std::unordered_map<std::string, IResource*>::iterator it = resources.begin(); it != resources.end(); it++)
+    // Uploads are spread over multiple frames to stay within the streamer's budget.
+    UploadStreamer* streamer = ResourceManager::GetUploadStreamer();
+    if (streamer != nullptr)
+        streamer->BeginFrame();
+
+    // Only check the resources that changed state since the last frame, after the ones that couldn't be sent yet.
+    std::vector<ResourceHandle<IResource>> changedResources;
+    changedResources.swap(resourcesToSend);
+    resourceManager.PopChangedResources(changedResources);
+    for (const ResourceHandle<IResource>& handle : changedResources)
     {
-        if (it->second->WasSentToOpenGL() || (textureSentThisFrame && it->second->GetType() == ResourceTypes::Texture))
+        IResource* resource = handle;
+        if (resource == nullptr || resource->WasSentToOpenGL())
             continue;
 
         // For mesh resources, send each sub-mesh to openGL.
-        if (it->second->GetType() == ResourceTypes::Mesh) {
+        ScopedLoadPhase uploadPhase(resource->GetName(), LoadPhase::Upload);
+        bool subMeshesPending = false;
+        if (resource->GetType() == ResourceTypes::Mesh) {
             SubMesh* subMesh = nullptr;
-            for (int i = 0; i < ((Mesh*)it->second)->subMeshes.size(); ++i) {
-                subMesh = ((Mesh*)it->second)->subMeshes[i];
-                if (subMesh->IsLoaded() && !subMesh->WasSentToOpenGL())
+            for (int i = 0; i < ((Mesh*)resource)->subMeshes.size(); ++i) {
+                subMesh = ((Mesh*)resource)->subMeshes[i];
+                if (subMesh->IsLoaded() && !subMesh->WasSentToOpenGL()) {
                     subMesh->SendVerticesToOpenGL(sceneGraph.totalVertexCount);
+                    subMeshesPending |= !subMesh->WasSentToOpenGL() && !subMesh->GetVertices().empty();
+                }
             }
         }
 
         // Send the resource to openGL.
-        if (it->second->IsLoaded() && !it->second->WasSentToOpenGL()) {
-            it->second->SendToOpenGL();
-            if (it->second->GetType() == ResourceTypes::Texture)
-                textureSentThisFrame = true;
+        if (resource->IsLoaded())
+            resource->SendToOpenGL();
+
+        // Try again next frame if it is partially uploaded or depends on resources that aren't in openGL yet (shader programs for example).
+        if (subMeshesPending || (resource->IsLoaded() && !resource->WasSentToOpenGL()))
+            resourcesToSend.push_back(handle);
+    }
+
+    // Swap the resources that were reloaded because their file was modified.
+    resourceManager.hotReloader.Update(sceneGraph.totalVertexCount);
+
+    if (streamer != nullptr)
+        streamer->EndFrame();
+}
+
+void App::UpdateLoadPriorities()
+{
+    if (firstUsefulFrameReached && resourceManager.threadManager.GetQueuedTaskCount() <= 0)
+        return;
+
+    // Get the camera currently in use.
+    Camera* camera = (state == AppStates::Editor && !inSceneView ? cameraManager.engineCamera : cameraManager.sceneCamera);
+    if (camera == nullptr)
+        return;
+
+    // Load the resources of the biggest models on screen first, re-evaluated every frame as the camera moves.
+    std::unordered_map<std::string, float> meshPriorities;
+    const bool visibleModelsLoaded = sceneGraph.EvaluateLoadPriorities(*camera, meshPriorities);
+    resourceManager.SetLoadPriorities(meshPriorities);
+
+    if (visibleModelsLoaded && !firstUsefulFrameReached)
+    {
+        firstUsefulFrameReached = true;
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - loadingBegin;
+        if (isInBenchmark) {
+            firstUsefulFrameTotalNs += elapsed.count();
+        }
+        else {
+            std::string strTime = "Time to first useful frame : ";
+            strTime += std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+            strTime += " ms \n";
+            DebugLog(strTime);
         }
     }
 }
 
+void App::StopLoading()
+{
+    // Cancel the queued and running loads, then wait for the resource creation thread.
+    resourceManager.CancelLoads();
+    if (loaderThread.joinable())
+        loaderThread.join();
+}
+
 bool App::UnloadResources()
 {
     sceneGraph.totalVertexCount = 0;
     chronoHasEnded = false;
+    StopLoading();
     return resourceManager.Reset();
 }
 
@@ -771,6 +879,8 @@ void App::Benchmark()
     {
         chronoStarted = true;
         shouldReloadScene = true;
+        firstUsefulFrameTotalNs = 0;
+        ObjFile::ClearCache();
         begin = std::chrono::steady_clock::now();
     }
 
@@ -784,6 +894,37 @@ void App::Benchmark()
             strTime += std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>((end - begin) / maxLoad).count());
             strTime += " ms \n";
             DebugLog(strTime);
+
+            strTime = "Cold load (parsing obj files) : ";
+            strTime += std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(coldLoadEnd - begin).count());
+            strTime += " ms, average warm load (mesh cache) : ";
+            strTime += std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>((end - coldLoadEnd) / std::max(maxLoad - 1, 1)).count());
+            strTime += " ms \n";
+            DebugLog(strTime);
+
+            // VRAM saved by the block compression of the textures.
+            size_t textureBytes = 0, uncompressedTextureBytes = 0;
+            resourceManager.ForEachResource([&](const std::string& name, IResource* resource) {
+                if (resource->GetType() != ResourceTypes::Texture)
+                    return;
+                textureBytes             += ((Texture*)resource)->GetGpuBytes();
+                uncompressedTextureBytes += ((Texture*)resource)->GetUncompressedGpuBytes();
+            });
+            strTime = "Texture memory : ";
+            strTime += std::to_string(textureBytes >> 20) + " MB (" + std::to_string(uncompressedTextureBytes >> 20) + " MB uncompressed, textures are ";
+            strTime += std::string(Texture::CompressionEnabled() ? "" : "not ") + "compressed) \n";
+            DebugLog(strTime);
+
+            strTime = "Average time to first useful frame : ";
+            strTime += std::to_string(firstUsefulFrameTotalNs / maxLoad / 1000000);
+            strTime += " ms \n";
+            DebugLog(strTime);
+
+            // Export the timeline of the last load.
+            if (LoadTimeline::ExportChromeTrace("LoadingTrace.json"))
+                DebugLog("Loading timeline exported to LoadingTrace.json (open it in chrome://tracing or Perfetto).");
+            else
+                DebugLogWarning("Unable to export the loading timeline.");
     
             cptLoad = 0;
             isInBenchmark = false;
@@ -792,12 +933,98 @@ void App::Benchmark()
         }
         else
         {
+            // The cold load ends once its cache writes are done, so that the warm loads read them.
+            if (cptLoad == 1) {
+                AssetCache::Flush();
+                coldLoadEnd = std::chrono::steady_clock::now();
+            }
             shouldReloadScene = true;
         }
     }
 
 }
 
+bool App::StartBenchmarkTask(const std::function<void()>& benchmark)
+{
+    if (benchmarkRunning)
+        return false;
+    if (benchmarkThread.joinable())
+        benchmarkThread.join();
+    benchmarkRunning = true;
+    benchmarkThread  = std::thread([this, benchmark]()
+    {
+        benchmark();
+        benchmarkRunning = false;
+    });
+    return true;
+}
+
+void App::StartRenderBenchmark()
+{
+    if (IsInRenderBenchmark())
+        return;
+    glGenQueries(DrawTimeQueryCount, drawTimeQueries);
+    for (int i = 0; i < DrawTimeQueryCount; i++)
+        drawTimeQueryPasses[i] = -1;
+    drawTimeQueryIndex = 0;
+    drawTimeFrames [0] = drawTimeFrames [1] = 0;
+    drawTimeTotalNs[0] = drawTimeTotalNs[1] = 0;
+    renderBenchmarkPass      = 0;
+    indexOptimizationSetting = SubMesh::IndexOptimization();
+
+    // Reload the meshes with their triangles in the obj files' order (the mesh cache keeps both orders apart).
+    SubMesh::SetIndexOptimization(false);
+    shouldReloadAll = true;
+}
+
+void App::RenderBenchmark()
+{
+    // Read the draw times of the previous frames that are available, without waiting for the GPU.
+    // Results of the previous pass that arrive late are dropped.
+    for (int i = 0; i < DrawTimeQueryCount; i++)
+    {
+        if (drawTimeQueryPasses[i] < 0)
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(drawTimeQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+        GLuint64 drawTimeNs = 0;
+        glGetQueryObjectui64v(drawTimeQueries[i], GL_QUERY_RESULT, &drawTimeNs);
+        const int pass = drawTimeQueryPasses[i];
+        drawTimeQueryPasses[i] = -1;
+        if (pass == renderBenchmarkPass && drawTimeFrames[pass] < renderBenchmarkFrameCount) {
+            drawTimeTotalNs[pass] += drawTimeNs;
+            drawTimeFrames [pass]++;
+        }
+    }
+    if (drawTimeFrames[renderBenchmarkPass] < renderBenchmarkFrameCount)
+        return;
+
+    // Reload the meshes with optimized triangles and vertices.
+    if (renderBenchmarkPass == 0)
+    {
+        renderBenchmarkPass = 1;
+        SubMesh::SetIndexOptimization(true);
+        shouldReloadAll = true;
+        return;
+    }
+
+    const double unoptimizedMs = drawTimeTotalNs[0] * 1e-6 / renderBenchmarkFrameCount;
+    const double optimizedMs   = drawTimeTotalNs[1] * 1e-6 / renderBenchmarkFrameCount;
+    DebugLog("Rendering benchmark (" + std::to_string(renderBenchmarkFrameCount) + " frames): average draw time "
+             + std::to_string(unoptimizedMs) + " ms without index optimization, " + std::to_string(optimizedMs) + " ms with it ("
+             + std::to_string(optimizedMs > 0 ? unoptimizedMs / optimizedMs : 0) + "x).");
+
+    glDeleteQueries(DrawTimeQueryCount, drawTimeQueries);
+    for (int i = 0; i < DrawTimeQueryCount; i++) {
+        drawTimeQueries    [i] = 0;
+        drawTimeQueryPasses[i] = -1;
+    }
+    renderBenchmarkPass = -1;
+    SubMesh::SetIndexOptimization(indexOptimizationSetting);
+}
+
 void App::LoadBenchmark()
 {
     LoadResources();
@@ -0,0 +1,422 @@
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#include "Debug.h"
+#include "LoadTimeline.h"
+#include "AssetCache.h"
+using namespace Core;
+
+
+// Header of the cache entry files, followed by the processed data of their asset.
+// It is 32 bytes long so the data stays aligned for the importers that read it in place.
+struct AssetCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint64_t dataSize;
+    uint64_t padding;
+};
+static constexpr uint32_t AssetCacheFormatVersion = 1;
+
+// Header of the index file, followed by the entries and the names of their importers.
+struct AssetCacheIndexHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t useClock;
+    uint64_t entryCount;
+};
+struct AssetCacheIndexEntry
+{
+    uint64_t hash, bytes, lastUse;
+    uint64_t importerSize;
+};
+static const char* IndexName = "index.dat";
+
+std::mutex                                     AssetCache::mutex;
+std::condition_variable                        AssetCache::writeCondition;
+std::condition_variable                        AssetCache::idleCondition;
+std::unordered_map<uint64_t, AssetCache::Entry> AssetCache::entries;
+std::deque<AssetCache::PendingWrite>           AssetCache::pendingWrites;
+size_t                                         AssetCache::pendingBytes = 0;
+uint64_t                                       AssetCache::totalBytes   = 0;
+uint64_t                                       AssetCache::useClock     = 0;
+std::atomic<uint64_t>                          AssetCache::sizeCap      = AssetCache::DefaultSizeCap;
+std::thread                                    AssetCache::writer;
+bool AssetCache::writing = false, AssetCache::stopWriter = false, AssetCache::indexLoaded = false, AssetCache::indexDirty = false;
+
+
+
+// ----- Asset Cache Key ----- //
+
+AssetCacheKey::AssetCacheKey(const std::string& _source, const std::string& _importer, const uint32_t& _importerVersion, const uint64_t& _settings)
+    : source(_source), importer(_importer), importerVersion(_importerVersion), settings(_settings)
+{
+    std::error_code sizeError, timeError;
+    sourceSize = (uint64_t)std::filesystem::file_size(source, sizeError);
+    sourceTime = (int64_t)std::filesystem::last_write_time(source, timeError).time_since_epoch().count();
+    valid      = !sizeError && !timeError;
+}
+
+uint64_t AssetCacheKey::GetHash() const
+{
+    // FNV-1a, which unlike std::hash gives the same entry names in all builds.
+    uint64_t hash = 14695981039346656037ull;
+    auto addBytes = [&hash](const void* bytes, const size_t& size)
+    {
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ ((const unsigned char*)bytes)[i]) * 1099511628211ull;
+    };
+    addBytes(source  .c_str(), source  .size() + 1);
+    addBytes(importer.c_str(), importer.size() + 1);
+    addBytes(&importerVersion, sizeof(importerVersion));
+    addBytes(&settings,        sizeof(settings));
+    addBytes(&sourceSize,      sizeof(sourceSize));
+    addBytes(&sourceTime,      sizeof(sourceTime));
+    return hash;
+}
+
+
+
+// ----- Cached Asset ----- //
+
+bool CachedAsset::Open(const AssetCacheKey& key)
+{
+    Close();
+    if (!key.valid)
+        return false;
+    const uint64_t hash = key.GetHash();
+    if (!file.Open(AssetCache::GetEntryName(hash)))
+        return false;
+
+    // Entries of another format or truncated ones are ignored, they are replaced once the asset is imported again.
+    const AssetCacheHeader* header = (const AssetCacheHeader*)file.GetData();
+    if (file.GetSize() < sizeof(AssetCacheHeader) || std::memcmp(header->magic, "ASST", 4) != 0 || header->version != AssetCacheFormatVersion
+        || header->hash != hash || header->dataSize != file.GetSize() - sizeof(AssetCacheHeader))
+    {
+        file.Close();
+        return false;
+    }
+    data = file.GetData() + sizeof(AssetCacheHeader);
+    size = (size_t)header->dataSize;
+    AssetCache::Touch(hash);
+    return true;
+}
+
+void CachedAsset::Close()
+{
+    file.Close();
+    data = nullptr;
+    size = 0;
+}
+
+
+
+// ----- Asset Cache ----- //
+
+std::string AssetCache::GetEntryName(const uint64_t& hash)
+{
+    char entryName[32];
+    std::snprintf(entryName, sizeof(entryName), "%016llx.asset", (unsigned long long)hash);
+    return std::string(Directory) + "/" + entryName;
+}
+
+void AssetCache::LoadIndex()
+{
+    indexLoaded = true;
+    std::error_code error;
+    std::filesystem::create_directory(Directory, error);
+
+    // Read the importer and last use of the entries.
+    std::unordered_map<uint64_t, Entry> indexedEntries;
+    if (FILE* f = fopen((std::string(Directory) + "/" + IndexName).c_str(), "rb"))
+    {
+        AssetCacheIndexHeader header;
+        if (fread(&header, sizeof(header), 1, f) == 1 && std::memcmp(header.magic, "AIDX", 4) == 0 && header.version == AssetCacheFormatVersion)
+        {
+            useClock = header.useClock;
+            AssetCacheIndexEntry indexEntry;
+            for (uint64_t i = 0; i < header.entryCount && fread(&indexEntry, sizeof(indexEntry), 1, f) == 1 && indexEntry.importerSize < 256; i++)
+            {
+                Entry& entry = indexedEntries[indexEntry.hash];
+                entry.importer.resize((size_t)indexEntry.importerSize);
+                if (indexEntry.importerSize > 0 && fread(&entry.importer[0], 1, (size_t)indexEntry.importerSize, f) != indexEntry.importerSize)
+                    break;
+                entry.lastUse = indexEntry.lastUse;
+            }
+        }
+        fclose(f);
+    }
+
+    // The entries are the files of the directory, the ones missing from the index are collected first.
+    // Interrupted writes and the files of the caches that were keyed by path only are removed.
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(Directory, error))
+    {
+        const std::filesystem::path& path      = file.path();
+        const std::string            extension = path.extension().string();
+        if (extension == ".tmp" || extension == ".bin" || extension == ".mesh") {
+            std::filesystem::remove(path, error);
+            continue;
+        }
+        if (extension != ".asset")
+            continue;
+
+        const uint64_t hash  = std::strtoull(path.stem().string().c_str(), nullptr, 16);
+        const uint64_t bytes = (uint64_t)file.file_size(error);
+        if (error)
+            continue;
+        Entry& entry = entries[hash];
+        std::unordered_map<uint64_t, Entry>::iterator indexed = indexedEntries.find(hash);
+        if (indexed != indexedEntries.end())
+            entry = indexed->second;
+        entry.bytes = bytes;
+        totalBytes += bytes;
+    }
+    indexDirty = true;
+    CollectGarbage(0);
+}
+
+void AssetCache::SaveIndex()
+{
+    const std::string indexName = std::string(Directory) + "/" + IndexName;
+    FILE* f = fopen(indexName.c_str(), "wb");
+    if (f == nullptr)
+        return;
+    AssetCacheIndexHeader header;
+    std::memcpy(header.magic, "AIDX", 4);
+    header.version    = AssetCacheFormatVersion;
+    header.useClock   = useClock;
+    header.entryCount = entries.size();
+    fwrite(&header, sizeof(header), 1, f);
+    for (const std::pair<const uint64_t, Entry>& entry : entries)
+    {
+        const AssetCacheIndexEntry indexEntry = { entry.first, entry.second.bytes, entry.second.lastUse, entry.second.importer.size() };
+        fwrite(&indexEntry, sizeof(indexEntry), 1, f);
+        fwrite(entry.second.importer.data(), 1, entry.second.importer.size(), f);
+    }
+    fclose(f);
+    indexDirty = false;
+}
+
+void AssetCache::WriterLife()
+{
+    LoadTimeline::SetThreadName("Cache writer");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        writeCondition.wait(lock, []() { return stopWriter || !pendingWrites.empty(); });
+        if (pendingWrites.empty())
+            break;
+
+        // Write the entry without holding the lock, so loading threads can keep reading and queueing entries.
+        PendingWrite write = std::move(pendingWrites.front());
+        pendingWrites.pop_front();
+        writing = true;
+        lock.unlock();
+        const bool written = WriteEntry(write);
+        lock.lock();
+        writing       = false;
+        pendingBytes -= write.data.size();
+
+        if (written)
+        {
+            Entry& entry = entries[write.hash];
+            totalBytes -= entry.bytes;
+            entry.importer = write.importer;
+            entry.bytes    = sizeof(AssetCacheHeader) + write.data.size();
+            entry.lastUse  = ++useClock;
+            totalBytes += entry.bytes;
+            indexDirty  = true;
+            CollectGarbage(write.hash);
+        }
+        if (pendingWrites.empty() && indexDirty)
+            SaveIndex();
+        idleCondition.notify_all();
+    }
+}
+
+bool AssetCache::WriteEntry(const PendingWrite& write)
+{
+    // Write to a temporary file that replaces the entry once complete, so loading threads never map it half written.
+    std::error_code error;
+    std::filesystem::create_directory(Directory, error);
+    const std::string entryName = GetEntryName(write.hash);
+    const std::string tempName  = entryName + ".tmp";
+    FILE* f = fopen(tempName.c_str(), "wb");
+    if (f == nullptr) {
+        DebugLogWarning("Unable to write asset cache entry " + entryName);
+        return false;
+    }
+    AssetCacheHeader header = {};
+    std::memcpy(header.magic, "ASST", 4);
+    header.version  = AssetCacheFormatVersion;
+    header.hash     = write.hash;
+    header.dataSize = write.data.size();
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(write.data.data(), 1, write.data.size(), f);
+    const bool written = (ferror(f) == 0);
+    fclose(f);
+
+    std::filesystem::rename(tempName, entryName, error);
+    if (!written || error) {
+        std::filesystem::remove(tempName, error);
+        DebugLogWarning("Unable to write asset cache entry " + entryName);
+        return false;
+    }
+    return true;
+}
+
+void AssetCache::CollectGarbage(const uint64_t& keptHash)
+{
+    if (totalBytes <= sizeCap.load())
+        return;
+
+    // Remove the least recently used entries until the cache fits in its cap, except the one that was just written.
+    std::vector<std::pair<uint64_t, uint64_t>> entriesByUse;
+    for (const std::pair<const uint64_t, Entry>& entry : entries)
+        if (entry.first != keptHash)
+            entriesByUse.push_back({ entry.second.lastUse, entry.first });
+    std::sort(entriesByUse.begin(), entriesByUse.end());
+
+    size_t removedCount = 0;
+    const uint64_t previousBytes = totalBytes;
+    for (const std::pair<uint64_t, uint64_t>& entry : entriesByUse)
+    {
+        if (totalBytes <= sizeCap.load())
+            break;
+
+        // Entries mapped by a loading asset can't be removed on Windows, they are kept until the next collection.
+        std::error_code error;
+        std::filesystem::remove(GetEntryName(entry.second), error);
+        if (error)
+            continue;
+        totalBytes -= entries[entry.second].bytes;
+        entries.erase(entry.second);
+        removedCount++;
+    }
+    if (removedCount > 0) {
+        indexDirty = true;
+        DebugLog("Asset cache: removed " + std::to_string(removedCount) + " least recently used entries (" + std::to_string((previousBytes - totalBytes) >> 20) + " MB).");
+    }
+}
+
+void AssetCache::Touch(const uint64_t& hash)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!indexLoaded)
+        LoadIndex();
+    std::unordered_map<uint64_t, Entry>::iterator entry = entries.find(hash);
+    if (entry != entries.end()) {
+        entry->second.lastUse = ++useClock;
+        indexDirty = true;
+    }
+}
+
+void AssetCache::Write(const AssetCacheKey& key, std::vector<char>&& data)
+{
+    if (!key.valid || data.empty())
+        return;
+    const uint64_t hash = key.GetHash();
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!indexLoaded)
+        LoadIndex();
+
+    // Don't let the queue grow if the disk can't keep up, the asset will just be imported again next time.
+    for (const PendingWrite& write : pendingWrites)
+        if (write.hash == hash)
+            return;
+    if (pendingBytes + data.size() > MaxPendingBytes) {
+        DebugLogWarning("Asset cache writes are too far behind, " + key.source + " won't be cached.");
+        return;
+    }
+    pendingBytes += data.size();
+    pendingWrites.push_back({ hash, key.importer, std::move(data) });
+
+    // Start the writer thread on the first write.
+    if (!writer.joinable()) {
+        stopWriter = false;
+        writer = std::thread(WriterLife);
+    }
+    writeCondition.notify_one();
+}
+
+void AssetCache::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idleCondition.wait(lock, []() { return pendingWrites.empty() && !writing; });
+}
+
+void AssetCache::Clear(const std::string& importer)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!indexLoaded)
+        LoadIndex();
+
+    // Drop the queued writes of the importer and wait for the current one, so no entry is written after being cleared.
+    for (std::deque<PendingWrite>::iterator write = pendingWrites.begin(); write != pendingWrites.end();)
+    {
+        if (importer.empty() || write->importer == importer) {
+            pendingBytes -= write->data.size();
+            write = pendingWrites.erase(write);
+        }
+        else {
+            write++;
+        }
+    }
+    idleCondition.wait(lock, []() { return !writing; });
+
+    for (std::unordered_map<uint64_t, Entry>::iterator entry = entries.begin(); entry != entries.end();)
+    {
+        std::error_code error;
+        if (!importer.empty() && entry->second.importer != importer) {
+            entry++;
+            continue;
+        }
+        std::filesystem::remove(GetEntryName(entry->first), error);
+        if (error) {
+            entry++;
+            continue;
+        }
+        totalBytes -= entry->second.bytes;
+        entry = entries.erase(entry);
+    }
+    SaveIndex();
+}
+
+void AssetCache::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopWriter = true;
+    }
+    writeCondition.notify_all();
+    if (writer.joinable())
+        writer.join();
+
+    std::lock_guard<std::mutex> guard(mutex);
+    if (indexLoaded && indexDirty)
+        SaveIndex();
+}
+
+void AssetCache::SetSizeCap(const uint64_t& bytes)
+{
+    sizeCap.store(bytes);
+    std::lock_guard<std::mutex> guard(mutex);
+    if (indexLoaded)
+        CollectGarbage(0);
+}
+
+uint64_t AssetCache::GetTotalBytes()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return totalBytes;
+}
+
+size_t AssetCache::GetEntryCount()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return entries.size();
+}
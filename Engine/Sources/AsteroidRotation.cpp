@@ -1,6 +1,7 @@
 #include "AsteroidRotation.h"
 #include "SceneNode.h"
 #include "TimeManager.h"
+#include "JobSystem.h"
 using namespace Maths;
 
 void Scenes::AsteroidRotation::Start()
@@ -17,14 +18,17 @@ void Scenes::AsteroidRotation::Start()
 
 void Scenes::AsteroidRotation::Update()
 {
-	for (int i = 0; i < instancedModel->instanceCount; i++)
+	// Every instance is independent, so they are updated in parallel.
+	const Vector3 origin    = transform->GetPosition();
+	const float   deltaTime = time->DeltaTime();
+	Core::JobSystem::Get()->ParallelFor(0, (size_t)instancedModel->instanceCount, 256, [this, &origin, &deltaTime](const size_t& i)
 	{
-		instancedModel->instanceTransforms[i].Rotate(Vector3(0, 1, 0) * selfRotationSpeed[i] * time->DeltaTime());
+		instancedModel->instanceTransforms[i].Rotate(Vector3(0, 1, 0) * selfRotationSpeed[i] * deltaTime);
 
-		Vector3 originToPos = Vector3(transform->GetPosition(), instancedModel->instanceTransforms[i].GetPosition()); originToPos.y = 0;
-		originToPos.rotate(Vector3(0, 1, 0) * originRotationSpeed[i] * time->DeltaTime());
-		Vector3 newPos = transform->GetPosition() + originToPos; newPos.y = instancedModel->instanceTransforms[i].GetPosition().y;
+		Vector3 originToPos = Vector3(origin, instancedModel->instanceTransforms[i].GetPosition()); originToPos.y = 0;
+		originToPos.rotate(Vector3(0, 1, 0) * originRotationSpeed[i] * deltaTime);
+		Vector3 newPos = origin + originToPos; newPos.y = instancedModel->instanceTransforms[i].GetPosition().y;
 		instancedModel->instanceTransforms[i].SetPosition(newPos);
-	}
+	});
 	instancedModel->UpdateMatrixBuffer();
 }
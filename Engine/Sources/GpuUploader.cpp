@@ -0,0 +1,126 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "Debug.h"
+#include "GpuUploader.h"
+#include "LoadTimeline.h"
+using namespace Resources;
+
+
+GpuUploader::GpuUploader(GLFWwindow* sharedWindow)
+{
+    // Create an invisible window whose context shares the main window's objects.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "Upload context", nullptr, sharedWindow);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (context == nullptr) {
+        DebugLogWarning("Unable to create the upload context, resources will be uploaded by the render thread.");
+        return;
+    }
+    thread = std::thread(&GpuUploader::ThreadLife, this);
+}
+
+GpuUploader::~GpuUploader()
+{
+    Stop();
+    if (context != nullptr)
+        glfwDestroyWindow(context);
+}
+
+void GpuUploader::ThreadLife()
+{
+    glfwMakeContextCurrent(context);
+    Core::LoadTimeline::SetThreadName("Upload thread");
+
+    while (true)
+    {
+        // Wait for a task to be submitted.
+        std::pair<std::shared_ptr<GpuUpload>, std::function<void()>> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskCondition.wait(lock, [this]() { return stopThread.load() || !tasks.empty(); });
+            if (stopThread.load())
+                break;
+            task = tasks.front();
+            tasks.pop_front();
+        }
+
+        // Execute it and fence its commands so the render thread knows when they are done.
+        task.second();
+        task.first->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            task.first->done.store(true);
+        }
+        doneCondition.notify_all();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+std::shared_ptr<GpuUpload> GpuUploader::Submit(const std::function<void()>& task)
+{
+    std::shared_ptr<GpuUpload> upload = std::make_shared<GpuUpload>();
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (stopThread.load() || !thread.joinable())
+            upload->done.store(true);
+        else
+            tasks.push_back({ upload, task });
+    }
+    taskCondition.notify_one();
+    return upload;
+}
+
+bool GpuUploader::IsReady(const std::shared_ptr<GpuUpload>& upload)
+{
+    if (!upload->done.load())
+        return false;
+    if (upload->fence == nullptr)
+        return true;
+
+    GLenum status = glClientWaitSync((GLsync)upload->fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    glDeleteSync((GLsync)upload->fence);
+    upload->fence = nullptr;
+    return true;
+}
+
+void GpuUploader::Release(std::shared_ptr<GpuUpload>& upload)
+{
+    if (upload == nullptr)
+        return;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [&upload]() { return upload->done.load(); });
+    }
+    if (upload->fence != nullptr)
+        glDeleteSync((GLsync)upload->fence);
+    upload = nullptr;
+}
+
+void GpuUploader::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopThread.store(true);
+    }
+    taskCondition.notify_all();
+    if (thread.joinable())
+        thread.join();
+
+    // Mark the dropped uploads as done so nothing waits on them.
+    std::lock_guard<std::mutex> guard(mutex);
+    for (auto& task : tasks)
+        task.first->done.store(true);
+    tasks.clear();
+    doneCondition.notify_all();
+}
+
+int GpuUploader::GetQueuedTaskCount()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return (int)tasks.size();
+}
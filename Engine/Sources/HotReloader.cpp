@@ -0,0 +1,260 @@
+#include <chrono>
+#include <stdexcept>
+
+#include "Debug.h"
+#include "HotReloader.h"
+#include "ResourceManager.h"
+using namespace Resources;
+
+
+HotReloader::HotReloader(ResourceManager& _resourceManager)
+    : resourceManager(_resourceManager)
+{
+}
+
+HotReloader::~HotReloader()
+{
+    Stop();
+}
+
+void HotReloader::Start()
+{
+    if (IsRunning())
+        return;
+    stopThread.store(false);
+    thread = std::thread(&HotReloader::ThreadLife, this);
+}
+
+void HotReloader::Stop()
+{
+    if (IsRunning())
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopThread.store(true);
+        }
+        sleepCondition.notify_all();
+        thread.join();
+    }
+
+    // Cancel the reloads in progress.
+    for (auto& it : reloads)
+    {
+        it.second.copy->CancelLoading();
+        resourceManager.threadManager.GetJobSystem().Cancel(it.second.job);
+        it.second.job.Wait();
+        it.second.copy->GetLoadingJob().Wait();
+        DeleteCopy(it.second.copy);
+    }
+    reloads.clear();
+    std::lock_guard<std::mutex> guard(modifiedMutex);
+    modifiedFiles.clear();
+}
+
+void HotReloader::ThreadLife()
+{
+    while (!stopThread.load())
+    {
+        // Get the files of the loaded resources that can be reloaded.
+        std::vector<std::pair<std::string, ResourceTypes>> files;
+        while (resourceManager.resourceLock.test_and_set()) {}
+        for (auto& it : resourceManager.resources)
+        {
+            switch (it.second->GetType())
+            {
+            case ResourceTypes::VertexShader:
+            case ResourceTypes::FragmentShader:
+            case ResourceTypes::ComputeShader:
+            case ResourceTypes::Texture:
+            case ResourceTypes::ObjFile:
+                if (it.second->IsLoaded())
+                    files.push_back({ it.first, it.second->GetType() });
+                break;
+            default:
+                break;
+            }
+        }
+        resourceManager.resourceLock.clear();
+
+        // Compare their modification time with the one of the previous check.
+        std::vector<std::pair<std::string, ResourceTypes>> modified;
+        for (const std::pair<std::string, ResourceTypes>& file : files)
+        {
+            std::error_code error;
+            std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(file.first, error);
+            if (error)
+                continue;
+
+            std::unordered_map<std::string, WatchedFile>::iterator watched = watchedFiles.find(file.first);
+            if (watched == watchedFiles.end()) {
+                watchedFiles[file.first] = { writeTime, false };
+                continue;
+            }
+            if (watched->second.writeTime != writeTime) {
+                watched->second = { writeTime, true };
+                continue;
+            }
+            if (watched->second.modified) {
+                watched->second.modified = false;
+                modified.push_back(file);
+            }
+        }
+        if (!modified.empty()) {
+            std::lock_guard<std::mutex> guard(modifiedMutex);
+            modifiedFiles.insert(modifiedFiles.end(), modified.begin(), modified.end());
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait_for(lock, std::chrono::milliseconds(CheckIntervalMs), [this]() { return stopThread.load(); });
+    }
+}
+
+void HotReloader::Update(size_t& totalVertexCount)
+{
+    // Start reloading the modified files.
+    std::vector<std::pair<std::string, ResourceTypes>> modified;
+    {
+        std::lock_guard<std::mutex> guard(modifiedMutex);
+        modified.swap(modifiedFiles);
+    }
+    for (const std::pair<std::string, ResourceTypes>& file : modified)
+    {
+        // Files modified again while they are reloading are reloaded from the start.
+        std::unordered_map<std::string, Reload>::iterator previous = reloads.find(file.first);
+        if (previous != reloads.end()) {
+            previous->second.copy->CancelLoading();
+            previous->second.job.Wait();
+            previous->second.copy->GetLoadingJob().Wait();
+            DeleteCopy(previous->second.copy);
+            reloads.erase(previous);
+        }
+
+        DebugLog("Reloading modified file " + file.first);
+        IResource* copy = CreateCopy(file.first, file.second);
+        Core::JobHandle job = resourceManager.threadManager.GetJobSystem().Schedule([copy]()
+        {
+            if (!copy->IsLoadingCancelled())
+                copy->Load();
+        }, Core::JobPriority::Background);
+        reloads[file.first] = { copy, job };
+    }
+
+    // Upload the reloaded copies and swap them with the current resources once they are ready.
+    for (std::unordered_map<std::string, Reload>::iterator it = reloads.begin(); it != reloads.end();)
+    {
+        IResource* copy = it->second.copy;
+        if (!it->second.job.IsDone() || !copy->GetLoadingJob().IsDone()) {
+            it++;
+            continue;
+        }
+
+        // Compilation errors are thrown by shaders, the current version is then kept.
+        bool sent = false, failed = !copy->IsLoaded();
+        if (!failed) {
+            try                                 { sent = SendCopyToOpenGL(copy, totalVertexCount); }
+            catch (const std::runtime_error&) { failed = true; }
+        }
+        if (failed)
+            DebugLogWarning("Unable to reload " + it->first + ", keeping the previous version.");
+        else if (sent)
+            SwapWithCopy(copy, totalVertexCount);
+        else {
+            it++;
+            continue;
+        }
+        DeleteCopy(copy);
+        it = reloads.erase(it);
+    }
+}
+
+IResource* HotReloader::CreateCopy(const std::string& name, const ResourceTypes& type)
+{
+    switch (type)
+    {
+    case ResourceTypes::VertexShader:   return new VertexShader  (name);
+    case ResourceTypes::FragmentShader: return new FragmentShader(name);
+    case ResourceTypes::ComputeShader:  return new ComputeShader (name);
+    case ResourceTypes::Texture:        return new Texture       (name);
+    case ResourceTypes::ObjFile:        return new ObjFile       (name, resourceManager, true);
+    default:                            return nullptr;
+    }
+}
+
+// Returns true once the copy is fully uploaded.
+bool HotReloader::SendCopyToOpenGL(IResource* copy, size_t& totalVertexCount)
+{
+    if (copy->GetType() != ResourceTypes::ObjFile) {
+        copy->SendToOpenGL();
+        return copy->WasSentToOpenGL();
+    }
+
+    // Send the sub-meshes of the copied meshes.
+    bool subMeshesPending = false;
+    for (IResource* mesh : ((ObjFile*)copy)->createdResources)
+    {
+        for (SubMesh* subMesh : ((Mesh*)mesh)->subMeshes)
+        {
+            if (subMesh->IsLoaded() && !subMesh->WasSentToOpenGL())
+                subMesh->SendVerticesToOpenGL(totalVertexCount);
+            subMeshesPending |= !subMesh->WasSentToOpenGL() && !subMesh->GetVertices().empty();
+        }
+    }
+    return !subMeshesPending;
+}
+
+void HotReloader::SwapWithCopy(IResource* copy, size_t& totalVertexCount)
+{
+    // Find the current resources and the shader programs to link again.
+    std::vector<std::pair<IResource*, IResource*>> swaps;
+    std::vector<ShaderProgram*> programs;
+    while (resourceManager.resourceLock.test_and_set()) {}
+    std::vector<IResource*> copies = { copy };
+    if (copy->GetType() == ResourceTypes::ObjFile)
+        copies = ((ObjFile*)copy)->createdResources;
+    for (IResource* resourceCopy : copies)
+    {
+        std::unordered_map<std::string, IResource*>::iterator it = resourceManager.resources.find(resourceCopy->GetName());
+        if (it == resourceManager.resources.end() || it->second->GetType() != resourceCopy->GetType()) {
+            DebugLogWarning("Reloaded resource " + resourceCopy->GetName() + " isn't used anymore, it will be loaded the next time its file is.");
+            continue;
+        }
+        swaps.push_back({ it->second, resourceCopy });
+    }
+    for (auto& it : resourceManager.resources)
+        if (it.second->GetType() == ResourceTypes::ShaderProgram)
+            for (const std::pair<IResource*, IResource*>& swap : swaps)
+                if (((ShaderProgram*)it.second)->UsesShader(swap.first))
+                    programs.push_back((ShaderProgram*)it.second);
+    resourceManager.resourceLock.clear();
+
+    // Swap the OpenGL objects of the current resources with the reloaded ones, which are deleted with the copies.
+    for (const std::pair<IResource*, IResource*>& swap : swaps)
+    {
+        switch (swap.first->GetType())
+        {
+        case ResourceTypes::VertexShader:   ((VertexShader*  )swap.first)->SwapData(*(VertexShader*  )swap.second); break;
+        case ResourceTypes::FragmentShader: ((FragmentShader*)swap.first)->SwapData(*(FragmentShader*)swap.second); break;
+        case ResourceTypes::ComputeShader:  ((ComputeShader* )swap.first)->SwapData(*(ComputeShader* )swap.second); break;
+        case ResourceTypes::Texture:        ((Texture*       )swap.first)->SwapData(*(Texture*       )swap.second); break;
+        case ResourceTypes::Mesh:
+            std::swap(((Mesh*)swap.first)->subMeshes, ((Mesh*)swap.second)->subMeshes);
+            for (const SubMesh* subMesh : ((Mesh*)swap.second)->subMeshes)
+                if (subMesh->WasSentToOpenGL())
+                    totalVertexCount -= subMesh->GetVertexCount();
+            break;
+        default:
+            break;
+        }
+    }
+    for (ShaderProgram* program : programs)
+        program->Relink();
+}
+
+void HotReloader::DeleteCopy(IResource* copy)
+{
+    // The meshes of obj file copies aren't in the resource manager.
+    if (copy->GetType() == ResourceTypes::ObjFile)
+        for (IResource* mesh : ((ObjFile*)copy)->createdResources)
+            delete mesh;
+    delete copy;
+}
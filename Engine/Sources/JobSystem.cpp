@@ -0,0 +1,499 @@
+#include <algorithm>
+#include <string>
+#include <cmath>
+
+#include "Debug.h"
+#include "JobSystem.h"
+#include "LoadTimeline.h"
+using namespace Core;
+
+
+JobSystem* JobSystem::instance = nullptr;
+
+// Job system and queue index owned by the calling worker thread.
+static thread_local JobSystem*           currentSystem      = nullptr;
+static thread_local int                  currentWorkerIndex = -1;
+static thread_local std::shared_ptr<Job> currentJob;
+
+
+void JobHandle::Wait() const
+{
+    if (job != nullptr && job->system != nullptr)
+        job->system->Wait(*this);
+}
+
+void JobHandle::SetImportance(const float& importance) const
+{
+    if (job != nullptr && job->system != nullptr)
+        job->system->SetImportance(*this, importance);
+}
+
+JobSystem::JobSystem(const int& threadCount)
+{
+    if (instance == nullptr)
+        instance = this;
+    lastSampleTime = std::chrono::steady_clock::now();
+
+    // Create one queue per worker and one for the other threads.
+    const int workerCount = (threadCount == 0 ? GetDefaultThreadCount() : std::max(0, threadCount));
+    for (int i = 0; i <= workerCount; i++)
+        queues.push_back(std::make_unique<WorkerQueue>());
+
+    // Launch the workers.
+    for (int i = 0; i < workerCount; i++)
+        threads.emplace_back(&JobSystem::WorkerLife, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    Stop();
+    if (instance == this)
+        instance = nullptr;
+}
+
+int JobSystem::GetDefaultThreadCount()
+{
+    // hardware_concurrency may return 0 when the value can't be computed.
+    int hardwareThreads = (int)std::thread::hardware_concurrency();
+    return std::max(1, hardwareThreads - 1);
+}
+
+JobHandle JobSystem::CurrentJob()
+{
+    return JobHandle(currentJob);
+}
+
+void JobSystem::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+        stopThreads.store(true);
+    }
+    sleepCondition.notify_all();
+    for (std::thread& t : threads)
+        if (t.joinable())
+            t.join();
+    threads.clear();
+}
+
+void JobSystem::WorkerLife(const int& workerIndex)
+{
+    currentSystem      = this;
+    currentWorkerIndex = workerIndex;
+    LoadTimeline::SetThreadName("Worker " + std::to_string(workerIndex));
+
+    while (!stopThreads)
+    {
+        // Execute the next job and keep track of the time spent working.
+        if (std::shared_ptr<Job> job = PopJob(true))
+        {
+            busyWorkers++;
+            std::chrono::steady_clock::time_point jobStart = std::chrono::steady_clock::now();
+            Execute(job);
+            busyTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - jobStart).count();
+            busyWorkers--;
+            continue;
+        }
+
+        // Sleep until a job is queued or the job system is stopped.
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this]() { return stopThreads.load() || queuedJobs.load() > 0 || queuedBackgroundJobs.load() > 0; });
+    }
+}
+
+void JobSystem::Push(const std::shared_ptr<Job>& job)
+{
+    // Without workers, jobs are executed right away by the thread that queues them.
+    if (threads.size() <= 0)
+    {
+        Execute(job);
+        return;
+    }
+
+    if (job->priority == JobPriority::Background)
+    {
+        // Background jobs spawned by a running job are its dependencies, so they go before the ones that haven't started yet.
+        std::lock_guard<std::mutex> guard(backgroundMutex);
+        if (job->parent != nullptr)
+            backgroundJobs.push_front(job);
+        else
+            backgroundJobs.push_back(job);
+        queuedBackgroundJobs++;
+    }
+    else
+    {
+        // Workers push to their own deque, other threads to the shared one.
+        const size_t queueIndex = (currentSystem == this ? (size_t)currentWorkerIndex : queues.size() - 1);
+        std::lock_guard<std::mutex> guard(queues[queueIndex]->mutex);
+        queues[queueIndex]->jobs.push_back(job);
+        queuedJobs++;
+    }
+
+    // Wake up a sleeping worker, and the threads waiting on this job's parent.
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+    }
+    sleepCondition.notify_one();
+    if (job->priority == JobPriority::Normal)
+        WakeWaiters();
+}
+
+void JobSystem::WakeWaiters()
+{
+    waitEpoch++;
+    if (waitingThreads.load() <= 0)
+        return;
+    {
+        std::lock_guard<std::mutex> guard(waitMutex);
+    }
+    waitCondition.notify_all();
+}
+
+// Returns true if the job is the root or one of its descendants.
+static bool IsInTree(const Job* job, const Job* root)
+{
+    for (; job != nullptr; job = job->parent.get())
+        if (job == root)
+            return true;
+    return false;
+}
+
+std::shared_ptr<Job> JobSystem::PopJob(const bool& allowBackground, const Job* root)
+{
+    std::shared_ptr<Job> job;
+
+    // Waiting threads only take the jobs of the tree they wait on, the newest from their own deque and the oldest from the others.
+    if (root != nullptr)
+    {
+        if (queuedJobs.load() <= 0)
+            return nullptr;
+        const int ownIndex = (currentSystem == this ? currentWorkerIndex : (int)queues.size() - 1);
+        for (size_t i = 0; i < queues.size(); i++)
+        {
+            const size_t queueIndex = ((size_t)ownIndex + i) % queues.size();
+            WorkerQueue& queue = *queues[queueIndex];
+            std::lock_guard<std::mutex> guard(queue.mutex);
+            if (i == 0) {
+                for (std::deque<std::shared_ptr<Job>>::reverse_iterator it = queue.jobs.rbegin(); it != queue.jobs.rend(); it++) {
+                    if (IsInTree(it->get(), root)) {
+                        job = *it;
+                        queue.jobs.erase(std::next(it).base());
+                        queuedJobs--;
+                        return job;
+                    }
+                }
+            }
+            else {
+                for (std::deque<std::shared_ptr<Job>>::iterator it = queue.jobs.begin(); it != queue.jobs.end(); it++) {
+                    if (IsInTree(it->get(), root)) {
+                        job = *it;
+                        queue.jobs.erase(it);
+                        queuedJobs--;
+                        return job;
+                    }
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    if (queuedJobs.load() > 0)
+    {
+        // Take the newest job from this worker's own deque.
+        const int ownIndex = (currentSystem == this ? currentWorkerIndex : -1);
+        if (ownIndex >= 0)
+        {
+            WorkerQueue& queue = *queues[ownIndex];
+            std::lock_guard<std::mutex> guard(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+                queuedJobs--;
+                return job;
+            }
+        }
+
+        // Steal the oldest job from the other deques.
+        for (size_t i = 0; i < queues.size(); i++)
+        {
+            const size_t queueIndex = (queues.size() - 1 + ownIndex + 1 + i) % queues.size();
+            if ((int)queueIndex == ownIndex)
+                continue;
+
+            WorkerQueue& queue = *queues[queueIndex];
+            std::lock_guard<std::mutex> guard(queue.mutex);
+            if (!queue.jobs.empty()) {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+                queuedJobs--;
+                return job;
+            }
+        }
+    }
+
+    // Only start background jobs when there is nothing else to do, the most important first.
+    if (allowBackground && queuedBackgroundJobs.load() > 0)
+    {
+        std::lock_guard<std::mutex> guard(backgroundMutex);
+        if (!backgroundJobs.empty()) {
+            std::deque<std::shared_ptr<Job>>::iterator best = backgroundJobs.begin();
+            for (std::deque<std::shared_ptr<Job>>::iterator it = best + 1; it != backgroundJobs.end(); it++)
+                if ((*it)->importance.load() > (*best)->importance.load())
+                    best = it;
+            job = *best;
+            backgroundJobs.erase(best);
+            queuedBackgroundJobs--;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(const std::shared_ptr<Job>& job)
+{
+    std::shared_ptr<Job> previousJob = currentJob;
+    currentJob = job;
+    if (job->task && !job->cancelled)
+        job->task();
+    currentJob = previousJob;
+    Finish(job);
+}
+
+void JobSystem::Finish(const std::shared_ptr<Job>& job)
+{
+    // Wait for the job's children to finish.
+    if (job->unfinishedJobs.fetch_sub(1) > 1)
+        return;
+
+    // Mark the job as done and take its continuations.
+    std::vector<std::shared_ptr<Job>> continuations;
+    {
+        std::lock_guard<std::mutex> guard(job->continuationsMutex);
+        job->finished.store(true);
+        continuations.swap(job->continuations);
+    }
+    WakeWaiters();
+
+    // Queue the continuations that don't depend on any other job.
+    for (const std::shared_ptr<Job>& continuation : continuations)
+        if (continuation->pendingDependencies.fetch_sub(1) == 1)
+            Push(continuation);
+
+    // Let the parent know that one of its children is done.
+    if (job->parent != nullptr)
+    {
+        std::shared_ptr<Job> parent = std::move(job->parent);
+        Finish(parent);
+    }
+}
+
+JobHandle JobSystem::Schedule(const std::function<void()>& task, const JobPriority& priority, const JobHandle& parent)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->system   = this;
+    job->task     = task;
+    job->priority = priority;
+    if (parent.IsValid()) {
+        job->parent = parent.GetJob();
+        job->parent->unfinishedJobs++;
+
+        // Background children are registered under the same lock that importance changes take, so they can't miss one.
+        std::lock_guard<std::mutex> guard(job->parent->childrenMutex);
+        job->importance = job->parent->importance.load();
+        if (priority == JobPriority::Background)
+            job->parent->children.push_back(job);
+    }
+    Push(job);
+    return JobHandle(job);
+}
+
+void JobSystem::SetImportance(const JobHandle& job, const float& importance)
+{
+    if (!job.IsValid())
+        return;
+
+    // Take the children that are still alive, and forget the other ones.
+    std::vector<std::shared_ptr<Job>> children;
+    {
+        const std::shared_ptr<Job>& parent = job.GetJob();
+        std::lock_guard<std::mutex> guard(parent->childrenMutex);
+        parent->importance.store(importance);
+        for (size_t i = 0; i < parent->children.size();)
+        {
+            std::shared_ptr<Job> child = parent->children[i].lock();
+            if (child == nullptr || child->finished) {
+                parent->children[i] = parent->children.back();
+                parent->children.pop_back();
+                continue;
+            }
+            children.push_back(child);
+            i++;
+        }
+    }
+    for (const std::shared_ptr<Job>& child : children)
+        SetImportance(JobHandle(child), importance);
+}
+
+JobHandle JobSystem::Schedule(const std::function<void()>& task, const std::vector<JobHandle>& dependencies, const JobPriority& priority)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->system   = this;
+    job->task     = task;
+    job->priority = priority;
+
+    // Count one extra dependency so the job can't be queued before all dependencies are registered.
+    job->pendingDependencies = (int)dependencies.size() + 1;
+    for (const JobHandle& dependency : dependencies)
+    {
+        if (!dependency.IsValid()) {
+            job->pendingDependencies--;
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(dependency.GetJob()->continuationsMutex);
+        if (dependency.GetJob()->finished)
+            job->pendingDependencies--;
+        else
+            dependency.GetJob()->continuations.push_back(job);
+    }
+    if (job->pendingDependencies.fetch_sub(1) == 1)
+        Push(job);
+    return JobHandle(job);
+}
+
+JobHandle JobSystem::Then(const JobHandle& job, const std::function<void()>& continuation, const JobPriority& priority)
+{
+    return Schedule(continuation, std::vector<JobHandle>{ job }, priority);
+}
+
+bool JobSystem::Cancel(const JobHandle& handle)
+{
+    if (!handle.IsValid())
+        return false;
+    std::shared_ptr<Job> job = handle.GetJob();
+    job->cancelled.store(true);
+
+    // Remove the job from the queue it is in.
+    bool removed = false;
+    {
+        std::lock_guard<std::mutex> guard(backgroundMutex);
+        std::deque<std::shared_ptr<Job>>::iterator it = std::find(backgroundJobs.begin(), backgroundJobs.end(), job);
+        if (it != backgroundJobs.end()) {
+            backgroundJobs.erase(it);
+            queuedBackgroundJobs--;
+            removed = true;
+        }
+    }
+    for (size_t i = 0; i < queues.size() && !removed; i++)
+    {
+        std::lock_guard<std::mutex> guard(queues[i]->mutex);
+        std::deque<std::shared_ptr<Job>>::iterator it = std::find(queues[i]->jobs.begin(), queues[i]->jobs.end(), job);
+        if (it != queues[i]->jobs.end()) {
+            queues[i]->jobs.erase(it);
+            queuedJobs--;
+            removed = true;
+        }
+    }
+
+    // Finish it right away so the jobs depending on it aren't blocked.
+    if (removed)
+        Finish(job);
+    return removed;
+}
+
+void JobSystem::Wait(const JobHandle& job)
+{
+    // Only help with the waited job's tree, unrelated jobs (resource loads for example) could take much longer than it.
+    // Sleep once none of them is queued, until a job finishes or another one is queued.
+    waitingThreads++;
+    while (!job.IsDone())
+    {
+        const uint64_t epoch = waitEpoch.load();
+        if (ExecuteOneJob(job))
+            continue;
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waitCondition.wait(lock, [&job, &epoch, this]() { return job.IsDone() || waitEpoch.load() != epoch; });
+    }
+    waitingThreads--;
+}
+
+bool JobSystem::ExecuteOneJob(const JobHandle& root)
+{
+    std::shared_ptr<Job> job = PopJob(false, root.GetJob().get());
+    if (job == nullptr)
+        return false;
+    Execute(job);
+    return true;
+}
+
+// Returns the fraction of the workers' time spent on jobs since the last call (refreshed at most every half second).
+float JobSystem::SampleUtilization()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    long long elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastSampleTime).count();
+    if (elapsedNs < 500000000 || threads.size() <= 0)
+        return lastUtilization;
+
+    long long curBusyTimeNs = busyTimeNs.load();
+    lastUtilization = std::min(1.f, (float)(curBusyTimeNs - lastSampledBusyTimeNs) / (float)(elapsedNs * threads.size()));
+    lastSampledBusyTimeNs = curBusyTimeNs;
+    lastSampleTime        = now;
+    return lastUtilization;
+}
+
+
+// ----- Benchmark ----- //
+
+// Recursively splits into two children jobs until reaching the leaves, which do a tiny amount of work.
+static void SpawnTaskTree(JobSystem& jobSystem, const int& depth, std::atomic<long long>& leafSum)
+{
+    if (depth <= 0)
+    {
+        float value = 0;
+        for (int i = 0; i < 200; i++)
+            value += std::sqrt((float)i);
+        leafSum += (long long)value;
+        return;
+    }
+
+    JobHandle self = JobSystem::CurrentJob();
+    for (int i = 0; i < 2; i++)
+        jobSystem.Schedule([&jobSystem, depth, &leafSum]() { SpawnTaskTree(jobSystem, depth - 1, leafSum); }, JobPriority::Normal, self);
+}
+
+void JobSystem::Benchmark()
+{
+    const int    maxCores = std::max(1, (int)std::thread::hardware_concurrency());
+    const size_t loopSize = (size_t)1 << 23;
+    const int    treeDepth = 16;
+    std::vector<float> values(loopSize);
+    DebugLog("Job system benchmark (" + std::to_string(maxCores) + " cores, loop of " + std::to_string(loopSize) + " elements, tree of " + std::to_string(1 << treeDepth) + " leaves):");
+
+    double baseLoopMs = 0, baseTreeMs = 0;
+    for (int cores = 1; cores <= maxCores; cores = (cores == maxCores ? maxCores + 1 : std::min(cores * 2, maxCores)))
+    {
+        // The calling thread works too, so one core means no worker.
+        JobSystem jobSystem(cores > 1 ? cores - 1 : -1);
+
+        // Embarrassingly parallel loop.
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        jobSystem.ParallelFor(0, loopSize, 16384, [&values](const size_t& i) {
+            const float x = (float)i;
+            values[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+        });
+        const double loopMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Fine-grained task tree.
+        std::atomic<long long> leafSum = 0;
+        start = std::chrono::steady_clock::now();
+        JobHandle root = jobSystem.Schedule([&jobSystem, treeDepth, &leafSum]() { SpawnTaskTree(jobSystem, treeDepth, leafSum); });
+        jobSystem.Wait(root);
+        const double treeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (cores == 1) {
+            baseLoopMs = loopMs;
+            baseTreeMs = treeMs;
+        }
+        DebugLog(std::to_string(cores) + " core(s): parallel loop " + std::to_string(loopMs) + " ms (x" + std::to_string(baseLoopMs / loopMs) + "), "
+                 + "task tree " + std::to_string(treeMs) + " ms (x" + std::to_string(baseTreeMs / treeMs) + ").");
+    }
+}
@@ -0,0 +1,111 @@
+#include <fstream>
+#include <iomanip>
+
+#include "LoadTimeline.h"
+using namespace Core;
+
+
+std::mutex                      LoadTimeline::mutex;
+std::vector<LoadEvent>          LoadTimeline::events;
+std::vector<std::string>        LoadTimeline::threadNames;
+LoadTimeline::Clock::time_point LoadTimeline::origin = LoadTimeline::Clock::now();
+
+static thread_local int currentThreadIndex = -1;
+
+void LoadTimeline::Record(const std::string& resource, const LoadPhase& phase, const Clock::time_point& start, const Clock::time_point& end)
+{
+    const int threadIndex = GetThreadIndex();
+    std::lock_guard<std::mutex> guard(mutex);
+    events.push_back({ resource, phase, threadIndex,
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count(),
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(end   - origin).count() });
+}
+
+int LoadTimeline::GetThreadIndex()
+{
+    if (currentThreadIndex < 0) {
+        std::lock_guard<std::mutex> guard(mutex);
+        currentThreadIndex = (int)threadNames.size();
+        threadNames.push_back("Thread " + std::to_string(currentThreadIndex));
+    }
+    return currentThreadIndex;
+}
+
+void LoadTimeline::SetThreadName(const std::string& name)
+{
+    const int threadIndex = GetThreadIndex();
+    std::lock_guard<std::mutex> guard(mutex);
+    threadNames[threadIndex] = name;
+}
+
+void LoadTimeline::Clear()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    events.clear();
+    origin = Clock::now();
+}
+
+std::vector<LoadEvent> LoadTimeline::GetEvents()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return events;
+}
+
+std::vector<std::string> LoadTimeline::GetThreadNames()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return threadNames;
+}
+
+const char* LoadTimeline::GetPhaseName(const LoadPhase& phase)
+{
+    switch (phase)
+    {
+    case LoadPhase::Queued:  return "Queued";
+    case LoadPhase::Load:    return "Load";
+    case LoadPhase::Read:    return "Read";
+    case LoadPhase::Parse:   return "Parse";
+    case LoadPhase::Decode:  return "Decode";
+    case LoadPhase::Mipmaps: return "Mipmaps";
+    case LoadPhase::Upload:  return "Upload";
+    default:                return "Unknown";
+    }
+}
+
+static std::string EscapeJson(const std::string& str)
+{
+    std::string escaped;
+    for (const char& c : str)
+    {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool LoadTimeline::ExportChromeTrace(const std::string& filename)
+{
+    std::ofstream f(filename);
+    if (!f.is_open())
+        return false;
+    f << std::fixed << std::setprecision(3);
+
+    const std::vector<LoadEvent>   eventsCopy = GetEvents();
+    const std::vector<std::string> names      = GetThreadNames();
+
+    // Complete events are given in microseconds, with the phase as category.
+    const char* separator = "\n";
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (size_t i = 0; i < names.size(); i++, separator = ",\n")
+        f << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":\"" << EscapeJson(names[i]) << "\"}}";
+    for (const LoadEvent& event : eventsCopy)
+    {
+        f << separator << "{\"name\":\"" << EscapeJson(event.resource) << "\",\"cat\":\"" << GetPhaseName(event.phase) << "\",\"ph\":\"X\""
+          << ",\"ts\":"  << event.startNs / 1000.0
+          << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0
+          << ",\"pid\":0,\"tid\":" << event.threadIndex << "}";
+        separator = ",\n";
+    }
+    f << "\n]}\n";
+    return true;
+}
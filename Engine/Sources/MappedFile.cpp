@@ -0,0 +1,85 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+using namespace Core;
+
+
+bool MappedFile::Open(const std::string& filename)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        Close();
+        return false;
+    }
+    size = (size_t)fileSize.QuadPart;
+    if (size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        Close();
+        return false;
+    }
+    mappingHandle = mapping;
+    data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+#else
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+    fileHandle = (void*)(intptr_t)(file + 1);
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0) {
+        Close();
+        return false;
+    }
+    size = (size_t)fileStat.st_size;
+    if (size == 0)
+        return true;
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    data = (mapped != MAP_FAILED ? (const char*)mapped : nullptr);
+    if (data != nullptr)
+        madvise(mapped, size, MADV_SEQUENTIAL);
+#endif
+
+    if (data == nullptr) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data          != nullptr) UnmapViewOfFile(data);
+    if (mappingHandle != nullptr) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle    != nullptr) CloseHandle((HANDLE)fileHandle);
+#else
+    if (data       != nullptr) munmap((void*)data, size);
+    if (fileHandle != nullptr) close((int)(intptr_t)fileHandle - 1);
+#endif
+    data          = nullptr;
+    size          = 0;
+    fileHandle    = nullptr;
+    mappingHandle = nullptr;
+}
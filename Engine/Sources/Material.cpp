@@ -31,8 +31,20 @@ void Material::SetParams(const RGB& _ambient, const RGB& _diffuse, const RGB& _s
     shininess = _shininess;
 }
 
+bool Material::CullsBackFaces() const
+{
+    return transparency >= 1 && alphaMap == nullptr;
+}
+
 void Material::SendDataToShader(const unsigned int& shaderProgram, const unsigned int& sampler) const
 {
+    // Keep the material and its textures from being evicted.
+    const uint64_t frame = ResourceManager::GetFrameIndex();
+    MarkUsed(frame);
+    for (const Texture* texture : { ambientTexture.Get(), diffuseTexture.Get(), specularTexture.Get(), emissionTexture.Get(), shininessMap.Get(), alphaMap.Get(), normalMap.Get() })
+        if (texture != nullptr)
+            texture->MarkUsed(frame);
+
     // Send material parameters to shader.
     glUniform3fv(glGetUniformLocation(shaderProgram, "material.ambient"     ), 1, &ambient.r);
     glUniform3fv(glGetUniformLocation(shaderProgram, "material.diffuse"     ), 1, &diffuse.r);
@@ -42,7 +54,7 @@ void Material::SendDataToShader(const unsigned int& shaderProgram, const unsigne
     glUniform1f (glGetUniformLocation(shaderProgram, "material.transparency"),     transparency);
 
     // Cull back faces of non-transparent models.
-    if (transparency >= 1 && alphaMap == nullptr)
+    if (CullsBackFaces())
         glEnable(GL_CULL_FACE);
     else
         glDisable(GL_CULL_FACE);
@@ -27,6 +27,33 @@ void Mesh::SendToOpenGL()
         SetOpenGLTransferDone();
 }
 
+size_t Mesh::GetCpuBytes() const
+{
+    // Sub-meshes are still being added while the mesh is loading.
+    if (!IsLoaded())
+        return 0;
+    size_t bytes = 0;
+    for (const SubMesh* subMesh : subMeshes)
+        bytes += subMesh->GetCpuBytes();
+    return bytes;
+}
+
+size_t Mesh::GetGpuBytes() const
+{
+    if (!IsLoaded())
+        return 0;
+    size_t bytes = 0;
+    for (const SubMesh* subMesh : subMeshes)
+        bytes += subMesh->GetGpuBytes();
+    return bytes;
+}
+
+void Mesh::DeleteOpenGLObjects()
+{
+    for (SubMesh* subMesh : subMeshes)
+        subMesh->DeleteOpenGLObjects();
+}
+
 bool Mesh::AreAllSubMeshesLoaded()
 {
     if (subMeshes.size() <= 0)
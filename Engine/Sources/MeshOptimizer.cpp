@@ -0,0 +1,683 @@
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cfloat>
+#include <cstdint>
+
+#include "Maths.h"
+#include "MeshOptimizer.h"
+using namespace Core::Maths;
+using namespace Resources;
+
+
+// Vertex misses of each triangle with a FIFO vertex cache, a vertex is in the cache if it was added less than cacheSize misses ago.
+static std::vector<unsigned char> SimulateVertexCache(const std::vector<unsigned int>& indices, const size_t& vertexCount, const unsigned int& cacheSize)
+{
+    std::vector<unsigned int>  addedTimes(vertexCount, 0);
+    std::vector<unsigned char> misses(indices.size() / 3, 0);
+    unsigned int time = cacheSize + 1;
+    for (size_t i = 0; i < misses.size() * 3; i++)
+    {
+        if (time - addedTimes[indices[i]] > cacheSize) {
+            addedTimes[indices[i]] = time++;
+            misses[i / 3]++;
+        }
+    }
+    return misses;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned int>& indices, const size_t& vertexCount)
+{
+    VertexCacheStats stats;
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0)
+        return stats;
+
+    size_t missCount = 0;
+    for (const unsigned char& misses : SimulateVertexCache(indices, vertexCount, AnalyzedCacheSize))
+        missCount += misses;
+    stats.acmr = (float)missCount / triangleCount;
+    stats.atvr = (float)missCount / vertexCount;
+    return stats;
+}
+
+// ----- Vertex cache ----- //
+
+// Forsyth's scoring parameters, for an LRU cache of 32 vertices.
+static constexpr int   ForsythCacheSize         = 32;
+static constexpr float ForsythCacheDecayPower   = 1.5f;
+static constexpr float ForsythLastTriangleScore = 0.75f;
+static constexpr float ForsythValenceBoostScale = 2.0f;
+static constexpr float ForsythValenceBoostPower = 0.5f;
+
+// Vertices are worth using if they were used recently, or if they have few triangles left (so they aren't left alone at the end).
+static float GetVertexScore(const int& cachePosition, const unsigned int& remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1;
+
+    float score = 0;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, so that the next triangle doesn't favor one of its edges.
+        if (cachePosition < 3)
+            score = ForsythLastTriangleScore;
+        else
+            score = std::pow(1.f - (float)(cachePosition - 3) / (ForsythCacheSize - 3), ForsythCacheDecayPower);
+    }
+    return score + ForsythValenceBoostScale * std::pow((float)remainingTriangles, -ForsythValenceBoostPower);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, const size_t& vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of each vertex, the ones that weren't emitted yet are kept at the start of each vertex's range.
+    std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        remainingTriangles[indices[i]]++;
+    for (size_t i = 0; i < vertexCount; i++)
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + remainingTriangles[i];
+    std::vector<unsigned int> adjacencyEnds(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        adjacency[adjacencyEnds[indices[i]]++] = (unsigned int)(i / 3);
+
+    // Compute the initial scores.
+    std::vector<int>   cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores  (vertexCount);
+    std::vector<float> triangleScores(triangleCount, 0);
+    std::vector<bool>  emitted       (triangleCount, false);
+    for (size_t i = 0; i < vertexCount; i++)
+        vertexScores[i] = GetVertexScore(-1, remainingTriangles[i]);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        triangleScores[i / 3] += vertexScores[indices[i]];
+
+    std::vector<unsigned int> optimized;
+    optimized.reserve(triangleCount * 3);
+    unsigned int cache[ForsythCacheSize + 3], newCache[ForsythCacheSize + 3];
+    int    cacheCount    = 0;
+    size_t firstUnused   = 0;
+    int    bestTriangle  = -1;
+    while (optimized.size() < triangleCount * 3)
+    {
+        // When the cached vertices have no triangles left, continue with the next triangle in the original order.
+        if (bestTriangle < 0) {
+            while (emitted[firstUnused])
+                firstUnused++;
+            bestTriangle = (int)firstUnused;
+        }
+
+        // Emit the best triangle and remove it from its vertices' triangles.
+        const unsigned int* triangle = &indices[(size_t)bestTriangle * 3];
+        for (int i = 0; i < 3; i++)
+        {
+            const unsigned int vertex = triangle[i];
+            optimized.push_back(vertex);
+            unsigned int* vertexTriangles = &adjacency[adjacencyOffsets[vertex]];
+            for (unsigned int j = 0; j < remainingTriangles[vertex]; j++) {
+                if (vertexTriangles[j] == (unsigned int)bestTriangle) {
+                    std::swap(vertexTriangles[j], vertexTriangles[remainingTriangles[vertex] - 1]);
+                    break;
+                }
+            }
+            remainingTriangles[vertex]--;
+        }
+        emitted[bestTriangle] = true;
+
+        // Move the triangle's vertices to the front of the cache, the ones pushed out of it lose their cache position.
+        int newCacheCount = 0;
+        for (int i = 0; i < 3; i++)
+            if (std::find(newCache, newCache + newCacheCount, triangle[i]) == newCache + newCacheCount)
+                newCache[newCacheCount++] = triangle[i];
+        for (int i = 0; i < cacheCount; i++)
+            if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3)
+                newCache[newCacheCount++] = cache[i];
+        for (int i = 0; i < newCacheCount; i++)
+            cachePositions[newCache[i]] = (i < ForsythCacheSize ? i : -1);
+
+        // Update the scores of the vertices whose position changed and of their triangles.
+        for (int i = 0; i < newCacheCount; i++)
+        {
+            const unsigned int vertex   = newCache[i];
+            const float        newScore = GetVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+            const float        delta    = newScore - vertexScores[vertex];
+            vertexScores[vertex] = newScore;
+            for (unsigned int j = 0; j < remainingTriangles[vertex]; j++)
+                triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += delta;
+        }
+
+        // The next triangle is the best one that uses a cached vertex.
+        cacheCount   = std::min(newCacheCount, ForsythCacheSize);
+        bestTriangle = -1;
+        float bestScore = -1;
+        for (int i = 0; i < cacheCount; i++)
+        {
+            const unsigned int vertex = newCache[i];
+            cache[i] = vertex;
+            for (unsigned int j = 0; j < remainingTriangles[vertex]; j++)
+            {
+                const unsigned int candidate = adjacency[adjacencyOffsets[vertex] + j];
+                if (triangleScores[candidate] > bestScore) {
+                    bestScore    = triangleScores[candidate];
+                    bestTriangle = (int)candidate;
+                }
+            }
+        }
+    }
+    indices.swap(optimized);
+}
+
+// ----- Overdraw ----- //
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<TangentVertex>& vertices, const float& threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Clusters start where all vertices of a triangle miss the cache, so reordering them keeps most of the cache efficiency.
+    const std::vector<unsigned char> misses = SimulateVertexCache(indices, vertices.size(), AnalyzedCacheSize);
+    std::vector<size_t> hardBoundaries;
+    for (size_t i = 0; i < triangleCount; i++)
+        if (i == 0 || misses[i] == 3)
+            hardBoundaries.push_back(i);
+    hardBoundaries.push_back(triangleCount);
+
+    // Split the clusters further once the triangles drawn since the last split, starting with an empty cache, don't miss it much more than the whole cluster.
+    std::vector<unsigned int> addedTimes(vertices.size(), 0);
+    unsigned int time = 0;
+    auto getMisses = [&indices, &addedTimes, &time](const size_t& triangle)
+    {
+        unsigned char misses = 0;
+        for (size_t i = triangle * 3; i < triangle * 3 + 3; i++) {
+            if (time - addedTimes[indices[i]] > AnalyzedCacheSize) {
+                addedTimes[indices[i]] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    std::vector<size_t> boundaries;
+    for (size_t i = 0; i + 1 < hardBoundaries.size(); i++)
+    {
+        const size_t start = hardBoundaries[i], end = hardBoundaries[i + 1];
+        time += AnalyzedCacheSize + 1;
+        size_t clusterMisses = 0;
+        for (size_t j = start; j < end; j++)
+            clusterMisses += getMisses(j);
+        const float clusterThreshold = threshold * clusterMisses / (end - start);
+
+        boundaries.push_back(start);
+        time += AnalyzedCacheSize + 1;
+        size_t runningMisses = 0, runningTriangles = 0;
+        for (size_t j = start; j < end; j++)
+        {
+            runningMisses += getMisses(j);
+            runningTriangles++;
+            if (j + 1 < end && runningMisses <= clusterThreshold * runningTriangles) {
+                boundaries.push_back(j + 1);
+                time += AnalyzedCacheSize + 1;
+                runningMisses = runningTriangles = 0;
+            }
+        }
+    }
+    boundaries.push_back(triangleCount);
+
+    // Compute the area weighted center and normal of the mesh and of each cluster.
+    struct Cluster
+    {
+        size_t start, end;
+        float  sortKey;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<Vector3> clusterCenters, clusterNormals;
+    Vector3 meshCenter;
+    float   meshArea = 0;
+    for (size_t i = 0; i + 1 < boundaries.size(); i++)
+    {
+        Vector3 center, normal;
+        float   area = 0;
+        for (size_t j = boundaries[i]; j < boundaries[i + 1]; j++)
+        {
+            const Vector3& a = vertices[indices[j * 3 + 0]].pos;
+            const Vector3& b = vertices[indices[j * 3 + 1]].pos;
+            const Vector3& c = vertices[indices[j * 3 + 2]].pos;
+            const Vector3  triangleNormal = (b - a) ^ (c - a);
+            const float    triangleArea   = triangleNormal.getLength();
+            center += (a + b + c) * (triangleArea / 3);
+            normal += triangleNormal;
+            area   += triangleArea;
+        }
+        meshCenter += center;
+        meshArea   += area;
+        clusterCenters.push_back(area > 0 ? center / area : vertices[indices[boundaries[i] * 3]].pos);
+        clusterNormals.push_back(normal.getNormalized());
+        clusters.push_back({ boundaries[i], boundaries[i + 1], 0 });
+    }
+    if (meshArea > 0)
+        meshCenter /= meshArea;
+
+    // Clusters that face away from the mesh's center are on its outside, drawing them first lets early depth testing skip the inner ones.
+    for (size_t i = 0; i < clusters.size(); i++)
+        clusters[i].sortKey = (clusterCenters[i] - meshCenter) & clusterNormals[i];
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(triangleCount * 3);
+    for (const Cluster& cluster : clusters)
+        sorted.insert(sorted.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    indices.swap(sorted);
+}
+
+// ----- Vertex fetch ----- //
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<TangentVertex>& vertices, std::vector<unsigned int>& indices)
+{
+    // Number the vertices in the order of their first use, the unused ones are kept at the end.
+    std::vector<unsigned int> remap(vertices.size(), UINT_MAX);
+    unsigned int nextVertex = 0;
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == UINT_MAX)
+            remap[index] = nextVertex++;
+        index = remap[index];
+    }
+    for (unsigned int& newIndex : remap)
+        if (newIndex == UINT_MAX)
+            newIndex = nextVertex++;
+
+    std::vector<TangentVertex> sorted(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        sorted[remap[i]] = vertices[i];
+    vertices.swap(sorted);
+}
+
+// ----- Simplification ----- //
+
+// Border edges add a plane perpendicular to their triangle, weighted more than triangles so that the borders keep their shape.
+static constexpr double SimplifyBorderWeight = 10;
+
+// Sum of squared distances to weighted planes, stored as the symmetric matrix A, vector b and constant c of p.A.p + 2 b.p + c.
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0  = 0, b1  = 0, b2  = 0, c   = 0;
+    double weight = 0;
+
+    // Adds the plane with the given unit normal that goes through the given point.
+    void AddPlane(const Vector3& normal, const Vector3& point, const double& planeWeight)
+    {
+        const double nx = normal.x, ny = normal.y, nz = normal.z;
+        const double d  = -(nx * point.x + ny * point.y + nz * point.z);
+        a00 += planeWeight * nx * nx; a01 += planeWeight * nx * ny; a02 += planeWeight * nx * nz;
+        a11 += planeWeight * ny * ny; a12 += planeWeight * ny * nz; a22 += planeWeight * nz * nz;
+        b0  += planeWeight * nx * d;  b1  += planeWeight * ny * d;  b2  += planeWeight * nz * d;
+        c   += planeWeight * d  * d;
+        weight += planeWeight;
+    }
+
+    void Add(const Quadric& q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0  += q.b0;  b1  += q.b1;  b2  += q.b2;  c   += q.c;
+        weight += q.weight;
+    }
+
+    // Weighted mean of the squared distances from the given point to the planes.
+    double GetError(const Vector3& p) const
+    {
+        if (weight <= 0)
+            return 0;
+        const double x = p.x, y = p.y, z = p.z;
+        const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                           + 2 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::max(error, 0.0) / weight;
+    }
+};
+
+// Edges between two position groups, the smallest group in the high bits.
+static uint64_t GetEdgeKey(const unsigned int& group0, const unsigned int& group1)
+{
+    return ((uint64_t)std::min(group0, group1) << 32) | std::max(group0, group1);
+}
+
+float MeshOptimizer::Simplify(std::vector<unsigned int>& indices, const std::vector<TangentVertex>& vertices, const size_t& targetIndexCount, const float& targetError)
+{
+    // Vertices at the same position (with different uvs or normals) are moved together, as a group.
+    std::vector<unsigned int> sortedVertices(vertices.size());
+    for (unsigned int i = 0; i < (unsigned int)vertices.size(); i++)
+        sortedVertices[i] = i;
+    auto isPosBefore = [&vertices](const unsigned int& a, const unsigned int& b)
+    {
+        const Vector3& posA = vertices[a].pos;
+        const Vector3& posB = vertices[b].pos;
+        if (posA.x != posB.x) return posA.x < posB.x;
+        if (posA.y != posB.y) return posA.y < posB.y;
+        if (posA.z != posB.z) return posA.z < posB.z;
+        return a < b;
+    };
+    std::sort(sortedVertices.begin(), sortedVertices.end(), isPosBefore);
+
+    std::vector<unsigned int> groups(vertices.size());
+    std::vector<unsigned int> groupStarts; // Groups are ranges of the sorted vertices.
+    auto getGroupPos = [&](const unsigned int& group) -> const Vector3& { return vertices[sortedVertices[groupStarts[group]]].pos; };
+    for (size_t i = 0; i < sortedVertices.size(); i++)
+    {
+        const Vector3& pos     = vertices[sortedVertices[i]].pos;
+        const Vector3& prevPos = vertices[sortedVertices[i > 0 ? i-1 : 0]].pos;
+        if (i == 0 || pos.x != prevPos.x || pos.y != prevPos.y || pos.z != prevPos.z)
+            groupStarts.push_back((unsigned int)i);
+        groups[sortedVertices[i]] = (unsigned int)groupStarts.size() - 1;
+    }
+    const size_t groupCount = groupStarts.size();
+    groupStarts.push_back((unsigned int)sortedVertices.size());
+
+    // Remove the triangles that are already degenerate.
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const unsigned int g0 = groups[indices[i]], g1 = groups[indices[i+1]], g2 = groups[indices[i+2]];
+            if (g0 == g1 || g1 == g2 || g0 == g2)
+                continue;
+            for (int j = 0; j < 3; j++)
+                indices[kept++] = indices[i+j];
+        }
+        indices.resize(kept);
+    }
+
+    // Each group starts with the planes of its triangles, weighted by their area.
+    std::vector<Quadric> quadrics(groupCount);
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const Vector3 normal = (vertices[indices[i+1]].pos - vertices[indices[i]].pos) ^ (vertices[indices[i+2]].pos - vertices[indices[i]].pos);
+        const float   length = normal.getLength();
+        if (length <= 0)
+            continue;
+        for (int j = 0; j < 3; j++)
+            quadrics[groups[indices[i+j]]].AddPlane(normal / length, vertices[indices[i]].pos, length * 0.5);
+        for (int j = 0; j < 3; j++)
+            edges.push_back(GetEdgeKey(groups[indices[i+j]], groups[indices[i+(j+1)%3]]));
+    }
+
+    // Border edges (used by one triangle) also get a plane perpendicular to their triangle.
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const Vector3 normal = (vertices[indices[i+1]].pos - vertices[indices[i]].pos) ^ (vertices[indices[i+2]].pos - vertices[indices[i]].pos);
+        if (normal.getLength() <= 0)
+            continue;
+        for (int j = 0; j < 3; j++)
+        {
+            const unsigned int group0 = groups[indices[i+j]], group1 = groups[indices[i+(j+1)%3]];
+            const std::pair<std::vector<uint64_t>::iterator, std::vector<uint64_t>::iterator> range = std::equal_range(edges.begin(), edges.end(), GetEdgeKey(group0, group1));
+            if (range.second - range.first != 1)
+                continue;
+            const Vector3 edge = getGroupPos(group1) - getGroupPos(group0);
+            const Vector3 borderNormal = edge ^ normal;
+            const float   borderLength = borderNormal.getLength();
+            if (borderLength <= 0)
+                continue;
+            const double borderWeight = (double)(edge & edge) * SimplifyBorderWeight;
+            quadrics[group0].AddPlane(borderNormal / borderLength, getGroupPos(group0), borderWeight);
+            quadrics[group1].AddPlane(borderNormal / borderLength, getGroupPos(group1), borderWeight);
+        }
+    }
+
+    // Collapse the edges with the smallest errors in passes, where the groups around a collapsed edge aren't moved again until the next pass.
+    enum GroupKinds : unsigned char { Interior, Border, Locked };
+    struct Collapse { unsigned int from, to; double error; };
+    const double maxError = (double)targetError * targetError;
+    double reachedError = 0;
+    std::vector<unsigned int>  remap(vertices.size());
+    std::vector<unsigned int>  wedgeTargets(vertices.size(), UINT_MAX);
+    for (unsigned int i = 0; i < (unsigned int)vertices.size(); i++)
+        remap[i] = i;
+
+    while (indices.size() > targetIndexCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+
+        // Triangles of each group.
+        std::vector<unsigned int> triangleStarts(groupCount + 1, 0);
+        std::vector<unsigned int> groupTriangles(indices.size());
+        for (const unsigned int& index : indices)
+            triangleStarts[groups[index] + 1]++;
+        for (size_t i = 0; i < groupCount; i++)
+            triangleStarts[i+1] += triangleStarts[i];
+        {
+            std::vector<unsigned int> nextTriangles(triangleStarts.begin(), triangleStarts.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                groupTriangles[nextTriangles[groups[indices[i]]]++] = (unsigned int)(i / 3);
+        }
+
+        // Edges with the number of triangles using them: borders can only move along border edges, and non-manifold groups don't move.
+        edges.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+            for (int j = 0; j < 3; j++)
+                edges.push_back(GetEdgeKey(groups[indices[i+j]], groups[indices[i+(j+1)%3]]));
+        std::sort(edges.begin(), edges.end());
+        std::vector<unsigned char>   groupKinds(groupCount, Interior);
+        std::vector<uint64_t>        uniqueEdges;
+        std::vector<unsigned int>    edgeCounts;
+        for (size_t i = 0; i < edges.size(); )
+        {
+            size_t end = i;
+            while (end < edges.size() && edges[end] == edges[i])
+                end++;
+            const unsigned int group0 = (unsigned int)(edges[i] >> 32), group1 = (unsigned int)edges[i];
+            const unsigned char kind = (end - i == 1 ? Border : end - i > 2 ? Locked : Interior);
+            groupKinds[group0] = std::max(groupKinds[group0], kind);
+            groupKinds[group1] = std::max(groupKinds[group1], kind);
+            uniqueEdges.push_back(edges[i]);
+            edgeCounts .push_back((unsigned int)(end - i));
+            i = end;
+        }
+
+        // Find the cheapest direction of each edge, the vertices are moved to the other end of the edge so no vertex is created.
+        std::vector<Collapse> collapses;
+        for (size_t i = 0; i < uniqueEdges.size(); i++)
+        {
+            const unsigned int group0 = (unsigned int)(uniqueEdges[i] >> 32), group1 = (unsigned int)uniqueEdges[i];
+            auto canMove = [&](const unsigned int& group) { return groupKinds[group] == Interior || (groupKinds[group] == Border && edgeCounts[i] == 1); };
+
+            Quadric quadric = quadrics[group0];
+            quadric.Add(quadrics[group1]);
+            Collapse collapse = { 0, 0, DBL_MAX };
+            if (canMove(group0)) collapse = { group0, group1, quadric.GetError(getGroupPos(group1)) };
+            if (canMove(group1)) {
+                const double error = quadric.GetError(getGroupPos(group0));
+                if (error < collapse.error)
+                    collapse = { group1, group0, error };
+            }
+            if (collapse.error <= maxError)
+                collapses.push_back(collapse);
+        }
+        std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        std::vector<unsigned char> touchedGroups(groupCount, 0);
+        const size_t triangleGoal  = triangleCount - targetIndexCount / 3;
+        size_t removedTriangles    = 0;
+        size_t collapseCount       = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (removedTriangles >= triangleGoal)
+                break;
+            if (touchedGroups[collapse.from] || touchedGroups[collapse.to])
+                continue;
+
+            // The flip test reads the positions of the groups around the moved one, so none of them may have moved in this pass.
+            bool ringTouched = false;
+            for (unsigned int j = triangleStarts[collapse.from]; j < triangleStarts[collapse.from + 1] && !ringTouched; j++)
+                for (int k = 0; k < 3; k++)
+                    ringTouched |= (touchedGroups[groups[indices[groupTriangles[j] * 3 + k]]] != 0);
+            if (ringTouched)
+                continue;
+
+            // Each vertex of the moved group goes to the vertex it shares a triangle with in the target group, so that uv and normal seams stay closed.
+            const Vector3& targetPos = getGroupPos(collapse.to);
+            size_t sharedTriangles = 0;
+            for (unsigned int j = triangleStarts[collapse.from]; j < triangleStarts[collapse.from + 1]; j++)
+            {
+                const unsigned int* triangle = &indices[groupTriangles[j] * 3];
+                int fromCorner = -1, toCorner = -1;
+                for (int k = 0; k < 3; k++) {
+                    if (groups[triangle[k]] == collapse.from) fromCorner = k;
+                    if (groups[triangle[k]] == collapse.to)   toCorner   = k;
+                }
+                if (toCorner < 0)
+                    continue;
+                sharedTriangles++;
+                if (wedgeTargets[triangle[fromCorner]] == UINT_MAX)
+                    wedgeTargets[triangle[fromCorner]] = triangle[toCorner];
+            }
+
+            // The other triangles must keep a target for their vertex and must not be flipped.
+            bool valid = true;
+            for (unsigned int j = triangleStarts[collapse.from]; j < triangleStarts[collapse.from + 1] && valid; j++)
+            {
+                const unsigned int* triangle = &indices[groupTriangles[j] * 3];
+                int fromCorner = -1;
+                bool hasTarget = false;
+                for (int k = 0; k < 3; k++) {
+                    if (groups[triangle[k]] == collapse.from) fromCorner = k;
+                    if (groups[triangle[k]] == collapse.to)   hasTarget  = true;
+                }
+                if (hasTarget)
+                    continue;
+                if (wedgeTargets[triangle[fromCorner]] == UINT_MAX) {
+                    valid = false;
+                    break;
+                }
+
+                const Vector3& pos1 = vertices[triangle[(fromCorner+1)%3]].pos;
+                const Vector3& pos2 = vertices[triangle[(fromCorner+2)%3]].pos;
+                const Vector3 normalBefore = (pos1 - vertices[triangle[fromCorner]].pos) ^ (pos2 - vertices[triangle[fromCorner]].pos);
+                const Vector3 normalAfter  = (pos1 - targetPos) ^ (pos2 - targetPos);
+                if ((normalBefore & normalAfter) <= 0)
+                    valid = false;
+            }
+
+            for (unsigned int j = groupStarts[collapse.from]; j < groupStarts[collapse.from + 1]; j++)
+            {
+                const unsigned int vertex = sortedVertices[j];
+                if (valid && wedgeTargets[vertex] != UINT_MAX)
+                    remap[vertex] = wedgeTargets[vertex];
+                wedgeTargets[vertex] = UINT_MAX;
+            }
+            if (!valid)
+                continue;
+
+            // Lock the whole ring, so later collapses of this pass don't move the groups this one was checked against.
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            for (unsigned int j = triangleStarts[collapse.from]; j < triangleStarts[collapse.from + 1]; j++)
+                for (int k = 0; k < 3; k++)
+                    touchedGroups[groups[indices[groupTriangles[j] * 3 + k]]] = 1;
+            removedTriangles += sharedTriangles;
+            reachedError = std::max(reachedError, collapse.error);
+            collapseCount++;
+        }
+        if (collapseCount == 0)
+            break;
+
+        // Move the collapsed vertices and remove the triangles that became degenerate.
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const unsigned int i0 = remap[indices[i]], i1 = remap[indices[i+1]], i2 = remap[indices[i+2]];
+            if (groups[i0] == groups[i1] || groups[i1] == groups[i2] || groups[i0] == groups[i2])
+                continue;
+            indices[kept++] = i0;
+            indices[kept++] = i1;
+            indices[kept++] = i2;
+        }
+        indices.resize(kept);
+    }
+    return (float)std::sqrt(reachedError);
+}
+
+// ----- Meshlets ----- //
+
+std::vector<Meshlet> MeshOptimizer::BuildMeshlets(const std::vector<unsigned int>& indices, const std::vector<TangentVertex>& vertices, const unsigned int& maxVertices, const unsigned int& maxTriangles)
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    std::vector<Meshlet>      meshlets;
+    std::vector<unsigned int> vertexMeshlets(vertices.size(), UINT_MAX); // Last meshlet that used each vertex.
+    std::vector<unsigned int> meshletVertices;
+    std::vector<Vector3>      meshletNormals;
+    Vector3 normalSum;
+    size_t  firstTriangle = 0;
+
+    // Computes the bounds of the current meshlet, made of the triangles from the first one to the given one.
+    auto endMeshlet = [&](const size_t& endTriangle)
+    {
+        Meshlet meshlet;
+        meshlet.firstIndex = (unsigned int)(firstTriangle * 3);
+        meshlet.indexCount = (unsigned int)((endTriangle - firstTriangle) * 3);
+
+        Vector3 boundsMin = vertices[meshletVertices[0]].pos, boundsMax = boundsMin;
+        for (const unsigned int& vertex : meshletVertices) {
+            const Vector3& pos = vertices[vertex].pos;
+            boundsMin = Vector3(std::min(boundsMin.x, pos.x), std::min(boundsMin.y, pos.y), std::min(boundsMin.z, pos.z));
+            boundsMax = Vector3(std::max(boundsMax.x, pos.x), std::max(boundsMax.y, pos.y), std::max(boundsMax.z, pos.z));
+        }
+        meshlet.center = (boundsMin + boundsMax) * 0.5f;
+        for (const unsigned int& vertex : meshletVertices)
+            meshlet.radius = std::max(meshlet.radius, (vertices[vertex].pos - meshlet.center).getLength());
+
+        // Degenerate triangles don't restrict the normal cone, since they are never drawn.
+        const float normalLength = normalSum.getLength();
+        meshlet.coneCutoff = -1;
+        if (normalLength > 0)
+        {
+            meshlet.coneAxis   = normalSum / normalLength;
+            meshlet.coneCutoff = 1;
+            for (const Vector3& normal : meshletNormals)
+                if (normal.getLength() > 0)
+                    meshlet.coneCutoff = std::min(meshlet.coneCutoff, meshlet.coneAxis & normal);
+        }
+        meshlets.push_back(meshlet);
+        meshletVertices.clear();
+        meshletNormals .clear();
+        normalSum     = Vector3();
+        firstTriangle = endTriangle;
+    };
+
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        // Start a new meshlet if the triangle's vertices don't fit in the current one.
+        unsigned int newVertices = 0;
+        for (int k = 0; k < 3; k++)
+            newVertices += (vertexMeshlets[indices[i*3+k]] != (unsigned int)meshlets.size());
+        if (!meshletVertices.empty() && meshletVertices.size() + newVertices > maxVertices)
+            endMeshlet(i);
+
+        // Add the triangle to the meshlet.
+        const unsigned int currentId = (unsigned int)meshlets.size();
+        for (int k = 0; k < 3; k++)
+        {
+            const unsigned int vertex = indices[i*3+k];
+            if (vertexMeshlets[vertex] != currentId) {
+                vertexMeshlets[vertex] = currentId;
+                meshletVertices.push_back(vertex);
+            }
+        }
+        const Vector3& pos0   = vertices[indices[i*3]].pos;
+        const Vector3  normal = (vertices[indices[i*3+1]].pos - pos0) ^ (vertices[indices[i*3+2]].pos - pos0);
+        const float    length = normal.getLength();
+        meshletNormals.push_back(length > 0 ? normal / length : Vector3());
+        normalSum = normalSum + meshletNormals.back();
+        if (meshletNormals.size() >= maxTriangles)
+            endMeshlet(i + 1);
+    }
+    if (!meshletVertices.empty())
+        endMeshlet(triangleCount);
+    return meshlets;
+}
@@ -0,0 +1,113 @@
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb-master/stb_image_resize.h>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "MipGenerator.h"
+using namespace Resources;
+
+
+// Proportion of the pixels whose alpha, multiplied by the given scale, is above the coverage reference.
+static float GetAlphaCoverage(const unsigned char* pixels, const size_t& pixelCount, const int& channels, const int& alphaChannel, const float& scale)
+{
+    if (pixelCount <= 0)
+        return 0;
+    const float reference = MipGenerator::AlphaCoverageReference * 255;
+    size_t coveredCount = 0;
+    for (size_t i = 0; i < pixelCount; i++)
+        if (pixels[i * channels + alphaChannel] * scale > reference)
+            coveredCount++;
+    return (float)coveredCount / pixelCount;
+}
+
+// Scales the alpha of the pixels so that their coverage is as close as possible to the given one.
+static void ScaleAlphaCoverage(unsigned char* pixels, const size_t& pixelCount, const int& channels, const int& alphaChannel, const float& coverage)
+{
+    // The coverage grows with the scale, so search the scale by bisection.
+    float minScale = 0, maxScale = 4, scale = 1;
+    for (int i = 0; i < 10; i++)
+    {
+        scale = (minScale + maxScale) / 2;
+        const float scaledCoverage = GetAlphaCoverage(pixels, pixelCount, channels, alphaChannel, scale);
+        if      (scaledCoverage < coverage) minScale = scale;
+        else if (scaledCoverage > coverage) maxScale = scale;
+        else break;
+    }
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        unsigned char& alpha = pixels[i * channels + alphaChannel];
+        alpha = (unsigned char)std::min(std::lround(alpha * scale), 255l);
+    }
+}
+
+// Makes the vectors stored in the first three channels of the pixels unit length again, vectors that averaged out to nothing face straight out of the surface.
+static void NormalizeVectors(unsigned char* pixels, const size_t& pixelCount, const int& channels)
+{
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        unsigned char* pixel = pixels + i * channels;
+        float vec[3], length = 0;
+        for (int j = 0; j < 3; j++) {
+            vec[j]  = pixel[j] / 127.5f - 1;
+            length += vec[j] * vec[j];
+        }
+        length = std::sqrt(length);
+        if (length < 0.05f) {
+            vec[0] = vec[1] = 0; vec[2] = length = 1;
+        }
+        for (int j = 0; j < 3; j++)
+            pixel[j] = (unsigned char)std::clamp(std::lround((vec[j] / length + 1) * 127.5f), 0l, 255l);
+    }
+}
+
+void MipGenerator::Generate(const unsigned char* pixels, const int& width, const int& height, const int& colorChannels, const TextureUsage& usage,
+                            std::vector<unsigned char>& levels, std::vector<size_t>& levelOffsets)
+{
+    levels.clear();
+    levelOffsets.clear();
+    if (pixels == nullptr || width <= 0 || height <= 0 || colorChannels <= 0)
+        return;
+
+    // Reserve all levels and copy the pixels in the first one.
+    const int levelCount = GetLevelCount(width, height);
+    levelOffsets.resize(levelCount + 1);
+    levelOffsets[0] = 0;
+    for (int i = 0; i < levelCount; i++)
+        levelOffsets[i + 1] = levelOffsets[i] + (size_t)std::max(width >> i, 1) * std::max(height >> i, 1) * colorChannels;
+    levels.resize(levelOffsets[levelCount]);
+    std::memcpy(levels.data(), pixels, levelOffsets[1]);
+
+    // Only colors are stored in sRGB, the alpha channel always is linear. Single channel alpha maps store their alpha in their only channel.
+    int alphaChannel = STBIR_ALPHA_CHANNEL_NONE;
+    if      (usage == TextureUsage::AlphaMap  && colorChannels == 1)     alphaChannel = 0;
+    else if (usage != TextureUsage::NormalMap && colorChannels % 2 == 0) alphaChannel = colorChannels - 1;
+    const bool  isColor      = (usage == TextureUsage::Color && colorChannels >= 3);
+    const bool  keepCoverage = (usage == TextureUsage::AlphaMap && alphaChannel != STBIR_ALPHA_CHANNEL_NONE);
+    const float coverage     = (keepCoverage ? GetAlphaCoverage(pixels, (size_t)width * height, colorChannels, alphaChannel, 1) : 0);
+
+    // Downsample each level from the previous one.
+    for (int i = 1; i < levelCount; i++)
+    {
+        const int srcWidth = std::max(width >> (i - 1), 1), srcHeight = std::max(height >> (i - 1), 1);
+        const int dstWidth = std::max(width >>  i,      1), dstHeight = std::max(height >>  i,      1);
+        const unsigned char* src = levels.data() + levelOffsets[i - 1];
+              unsigned char* dst = levels.data() + levelOffsets[i];
+        stbir_resize_uint8_generic(src, srcWidth, srcHeight, 0, dst, dstWidth, dstHeight, 0, colorChannels,
+                                   (colorChannels == 1 ? STBIR_ALPHA_CHANNEL_NONE : alphaChannel), 0, STBIR_EDGE_WRAP,
+                                   (usage == TextureUsage::NormalMap ? STBIR_FILTER_BOX : STBIR_FILTER_DEFAULT),
+                                   (isColor ? STBIR_COLORSPACE_SRGB : STBIR_COLORSPACE_LINEAR), nullptr);
+
+        const size_t pixelCount = (size_t)dstWidth * dstHeight;
+        if (usage == TextureUsage::NormalMap && colorChannels >= 3)
+            NormalizeVectors(dst, pixelCount, colorChannels);
+        if (keepCoverage)
+            ScaleAlphaCoverage(dst, pixelCount, colorChannels, alphaChannel, coverage);
+    }
+}
+
+int MipGenerator::GetLevelCount(const int& width, const int& height)
+{
+    return 1 + (int)std::log2(std::max(std::max(width, height), 1));
+}
@@ -1,6 +1,7 @@
 #include "MtlFile.h"
 #include "Mesh.h"
 #include "ResourceManager.h"
+#include "LoadTimeline.h"
 #include <filesystem>
 #include <fstream>
 using namespace Resources;
@@ -37,6 +38,7 @@ void MtlFile::Load()
     // Read file contents and extract them to the data string.
     std::stringstream fileContents;
     {
+        Core::ScopedLoadPhase readPhase(name, Core::LoadPhase::Read);
         std::fstream f(name, std::ios_base::in | std::ios_base::app);
         fileContents << f.rdbuf();
         f.close();
@@ -44,10 +46,15 @@ void MtlFile::Load()
     std::string filepath = std::filesystem::path(name).parent_path().string() + "/";
 
     // Read file line by line to create material data.
+    Core::ScopedLoadPhase parsePhase(name, Core::LoadPhase::Parse);
     std::string line;
     Material* curMaterial = nullptr;
     while (std::getline(fileContents, line)) 
     {
+        // Stop if the loading was cancelled.
+        if (IsLoadingCancelled())
+            return;
+
         // Create new material.
         if (line[0] == 'n' && line[1] == 'e' && line[2] == 'w')
         {
@@ -150,6 +157,7 @@ void MtlFile::Load()
             if (line[4] == 'd')
             {
                 std::string texName = line.substr(6, line.size()-7);
+                Texture::MarkUsage(filepath + texName, TextureUsage::AlphaMap);
                 curMaterial->alphaMap = resourceManager.Create<Texture>(filepath + texName);
                 createdResources.push_back(curMaterial->alphaMap);
                 continue;
@@ -162,12 +170,21 @@ void MtlFile::Load()
             if (bumpIndex != std::string::npos)
             {
                 std::string texName = line.substr(bumpIndex+5, line.size()-(bumpIndex+5)-1);
+                Texture::MarkUsage(filepath + texName, TextureUsage::NormalMap);
                 curMaterial->normalMap = resourceManager.Create<Texture>(filepath + texName);
                 createdResources.push_back(curMaterial->normalMap);
                 continue;
             }
         }
     }
+
+    // Remember which file creates the materials and textures to reload them if they are evicted.
+    for (IResource* resource : createdResources)
+    {
+        resourceManager.SetResourceSource(resource->GetName(), name);
+        if (resource->GetType() == ResourceTypes::Material)
+            ((Material*)resource)->SetDefined();
+    }
     SetLoadingDone();
 }
 
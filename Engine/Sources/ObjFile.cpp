@@ -1,201 +1,797 @@
+#include "Maths.h"
 #include "ObjFile.h"
 #include "MtlFile.h"
 #include "Mesh.h"
 #include "ResourceManager.h"
+#include "LoadTimeline.h"
+#include "MappedFile.h"
+#include "AssetCache.h"
 #include <filesystem>
-#include <fstream>
+#include <charconv>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+using namespace Core::Maths;
 using namespace Resources;
 
 
-void ObjFile::ParseObjVertexValues(const std::string& line, std::vector<float>& values, const int& startIndex, const int& valCount)
+// Returns the next line of the file without its line ending, and moves the cursor to the start of the following one.
+static bool NextLine(const char*& cursor, const char* end, std::string_view& line)
 {
-    // Find the start and end of the first value.
-    size_t start = startIndex;
-    size_t end = line.find(' ', start);
-    if (end == start) {
-        start++;
-        end = line.find(' ', start);
+    if (cursor >= end)
+        return false;
+    const char* lineEnd = (const char*)std::memchr(cursor, '\n', end - cursor);
+    if (lineEnd == nullptr)
+        lineEnd = end;
+    line   = std::string_view(cursor, lineEnd - cursor);
+    cursor = (lineEnd < end ? lineEnd + 1 : end);
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return true;
+}
+
+// Returns the text of the line after the given number of characters (names of objects, groups and materials).
+static std::string LineEnd(const std::string_view& line, const size_t& start)
+{
+    return std::string(line.size() > start ? line.substr(start) : std::string_view());
+}
+
+static const char* SkipSpaces(const char* cur, const char* end)
+{
+    while (cur < end && (*cur == ' ' || *cur == '\t'))
+        cur++;
+    return cur;
+}
+
+// Parses the float at the given position, values that can't be parsed are read as 0 like strtof does.
+static const char* ParseFloat(const char* cur, const char* end, float& value)
+{
+    cur = SkipSpaces(cur, end);
+    if (cur < end && *cur == '+')
+        cur++;
+    std::from_chars_result result = std::from_chars(cur, end, value);
+    if (result.ec != std::errc()) {
+        value = 0;
+        while (cur < end && *cur != ' ' && *cur != '\t')
+            cur++;
+        return cur;
     }
+    return result.ptr;
+}
 
+static void ParseObjVertexValues(const std::string_view& line, std::vector<float>& values, const size_t& startIndex, const int& valCount)
+{
+    const char* cur = line.data() + startIndex;
+    const char* end = line.data() + line.size();
     for (int i = 0; i < valCount; i++)
     {
-        // Find the current coordinate value.
-        std::string val = line.substr(start, end - start);
+        float value;
+        cur = ParseFloat(cur, end, value);
+        values.push_back(value);
+    }
+}
+
+// Number of values of the vertex positions, uvs and normals.
+static constexpr size_t ObjValueCounts[3] = { 3, 2, 3 };
 
-        // Set the current value.
-        values.push_back(std::strtof(val.c_str(), nullptr));
+// A line that changes the mesh being parsed, or a run of faces.
+struct ObjRecord
+{
+    char             type;
+    std::string_view line;
+    size_t           first = 0, count = 0;
+};
 
-        // Update the start and end indices.
-        start = end + 1;
-        end = line.find(' ', start);
+// Part of an obj file that starts and ends on line boundaries, parsed on its own.
+struct ObjChunk
+{
+    const char*            begin = nullptr;
+    const char*            end   = nullptr;
+    ObjVertexData          vertexData;
+    ObjVertexIndices       vertexIndices;
+    std::vector<ObjRecord> records;
+
+    // Positions of the negative indices, which are relative to the vertices of the previous chunks too.
+    std::array<std::vector<size_t>, 3> relativeIndices;
+};
+
+// Parses a face vertex (pos/uv/normal), missing indices are 0 and negative indices are relative to the vertices parsed before.
+static const char* ParseObjFaceVertex(const char* cur, const char* end, ObjChunk& chunk)
+{
+    cur = SkipSpaces(cur, end);
+    for (int i = 0; i < 3; i++)
+    {
+        long long index = 0;
+        if (cur < end && *cur == '+')
+            cur++;
+        std::from_chars_result result = std::from_chars(cur, end, index);
+        if (result.ec == std::errc()) {
+            cur = result.ptr;
+            if (index < 0) {
+                chunk.relativeIndices[i].push_back(chunk.vertexIndices[i].size());
+                index += (long long)(chunk.vertexData[i].size() / ObjValueCounts[i]);
+            }
+            else {
+                index -= 1;
+            }
+        }
+        chunk.vertexIndices[i].push_back((uint32_t)index);
+
+        // Go to the next index, or stop at the end of the vertex.
+        if (cur < end && *cur == '/')
+            cur++;
+        else {
+            for (int j = i + 1; j < 3; j++)
+                chunk.vertexIndices[j].push_back(0);
+            break;
+        }
     }
+    while (cur < end && *cur != ' ' && *cur != '\t')
+        cur++;
+    return cur;
 }
 
-void ObjFile::ParseObjObjectLine(const std::string& line, Mesh*& meshGroup)
+// Parses the vertex values and faces of a chunk, and keeps the other lines to apply them in order once all chunks are parsed.
+static void ParseObjChunk(ObjChunk& chunk, const IResource& file)
 {
-    // Let the previous mesh group send its vertices to OpenGL.
-    if (meshGroup!= nullptr && meshGroup->subMeshes.size() > 0) {
-        meshGroup->subMeshes.back()->SetLoadingDone();
-        meshGroup->SetLoadingDone();
+    Core::ScopedLoadPhase parsePhase(file.GetName(), Core::LoadPhase::Parse);
+
+    // Count the vertex values first to allocate them all at once.
+    // Format: vertexData[0] = positions, vertexData[1] = uvs, vertexData[2] = normals.
+    std::string_view line;
+    {
+        std::array<size_t, 3> counts = { 0, 0, 0 };
+        for (const char* cursor = chunk.begin; NextLine(cursor, chunk.end, line);)
+        {
+            if (line.size() < 2 || line[0] != 'v') continue;
+            if      (line[1] == ' ') counts[0]++;
+            else if (line[1] == 't') counts[1]++;
+            else if (line[1] == 'n') counts[2]++;
+        }
+        for (int i = 0; i < 3; i++)
+            chunk.vertexData[i].reserve(counts[i] * ObjValueCounts[i]);
     }
 
-    meshGroup = resourceManager.Create<Mesh>(line.substr(2, line.size()-3));
+    // Read the chunk line by line.
+    size_t lineCount = 0;
+    for (const char* cursor = chunk.begin; NextLine(cursor, chunk.end, line);)
+    {
+        // Stop if the loading was cancelled.
+        if (++lineCount % 4096 == 0 && file.IsLoadingCancelled())
+            return;
+        if (line.empty())
+            continue;
+
+        switch (line[0])
+        {
+        case 'v':
+            switch (line.size() > 1 ? line[1] : '\0')
+            {
+            // Parse vertex coords.
+            case ' ':
+                ParseObjVertexValues(line, chunk.vertexData[0], 2, 3);
+                break;
+            // Parse vertex UVs.
+            case 't':
+                ParseObjVertexValues(line, chunk.vertexData[1], 3, 2);
+                break;
+            // Parse vertex normals.
+            case 'n':
+                ParseObjVertexValues(line, chunk.vertexData[2], 3, 3);
+                break;
+            default:
+                break;
+            }
+            break;
+
+        // Parse faces, consecutive ones are added to the same run. Only triangles are supported, the first 3 vertices of each face are used.
+        case 'f':
+        {
+            if (chunk.records.empty() || chunk.records.back().type != 'f')
+                chunk.records.push_back({ 'f', line, chunk.vertexIndices[0].size(), 0 });
+            const char* cur     = line.data() + 1;
+            const char* lineEnd = line.data() + line.size();
+            for (int i = 0; i < 3; i++)
+                cur = ParseObjFaceVertex(cur, lineEnd, chunk);
+            chunk.records.back().count += 3;
+            break;
+        }
+
+        // Objects, groups, material libraries and materials.
+        case 'o':
+        case 'g':
+        case 'm':
+        case 'u':
+            chunk.records.push_back({ line[0], line });
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+Mesh* ObjFile::CreateMesh(const std::string& meshName)
+{
+    if (reloadedCopy) {
+        Mesh* meshGroup = new Mesh(meshName);
+        createdResources.push_back(meshGroup);
+        return meshGroup;
+    }
+
+    // Remember which file creates this mesh to prioritize its loading job now and on the next loads.
+    Mesh* meshGroup = resourceManager.Create<Mesh>(meshName);
+    resourceManager.SetMeshSource(meshName, name, GetLoadingJob());
     createdResources.push_back(meshGroup);
+    return meshGroup;
+}
+
+Material* ObjFile::GetMaterial(const std::string& materialName)
+{
+    // Reloaded copies only use the materials that already exist, they don't register or queue resources.
+    if (reloadedCopy)
+        return resourceManager.Lookup<Material>(materialName);
+    return resourceManager.Create<Material>(materialName);
 }
 
-void ObjFile::ParseObjGroupLine(const std::string& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram)
+void ObjFile::AddMtlLib(const std::string& mtlLib)
 {
-    if (line[2] == '\0')
+    if (std::find(mtlLibs.begin(), mtlLibs.end(), mtlLib) != mtlLibs.end())
+        return;
+    mtlLibs.push_back(mtlLib);
+    if (reloadedCopy)
+        return;
+    createdResources.push_back(resourceManager.Create<MtlFile>(mtlLib));
+    resourceManager.SetResourceSource(mtlLib, name);
+}
+
+void ObjFile::EndSubMesh(Mesh* meshGroup)
+{
+    // Keep the sub-mesh to create its vertices and mark it as loaded once the whole file is parsed.
+    SubMesh* subMesh = meshGroup->subMeshes.back();
+    if (subMeshFaces.empty() || subMeshFaces.back().subMesh != subMesh)
+        subMeshFaces.push_back({ meshGroup, subMesh, {} });
+}
+
+void ObjFile::ParseObjObjectLine(const std::string_view& line, Mesh*& meshGroup)
+{
+    // End the last sub-mesh of the previous mesh group.
+    if (meshGroup!= nullptr && meshGroup->subMeshes.size() > 0)
+        EndSubMesh(meshGroup);
+
+    meshGroup = CreateMesh(LineEnd(line, 2));
+}
+
+void ObjFile::ParseObjGroupLine(const std::string_view& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram)
+{
+    if (line.size() < 2)
         return;
 
     // Make sure a mesh group was already created.
-    if (meshGroup == nullptr) {
-        meshGroup = resourceManager.Create<Mesh>("mesh_" + std::filesystem::path(name).stem().string());
-        createdResources.push_back(meshGroup);
-    }
+    if (meshGroup == nullptr)
+        meshGroup = CreateMesh("mesh_" + std::filesystem::path(name).stem().string());
 
-    // Send all vertex data from the previous model to openGL.
-    if (meshGroup->subMeshes.size() > 0) {
-        meshGroup->subMeshes.back()->SetLoadingDone();
-        meshGroup->SetLoadingDone();
-    }
+    // End the previous model.
+    if (meshGroup->subMeshes.size() > 0)
+        EndSubMesh(meshGroup);
 
     // Create a model and add it to the mesh group.
-    meshGroup->subMeshes.push_back(new SubMesh(line.substr(2, line.size() - 3), meshShaderProgram));
+    meshGroup->subMeshes.push_back(new SubMesh(LineEnd(line, 2), meshShaderProgram));
 }
 
-void ObjFile::ParseObjUsemtlLine(const std::string& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram)
+void ObjFile::ParseObjUsemtlLine(const std::string_view& line, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram)
 {
     // Make sure a mesh group was already created.
-    if (meshGroup == nullptr) {
-        meshGroup = resourceManager.Create<Mesh>("mesh_" + std::filesystem::path(name).stem().string());
-        createdResources.push_back(meshGroup);
-    }
+    if (meshGroup == nullptr)
+        meshGroup = CreateMesh("mesh_" + std::filesystem::path(name).stem().string());
 
     // Make sure a mesh was already created.
     if (meshGroup->subMeshes.size() <= 0)
-        meshGroup->subMeshes.push_back(new SubMesh("submesh_" + line.substr(7, line.size() - 8), meshShaderProgram));
+        meshGroup->subMeshes.push_back(new SubMesh("submesh_" + LineEnd(line, 7), meshShaderProgram));
 
     // Make sure the current mesh doesn't already have a material.
     else if (meshGroup->subMeshes.back()->GetMaterial() != nullptr) {
-        meshGroup->subMeshes.back()->SetLoadingDone();
-        meshGroup->subMeshes.push_back(new SubMesh("submesh_" + line.substr(7, line.size() - 8), meshShaderProgram));
+        EndSubMesh(meshGroup);
+        meshGroup->subMeshes.push_back(new SubMesh("submesh_" + LineEnd(line, 7), meshShaderProgram));
     }
 
-    // Set the current model's material.
-    meshGroup->subMeshes.back()->SetMaterial(resourceManager.Get<Material>(line.substr(7, line.size() - 8)));
+    // Set the current model's material (it is created here if its material library is still loading).
+    meshGroup->subMeshes.back()->SetMaterial(GetMaterial(LineEnd(line, 7)));
 }
 
-void ObjFile::ParseObjIndices(const std::string& line, std::stringstream& fileContents, Mesh*& meshGroup, std::array<std::vector<float>, 3>& vertexData, const ShaderProgram* meshShaderProgram)
+void ObjFile::ParseObjFaces(const ObjFaceRun& faces, Mesh*& meshGroup, const ShaderProgram* meshShaderProgram)
 {
     // Make sure a mesh group was already created.
-    if (meshGroup == nullptr) {
-        meshGroup = resourceManager.Create<Mesh>("mesh_" + std::filesystem::path(name).stem().string());
-        createdResources.push_back(meshGroup);
-    }
+    if (meshGroup == nullptr)
+        meshGroup = CreateMesh("mesh_" + std::filesystem::path(name).stem().string());
 
     // Make sure a mesh was already created.
     if (meshGroup->subMeshes.size() <= 0)
         meshGroup->subMeshes.push_back(new SubMesh("submesh_" + std::filesystem::path(name).stem().string(), meshShaderProgram));
 
-    // Let the current model parse its vertices.
-    fileContents.seekg(fileContents.tellg() - std::streamoff(line.size()));
-    meshGroup->subMeshes.back()->LoadVertices(fileContents, vertexData);
+    // Add the faces to the current model.
+    EndSubMesh(meshGroup);
+    subMeshFaces.back().faces.push_back(faces);
 }
 
-ObjFile::ObjFile(const std::string& _name, ResourceManager& _resourceManager)
-    : resourceManager(_resourceManager)
+ObjFile::ObjFile(const std::string& _name, ResourceManager& _resourceManager, const bool& _reloadedCopy)
+    : resourceManager(_resourceManager), reloadedCopy(_reloadedCopy)
 {
     name = _name;
     type = ResourceTypes::ObjFile;
 }
 
-void ObjFile::Load()
+bool ObjFile::ParseFile(const ShaderProgram* shaderProgram, const Core::AssetCacheKey& cacheKey, std::string& details)
 {
-    const ShaderProgram* shaderProgram = resourceManager.Get<ShaderProgram>("MeshShaderProgram"); // TEMP: Should be done automatically.
+    const std::chrono::steady_clock::time_point parseStart = std::chrono::steady_clock::now();
 
-    // Start chrono.
-    std::chrono::steady_clock::time_point chronoStart = std::chrono::high_resolution_clock::now();
-
-    // Read file contents and extract them to the data string.
-    std::stringstream fileContents;
+    // Map the file in memory, it is parsed in place.
+    Core::MappedFile file;
     {
-        std::fstream f(name, std::ios_base::in | std::ios_base::app);
-        fileContents << f.rdbuf();
-        f.close();
+        Core::ScopedLoadPhase readPhase(name, Core::LoadPhase::Read);
+        if (!file.Open(name))
+            DebugLogWarning("Unable to open obj file: " + name);
     }
+    const char* const begin = file.GetData();
+    const char* const end   = file.GetEnd();
     std::string filepath = std::filesystem::path(name).parent_path().string() + "/";
 
-    // Define dynamic arrays for positions, uvs, and normals.
-    // Format: vertexData[0] = positions, vertexData[1] = uvs, vertexData[2] = normals.
-    std::array<std::vector<float>, 3> vertexData;
+    // Queue the material libraries of the header (the lines before the first vertex or face) right away, so they are loaded by other workers while the file is parsed.
+    {
+        const char* cursor = begin;
+        std::string_view line;
+        while (NextLine(cursor, end, line))
+        {
+            if (!line.empty() && (line[0] == 'v' || line[0] == 'f'))
+                break;
+            if (line.size() > 7 && line.substr(0, 7) == "mtllib ")
+                AddMtlLib(filepath + LineEnd(line, 7));
+        }
+    }
 
-    // Store a pointer to the mesh group that is currently being created.
-    Mesh* meshGroup = nullptr;
+    // Split big files in chunks that start and end on line boundaries, parsed by the job system's workers when loading from a job.
+    Core::JobHandle  loadingJob = Core::JobSystem::CurrentJob();
+    Core::JobSystem* jobSystem  = (chunkedParsing && loadingJob.IsValid() ? loadingJob.GetJob()->system : nullptr);
+    size_t chunkCount = 1;
+    if (jobSystem != nullptr)
+        chunkCount = std::clamp(file.GetSize() / MinChunkSize, (size_t)1, (size_t)jobSystem->GetThreadCount() + 1);
+    std::vector<ObjChunk> chunks(chunkCount);
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        chunks[i].begin = (i > 0 ? chunks[i-1].end : begin);
+        chunks[i].end   = end;
+        if (i < chunkCount - 1) {
+            const char* split   = std::max(chunks[i].begin, begin + file.GetSize() * (i+1) / chunkCount);
+            const char* lineEnd = (const char*)std::memchr(split, '\n', end - split);
+            chunks[i].end = (lineEnd != nullptr ? lineEnd + 1 : end);
+        }
+    }
+    if (chunkCount > 1)
+        jobSystem->ParallelFor(0, chunkCount, 1, [this, &chunks](const size_t& i) { ParseObjChunk(chunks[i], *this); });
+    else
+        ParseObjChunk(chunks[0], *this);
+    if (IsLoadingCancelled())
+        return false;
+
+    // Gather the vertex values of all chunks, and offset their relative indices by the vertices of the previous chunks.
+    const Core::LoadTimeline::Clock::time_point mergeStart = Core::LoadTimeline::Clock::now();
+    ObjVertexData vertexData;
+    if (chunkCount > 1)
+    {
+        std::vector<std::array<size_t, 3>> valueOffsets(chunkCount + 1, { 0, 0, 0 });
+        for (size_t i = 0; i < chunkCount; i++)
+            for (int j = 0; j < 3; j++)
+                valueOffsets[i+1][j] = valueOffsets[i][j] + chunks[i].vertexData[j].size();
+        for (int j = 0; j < 3; j++)
+            vertexData[j].resize(valueOffsets[chunkCount][j]);
+
+        jobSystem->ParallelFor(0, chunkCount, 1, [&chunks, &vertexData, &valueOffsets](const size_t& i)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                std::copy(chunks[i].vertexData[j].begin(), chunks[i].vertexData[j].end(), vertexData[j].begin() + valueOffsets[i][j]);
+                std::vector<float>().swap(chunks[i].vertexData[j]);
 
-    // Read file line by line to create vertex data.
-    std::string line;
-    while (std::getline(fileContents, line))
+                const uint32_t vertexOffset = (uint32_t)(valueOffsets[i][j] / ObjValueCounts[j]);
+                for (const size_t& position : chunks[i].relativeIndices[j])
+                    chunks[i].vertexIndices[j][position] += vertexOffset;
+            }
+        });
+    }
+    else
     {
-        line += ' ';
-        switch (line[0])
+        vertexData = std::move(chunks[0].vertexData);
+    }
+
+    // Create the meshes, sub-meshes and materials in the order of the file.
+    Mesh* meshGroup = nullptr;
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        for (const ObjRecord& record : chunks[i].records)
         {
-        case 'v':
-            switch (line[1])
+            switch (record.type)
             {
-            // Parse vertex coords and normals.
-            case ' ':
-                ParseObjVertexValues(line, vertexData[0], 2, 3);
+            case 'o':
+                ParseObjObjectLine(record.line, meshGroup);
                 break;
-            // Parse vertex UVs.
-            case 't':
-                ParseObjVertexValues(line, vertexData[1], 3, 2);
+
+            case 'g':
+                ParseObjGroupLine(record.line, meshGroup, shaderProgram);
                 break;
-            // Parse vertex normals.
-            case 'n':
-                ParseObjVertexValues(line, vertexData[2], 3, 3);
+
+            // Material libraries after the header of the file are only found once it is parsed.
+            case 'm':
+                AddMtlLib(filepath + LineEnd(record.line, 7));
+                break;
+
+            case 'u':
+                ParseObjUsemtlLine(record.line, meshGroup, shaderProgram);
                 break;
+
+            case 'f':
+                ParseObjFaces({ i, record.first, record.count }, meshGroup, shaderProgram);
+                break;
+
             default:
                 break;
             }
-            break;
+        }
+    }
+    if (meshGroup != nullptr && meshGroup->subMeshes.size() > 0) {
+        EndSubMesh(meshGroup);
+    }
+    else {
+        DebugLogWarning("Mesh has no sub-meshes after being loaded from obj file: " + name);
+    }
+    Core::LoadTimeline::Record(name, Core::LoadPhase::Parse, mergeStart, Core::LoadTimeline::Clock::now());
 
-        case 'o':
-            ParseObjObjectLine(line, meshGroup);
-            break;
+    // Create the vertices of each sub-mesh.
+    auto createVertices = [this, &chunks, &vertexData, jobSystem](const size_t& i)
+    {
+        if (IsLoadingCancelled())
+            return;
+        const ObjSubMeshFaces& subMesh = subMeshFaces[i];
+        for (const ObjFaceRun& faces : subMesh.faces)
+            subMesh.subMesh->LoadVertices(vertexData, chunks[faces.chunk].vertexIndices, faces.first, faces.count);
+        subMesh.subMesh->WeldVertices();
+        subMesh.subMesh->GenerateTangents(jobSystem);
+        subMesh.subMesh->OptimizeIndices();
+        subMesh.subMesh->BuildMeshlets();
+        subMesh.subMesh->GenerateLods();
+        subMesh.subMesh->CompressVertices();
+    };
+    if (jobSystem != nullptr)
+        jobSystem->ParallelFor(0, subMeshFaces.size(), 1, createVertices);
+    else
+        for (size_t i = 0; i < subMeshFaces.size(); i++)
+            createVertices(i);
+    if (IsLoadingCancelled()) {
+        subMeshFaces.clear();
+        return false;
+    }
 
-        case 'g':
-            ParseObjGroupLine(line, meshGroup, shaderProgram);
-            break;
+    // Save the meshes for the next loads, before the main thread starts sending them to OpenGL.
+    if (useCache)
+        WriteCache(cacheKey);
 
-        case 'm':
-            createdResources.push_back(resourceManager.Create<MtlFile>(filepath + line.substr(7, line.size()-8)));
-            break;
+    // Log the vertex cache efficiency of each sub-mesh, in the obj file's order and after optimizing it, and the triangles of its levels of detail.
+    if (!reloadedCopy)
+    {
+        for (const ObjSubMeshFaces& subMesh : subMeshFaces)
+        {
+            const VertexCacheStats& before = subMesh.subMesh->GetCacheStatsBefore();
+            const VertexCacheStats& after  = subMesh.subMesh->GetCacheStatsAfter();
+            char stats[128];
+            std::snprintf(stats, sizeof(stats), ": ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, LOD triangles:", before.acmr, after.acmr, before.atvr, after.atvr);
+            std::string lodTriangles;
+            for (unsigned int i = 0; i < subMesh.subMesh->GetLodCount(); i++)
+                lodTriangles += " " + std::to_string(subMesh.subMesh->GetLod(i).indexCount / 3);
+            DebugLog(name + " - " + subMesh.subMesh->GetName() + stats + lodTriangles);
+        }
+    }
 
-        case 'u':
-            ParseObjUsemtlLine(line, meshGroup, shaderProgram);
-            break;
+    // Let the main thread send the sub-meshes to OpenGL without waiting for the materials.
+    for (const ObjSubMeshFaces& subMesh : subMeshFaces) {
+        subMesh.subMesh->SetLoadingDone();
+        subMesh.meshGroup->NotifyStateChanged();
+    }
+    subMeshFaces.clear();
 
-        case 'f':
-            ParseObjIndices(line, fileContents, meshGroup, vertexData, shaderProgram);
-            break;
+    details = std::to_string(file.GetSize() / (std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - parseStart).count())) + " MB/s, " + std::to_string(chunkCount) + " chunk(s)";
+    return true;
+}
 
-        default:
-            break;
+void ObjFile::Load()
+{
+    const ShaderProgram* shaderProgram = resourceManager.Get<ShaderProgram>("MeshShaderProgram"); // TEMP: Should be done automatically.
+
+    // Start chrono.
+    std::chrono::steady_clock::time_point chronoStart = std::chrono::steady_clock::now();
+
+    // Load the processed meshes from the asset cache, their key changes when the obj file is modified or the mesh processing settings change.
+    const Core::AssetCacheKey cacheKey(name, CacheImporter, CacheVersion, (uint64_t)SubMesh::IndexOptimization() | (uint64_t)SubMesh::LodGeneration() << 1);
+    std::string details = "from cache";
+    if (!useCache || !LoadFromCache(shaderProgram, cacheKey))
+    {
+        if (!ParseFile(shaderProgram, cacheKey, details)) {
+            DebugLog("Cancelled loading of file " + name);
+            return;
         }
     }
-    if (meshGroup != nullptr && meshGroup->subMeshes.size() > 0) {
-        meshGroup->subMeshes.back()->SetLoadingDone();
-        meshGroup->SetLoadingDone();
+
+    // End chrono.
+    std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - chronoStart;
+    DebugLog("Loading file " + name + " took " + std::to_string(elapsed.count() * 1e-9) + " seconds (" + details + ").");
+
+    // The meshes are ready once their materials and textures are loaded too, which is when this loading job and its children are done.
+    // The continuation becomes the file's loading job, so waiting for the file also waits for it.
+    Core::JobHandle loadingJob = Core::JobSystem::CurrentJob();
+    if (loadingJob.IsValid())
+        SetLoadingJob(loadingJob.GetJob()->system->Then(loadingJob, [this]() { SetMeshesLoadingDone(); }));
+    else
+        SetMeshesLoadingDone();
+}
+
+// ----- Binary mesh cache ----- //
+
+// Layout of the mesh cache of an obj file: this header, the mtl libraries, meshes and sub-meshes, their names, then the vertices, indices and meshlets of all sub-meshes.
+// All sections are 8 byte aligned so the mapped file is read in place, and the vertices and indices can be sent to OpenGL as they are.
+struct MeshCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t mtlLibCount, meshCount, subMeshCount, namesSize;
+    uint64_t vertexCount, indexCount, meshletCount;
+};
+
+struct MeshCacheName
+{
+    uint32_t offset, size;
+};
+
+struct MeshCacheMesh
+{
+    MeshCacheName name;
+    uint32_t      firstSubMesh, subMeshCount;
+};
+
+struct MeshCacheSubMesh
+{
+    MeshCacheName name, material; // Sub-meshes without material have an empty material name.
+    uint32_t      unweldedVertexCount, lodCount;
+    uint64_t      firstVertex, vertexCount, firstIndex, indexCount, firstMeshlet, meshletCount;
+    float         boundsMin[3], boundsMax[3];
+    float         acmrBefore, atvrBefore, acmrAfter, atvrAfter;
+    SubMeshLod    lods[SubMesh::MaxLodCount]; // Index ranges relative to the sub-mesh's first index.
+};
+
+static size_t AlignCacheSize(const size_t& size) { return (size + 7) & ~(size_t)7; }
+
+// Offsets of the sections of a mesh cache file.
+struct MeshCacheLayout
+{
+    size_t mtlLibs, meshes, subMeshes, names, vertices, indices, meshlets, end;
+
+    MeshCacheLayout(const MeshCacheHeader& header)
+    {
+        mtlLibs   = sizeof(MeshCacheHeader);
+        meshes    = mtlLibs   + header.mtlLibCount  * sizeof(MeshCacheName);
+        subMeshes = meshes    + header.meshCount    * sizeof(MeshCacheMesh);
+        names     = subMeshes + header.subMeshCount * sizeof(MeshCacheSubMesh);
+        vertices  = names     + AlignCacheSize(header.namesSize);
+        indices   = vertices  + header.vertexCount  * sizeof(TangentVertex);
+        meshlets  = indices   + AlignCacheSize(header.indexCount * sizeof(unsigned int));
+        end       = meshlets  + header.meshletCount * sizeof(Meshlet);
     }
-    else {
-        DebugLogWarning("Mesh has no sub-meshes after being loaded from obj file: " + name);
+};
+
+bool ObjFile::LoadFromCache(const ShaderProgram* shaderProgram, const Core::AssetCacheKey& cacheKey)
+{
+    Core::CachedAsset file;
+    {
+        Core::ScopedLoadPhase readPhase(name, Core::LoadPhase::Read);
+        if (!file.Open(cacheKey))
+            return false;
     }
 
-    // End chrono.
-    std::chrono::steady_clock::time_point chronoEnd = std::chrono::high_resolution_clock::now();
-    std::chrono::nanoseconds elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(chronoEnd - chronoStart);
-    DebugLog((std::string("Loading file ") + name + std::string(" took ") + std::to_string(elapsed.count() * 1e-9) + " seconds.").c_str());
+    // Make sure the cache was written with this layout.
+    if (file.GetSize() < sizeof(MeshCacheHeader))
+        return false;
+    const MeshCacheHeader& header = *(const MeshCacheHeader*)file.GetData();
+    if (std::memcmp(header.magic, "MESH", 4) != 0 || header.version != CacheVersion
+        || header.vertexCount > file.GetSize() || header.indexCount > file.GetSize() || header.meshletCount > file.GetSize())
+        return false;
+    const MeshCacheLayout layout(header);
+    if (layout.end != file.GetSize())
+        return false;
+
+    const MeshCacheName*    cachedMtlLibs   = (const MeshCacheName*   )(file.GetData() + layout.mtlLibs);
+    const MeshCacheMesh*    cachedMeshes    = (const MeshCacheMesh*   )(file.GetData() + layout.meshes);
+    const MeshCacheSubMesh* cachedSubMeshes = (const MeshCacheSubMesh*)(file.GetData() + layout.subMeshes);
+    const char*             cachedNames     = file.GetData() + layout.names;
+    const TangentVertex*    cachedVertices  = (const TangentVertex*   )(file.GetData() + layout.vertices);
+    const unsigned int*     cachedIndices   = (const unsigned int*    )(file.GetData() + layout.indices);
+    const Meshlet*          cachedMeshlets  = (const Meshlet*         )(file.GetData() + layout.meshlets);
+
+    // Check all ranges before creating any resource.
+    auto isNameValid = [&header](const MeshCacheName& cachedName) { return (uint64_t)cachedName.offset + cachedName.size <= header.namesSize; };
+    for (uint32_t i = 0; i < header.mtlLibCount; i++)
+        if (!isNameValid(cachedMtlLibs[i]))
+            return false;
+    for (uint32_t i = 0; i < header.meshCount; i++)
+        if (!isNameValid(cachedMeshes[i].name) || (uint64_t)cachedMeshes[i].firstSubMesh + cachedMeshes[i].subMeshCount > header.subMeshCount)
+            return false;
+    for (uint32_t i = 0; i < header.subMeshCount; i++)
+    {
+        const MeshCacheSubMesh& subMesh = cachedSubMeshes[i];
+        if (!isNameValid(subMesh.name) || !isNameValid(subMesh.material)
+            || subMesh.firstVertex > header.vertexCount || subMesh.vertexCount > header.vertexCount - subMesh.firstVertex
+            || subMesh.firstIndex  > header.indexCount  || subMesh.indexCount  > header.indexCount  - subMesh.firstIndex
+            || subMesh.firstMeshlet > header.meshletCount || subMesh.meshletCount > header.meshletCount - subMesh.firstMeshlet
+            || subMesh.lodCount < 1 || subMesh.lodCount > SubMesh::MaxLodCount)
+            return false;
+        for (uint32_t j = 0; j < subMesh.lodCount; j++)
+            if ((uint64_t)subMesh.lods[j].firstIndex + subMesh.lods[j].indexCount > subMesh.indexCount)
+                return false;
+        for (uint64_t j = subMesh.firstMeshlet; j < subMesh.firstMeshlet + subMesh.meshletCount; j++)
+            if ((uint64_t)cachedMeshlets[j].firstIndex + cachedMeshlets[j].indexCount > subMesh.indexCount)
+                return false;
+    }
+    auto getName = [cachedNames](const MeshCacheName& cachedName) { return std::string(cachedNames + cachedName.offset, cachedName.size); };
+
+    // Load the material libraries.
+    for (uint32_t i = 0; i < header.mtlLibCount; i++)
+    {
+        mtlLibs.push_back(getName(cachedMtlLibs[i]));
+        if (reloadedCopy)
+            continue;
+        createdResources.push_back(resourceManager.Create<MtlFile>(mtlLibs.back()));
+        resourceManager.SetResourceSource(createdResources.back()->GetName(), name);
+    }
+
+    // Create the meshes and copy their vertices.
+    std::vector<SubMesh*> loadedSubMeshes;
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+        Mesh* meshGroup = CreateMesh(getName(cachedMeshes[i].name));
+        for (uint32_t j = cachedMeshes[i].firstSubMesh; j < cachedMeshes[i].firstSubMesh + cachedMeshes[i].subMeshCount; j++)
+        {
+            const MeshCacheSubMesh& cachedSubMesh = cachedSubMeshes[j];
+            SubMesh* subMesh = new SubMesh(getName(cachedSubMesh.name), shaderProgram);
+            if (cachedSubMesh.material.size > 0)
+                subMesh->SetMaterial(GetMaterial(getName(cachedSubMesh.material)));
+            subMesh->SetCachedVertices(cachedVertices + cachedSubMesh.firstVertex, (size_t)cachedSubMesh.vertexCount, cachedIndices + cachedSubMesh.firstIndex, (size_t)cachedSubMesh.indexCount, cachedSubMesh.unweldedVertexCount,
+                                       Vector3(cachedSubMesh.boundsMin[0], cachedSubMesh.boundsMin[1], cachedSubMesh.boundsMin[2]),
+                                       Vector3(cachedSubMesh.boundsMax[0], cachedSubMesh.boundsMax[1], cachedSubMesh.boundsMax[2]));
+            subMesh->SetCachedVertexCacheStats({ cachedSubMesh.acmrBefore, cachedSubMesh.atvrBefore }, { cachedSubMesh.acmrAfter, cachedSubMesh.atvrAfter });
+            subMesh->SetCachedLods    (cachedSubMesh.lods, cachedSubMesh.lodCount);
+            subMesh->SetCachedMeshlets(cachedMeshlets + cachedSubMesh.firstMeshlet, (size_t)cachedSubMesh.meshletCount);
+            meshGroup->subMeshes.push_back(subMesh);
+            loadedSubMeshes.push_back(subMesh);
+        }
+    }
+
+    // The compact vertices aren't cached since they depend on the vertex compression setting, compress them with the job system running this load.
+    Core::JobHandle  currentJob = Core::JobSystem::CurrentJob();
+    Core::JobSystem* jobSystem  = (currentJob.IsValid() ? currentJob.GetJob()->system : nullptr);
+    if (jobSystem != nullptr)
+        jobSystem->ParallelFor(0, loadedSubMeshes.size(), 1, [&loadedSubMeshes](const size_t& i) { loadedSubMeshes[i]->CompressVertices(); });
+    else
+        for (SubMesh* subMesh : loadedSubMeshes)
+            subMesh->CompressVertices();
+
+    // Let the main thread send the sub-meshes to OpenGL.
+    for (IResource* resource : createdResources)
+    {
+        if (resource->GetType() != ResourceTypes::Mesh)
+            continue;
+        for (SubMesh* subMesh : ((Mesh*)resource)->subMeshes)
+            subMesh->SetLoadingDone();
+        resource->NotifyStateChanged();
+    }
+    return true;
+}
+
+void ObjFile::WriteCache(const Core::AssetCacheKey& cacheKey) const
+{
+    // Gather the names and sections of all meshes.
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, "MESH", 4);
+    header.version = CacheVersion;
+
+    std::string names;
+    auto addName = [&names](const std::string& newName)
+    {
+        MeshCacheName cachedName = { (uint32_t)names.size(), (uint32_t)newName.size() };
+        names += newName;
+        return cachedName;
+    };
+
+    std::vector<MeshCacheName>    cachedMtlLibs;
+    std::vector<MeshCacheMesh>    cachedMeshes;
+    std::vector<MeshCacheSubMesh> cachedSubMeshes;
+    std::vector<const SubMesh*>   subMeshes;
+    for (const std::string& mtlLib : mtlLibs)
+        cachedMtlLibs.push_back(addName(mtlLib));
+    for (IResource* resource : createdResources)
+    {
+        if (resource->GetType() != ResourceTypes::Mesh)
+            continue;
+        cachedMeshes.push_back({ addName(resource->GetName()), (uint32_t)cachedSubMeshes.size(), (uint32_t)((Mesh*)resource)->subMeshes.size() });
+        for (SubMesh* subMesh : ((Mesh*)resource)->subMeshes)
+        {
+            MeshCacheSubMesh cachedSubMesh = {};
+            cachedSubMesh.name                = addName(subMesh->GetName());
+            cachedSubMesh.material            = addName(subMesh->GetMaterial() != nullptr ? subMesh->GetMaterial()->GetName() : "");
+            cachedSubMesh.unweldedVertexCount = subMesh->GetUnweldedVertexCount();
+            cachedSubMesh.firstVertex         = header.vertexCount;
+            cachedSubMesh.vertexCount         = subMesh->GetVertices().size();
+            cachedSubMesh.firstIndex          = header.indexCount;
+            cachedSubMesh.indexCount          = subMesh->GetIndices().size();
+            cachedSubMesh.firstMeshlet        = header.meshletCount;
+            cachedSubMesh.meshletCount        = subMesh->GetMeshlets().size();
+            for (int i = 0; i < 3; i++) {
+                cachedSubMesh.boundsMin[i] = (&subMesh->GetBoundsMin().x)[i];
+                cachedSubMesh.boundsMax[i] = (&subMesh->GetBoundsMax().x)[i];
+            }
+            cachedSubMesh.acmrBefore = subMesh->GetCacheStatsBefore().acmr;
+            cachedSubMesh.atvrBefore = subMesh->GetCacheStatsBefore().atvr;
+            cachedSubMesh.acmrAfter  = subMesh->GetCacheStatsAfter ().acmr;
+            cachedSubMesh.atvrAfter  = subMesh->GetCacheStatsAfter ().atvr;
+            cachedSubMesh.lodCount   = subMesh->GetLodCount();
+            for (uint32_t i = 0; i < cachedSubMesh.lodCount; i++)
+                cachedSubMesh.lods[i] = subMesh->GetLod(i);
+            header.vertexCount  += cachedSubMesh.vertexCount;
+            header.indexCount   += cachedSubMesh.indexCount;
+            header.meshletCount += cachedSubMesh.meshletCount;
+            cachedSubMeshes.push_back(cachedSubMesh);
+            subMeshes      .push_back(subMesh);
+        }
+    }
+    if (cachedMeshes.empty())
+        return;
+    header.mtlLibCount  = (uint32_t)cachedMtlLibs  .size();
+    header.meshCount    = (uint32_t)cachedMeshes   .size();
+    header.subMeshCount = (uint32_t)cachedSubMeshes.size();
+    header.namesSize    = (uint32_t)names.size();
+    names.resize(AlignCacheSize(names.size()), '\0');
+
+    // Copy the sections to the data given to the cache writer, the sub-meshes may free their geometry before it is written.
+    const MeshCacheLayout layout(header);
+    std::vector<char> data(layout.end, '\0');
+    char* cursor = data.data();
+    auto append = [&cursor](const void* section, const size_t& size)
+    {
+        if (size > 0)
+            std::memcpy(cursor, section, size);
+        cursor += size;
+    };
+    append(&header,                sizeof(header));
+    append(cachedMtlLibs  .data(), cachedMtlLibs  .size() * sizeof(MeshCacheName));
+    append(cachedMeshes   .data(), cachedMeshes   .size() * sizeof(MeshCacheMesh));
+    append(cachedSubMeshes.data(), cachedSubMeshes.size() * sizeof(MeshCacheSubMesh));
+    append(names          .data(), names          .size());
+    for (const SubMesh* subMesh : subMeshes)
+        append(subMesh->GetVertices().data(), subMesh->GetVertices().size() * sizeof(TangentVertex));
+    for (const SubMesh* subMesh : subMeshes)
+        append(subMesh->GetIndices().data(), subMesh->GetIndices().size() * sizeof(unsigned int));
+    cursor = data.data() + layout.meshlets;
+    for (const SubMesh* subMesh : subMeshes)
+        append(subMesh->GetMeshlets().data(), subMesh->GetMeshlets().size() * sizeof(Meshlet));
+    Core::AssetCache::Write(cacheKey, std::move(data));
+}
+
+void ObjFile::ClearCache()
+{
+    Core::AssetCache::Clear(CacheImporter);
+}
+
+void ObjFile::SetMeshesLoadingDone()
+{
+    for (IResource* resource : createdResources)
+        if (resource->GetType() == ResourceTypes::Mesh)
+            resource->SetLoadingDone();
     SetLoadingDone();
 }
 
@@ -203,3 +799,49 @@ void ObjFile::SendToOpenGL()
 {
     SetOpenGLTransferDone();
 }
+
+void ObjFile::Benchmark(ResourceManager& resourceManager, const std::vector<std::string>& filenames, const int& iterations)
+{
+    Core::JobSystem& jobSystem = resourceManager.threadManager.GetJobSystem();
+    DebugLog("Obj parser benchmark (" + std::to_string(filenames.size()) + " file(s), " + std::to_string(iterations) + " iterations, " + std::to_string(jobSystem.GetThreadCount()) + " workers):");
+
+    // Loads copies of the file from a job, their meshes stay outside of the resource manager. Returns the average time and the vertices of the last copy.
+    auto loadCopies = [&resourceManager, &jobSystem, iterations](const std::string& filename, const bool& chunked, std::vector<Core::Maths::TangentVertex>& vertices)
+    {
+        double totalMs = 0;
+        for (int i = 0; i < iterations; i++)
+        {
+            ObjFile copy(filename, resourceManager, true);
+            copy.chunkedParsing = chunked;
+            copy.useCache       = false;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            jobSystem.Wait(jobSystem.Schedule([&copy]() { copy.Load(); }));
+            jobSystem.Wait(copy.GetLoadingJob());
+            totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            vertices.clear();
+            for (IResource* mesh : copy.createdResources) {
+                for (const SubMesh* subMesh : ((Mesh*)mesh)->subMeshes)
+                    vertices.insert(vertices.end(), subMesh->GetVertices().begin(), subMesh->GetVertices().end());
+                delete mesh;
+            }
+        }
+        return totalMs / std::max(iterations, 1);
+    };
+
+    for (const std::string& filename : filenames)
+    {
+        std::vector<Core::Maths::TangentVertex> serialVertices, chunkedVertices;
+        const double serialMs  = loadCopies(filename, false, serialVertices);
+        const double chunkedMs = loadCopies(filename, true,  chunkedVertices);
+
+        std::error_code error;
+        const double fileSizeMB = (double)std::filesystem::file_size(filename, error) * 1e-6;
+        DebugLog(filename + ": " + std::to_string(chunkedVertices.size()) + " vertices, serial " + std::to_string(serialMs) + " ms (" + std::to_string(fileSizeMB / (serialMs * 1e-3)) + " MB/s), "
+                 + "chunked " + std::to_string(chunkedMs) + " ms (" + std::to_string(fileSizeMB / (chunkedMs * 1e-3)) + " MB/s, x" + std::to_string(serialMs / chunkedMs) + ").");
+
+        // Both parsers must create the exact same vertices.
+        if (serialVertices.size() != chunkedVertices.size() || (!serialVertices.empty() && std::memcmp(serialVertices.data(), chunkedVertices.data(), serialVertices.size() * sizeof(Core::Maths::TangentVertex)) != 0))
+            DebugLogWarning("Chunked parsing of " + filename + " doesn't create the same vertices as serial parsing.");
+    }
+}
@@ -1,6 +1,7 @@
 #include "Primitive.h"
 #include "Maths.h"
 #include "SceneNode.h"
+#include "Material.h"
 using namespace Core::Maths;
 using namespace Core::Physics;
 using namespace Scenes;
@@ -59,6 +60,11 @@ Primitive::~Primitive()
 		delete transform;
 }
 
+void Primitive::SetMaterial(Resources::Material* _material)
+{
+	material = _material;
+}
+
 
 // ----- Primitive buffers ----- //
 
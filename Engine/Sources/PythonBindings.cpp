@@ -575,7 +575,7 @@ PYBIND11_MODULE(engine, m)
         .def("GetPixel", &DynamicTexture::GetPixel, "Returns the RGBA color of the pixel at the given position.", py::arg("x"), py::arg("y"))
         .def("SetPixel", &DynamicTexture::SetPixel, "Sets the RGBA color of the pixel at the given position.", 
                 py::arg("x"), py::arg("y"), py::arg("color"), py::arg("updateTexture") = true)
-        .def("UpdateTexture", &DynamicTexture::UpdateTexture, "Sends the texture's pixels to OpenGL.");
+        .def("UpdateTexture", &DynamicTexture::UpdateTexture, "Marks the texture's pixels as updated, they are sent to OpenGL with their new mipmaps in a later frame.");
 
     py::class_<RenderTexture, IResource>(m, "RenderTexture")
         .def(py::init<std::string>())
@@ -619,13 +619,13 @@ PYBIND11_MODULE(engine, m)
         .def_readwrite("shininess",    &Material::shininess)
         .def_readwrite("transparency", &Material::transparency)
         
-        .def_readwrite("ambientTexture",  &Material::ambientTexture)
-        .def_readwrite("diffuseTexture",  &Material::diffuseTexture)
-        .def_readwrite("specularTexture", &Material::specularTexture)
-        .def_readwrite("emissionTexture", &Material::emissionTexture)
-        .def_readwrite("shininessMap",    &Material::shininessMap)
-        .def_readwrite("alphaMap",        &Material::alphaMap)
-        .def_readwrite("normalMap",       &Material::normalMap)
+        .def_property("ambientTexture",  [](const Material& self) { return (Texture*)self.ambientTexture; }, [](Material& self, Texture* texture) { self.ambientTexture = texture; }, py::return_value_policy::reference)
+        .def_property("diffuseTexture",  [](const Material& self) { return (Texture*)self.diffuseTexture; }, [](Material& self, Texture* texture) { self.diffuseTexture = texture; }, py::return_value_policy::reference)
+        .def_property("specularTexture", [](const Material& self) { return (Texture*)self.specularTexture; }, [](Material& self, Texture* texture) { self.specularTexture = texture; }, py::return_value_policy::reference)
+        .def_property("emissionTexture", [](const Material& self) { return (Texture*)self.emissionTexture; }, [](Material& self, Texture* texture) { self.emissionTexture = texture; }, py::return_value_policy::reference)
+        .def_property("shininessMap",    [](const Material& self) { return (Texture*)self.shininessMap; }, [](Material& self, Texture* texture) { self.shininessMap = texture; }, py::return_value_policy::reference)
+        .def_property("alphaMap",        [](const Material& self) { return (Texture*)self.alphaMap; }, [](Material& self, Texture* texture) { self.alphaMap = texture; }, py::return_value_policy::reference)
+        .def_property("normalMap",       [](const Material& self) { return (Texture*)self.normalMap; }, [](Material& self, Texture* texture) { self.normalMap = texture; }, py::return_value_policy::reference)
 
         .def("SetParams", &Material::SetParams, "Sets the material's parameters to the given ones.", 
                 py::arg("ambient"), py::arg("diffuse"), py::arg("specular"), py::arg("emission"), py::arg("shininess"));
@@ -637,6 +637,8 @@ PYBIND11_MODULE(engine, m)
         .def(py::init<std::string, ShaderProgram*>())
         .def("GetName",          &SubMesh::GetName,          "Returns the sub-mesh's name.")
         .def("GetVertexCount",   &SubMesh::GetVertexCount,   "Returns the number of vertices stored in the sub-mesh.")
+        .def("GetIndexCount",    &SubMesh::GetIndexCount,    "Returns the number of indices of all the sub-mesh's levels of detail.")
+        .def("GetLodCount",      &SubMesh::GetLodCount,      "Returns the number of levels of detail of the sub-mesh, including the full detail one.")
         .def("IsLoaded",         &SubMesh::IsLoaded,         "Returns True if the sub-mesh is loaded.")
         .def("WasSentToOpenGL",  &SubMesh::WasSentToOpenGL,  "Returns True if the sub-mesh was sent to OpenGL.")
         .def("GetShaderProgram", &SubMesh::GetShaderProgram, "Returns the sub-mesh's shader program.", py::return_value_policy::reference)
@@ -714,16 +716,16 @@ PYBIND11_MODULE(engine, m)
         .def("CreateObjFile",        [](ResourceManager& self, const std::string& name){ self.pyResourceCreationQueue.push_back({ ResourceTypes::ObjFile,        name }); }, "Loads all the meshes and materials from the given .obj file, and returns an ObjFile object.", py::arg("name"), py::return_value_policy::reference)
         .def("CreateMtlFile",        [](ResourceManager& self, const std::string& name){ self.pyResourceCreationQueue.push_back({ ResourceTypes::MtlFile,        name }); }, "Loads all the materials from the given .mtl file, and returns an MtlFile object.",            py::arg("name"), py::return_value_policy::reference)
 
-        .def("GetTexture",        &ResourceManager::Get<Texture>,        "Returns a texture with the given name.",         py::arg("name"), py::return_value_policy::reference)
-        .def("GetDynamicTexture", &ResourceManager::Get<DynamicTexture>, "Returns a dynamic texture with the given name.", py::arg("name"), py::return_value_policy::reference)
-        .def("GetMaterial",       &ResourceManager::Get<Material>,       "Returns a material with the given name.",        py::arg("name"), py::return_value_policy::reference)
-        .def("GetMesh",           &ResourceManager::Get<Mesh>,           "Returns a mesh with the given name.",            py::arg("name"), py::return_value_policy::reference)
-        .def("GetVertexShader",   &ResourceManager::Get<VertexShader>,   "Returns a vertex shader with the given name.",   py::arg("name"), py::return_value_policy::reference)
-        .def("GetFragmentShader", &ResourceManager::Get<FragmentShader>, "Returns a fragment shader with the given name.", py::arg("name"), py::return_value_policy::reference)
-        .def("GetComputeShader",  &ResourceManager::Get<ComputeShader>,  "Returns a compute shader with the given name.",  py::arg("name"), py::return_value_policy::reference)
-        .def("GetShaderProgram",  &ResourceManager::Get<ShaderProgram>,  "Returns a shader program with the given name.",  py::arg("name"), py::return_value_policy::reference)
-        .def("GetObjFile",        &ResourceManager::Get<ObjFile>,        "Returns an ObjFile object with the given name.", py::arg("name"), py::return_value_policy::reference)
-        .def("GetMtlFile",        &ResourceManager::Get<MtlFile>,        "Returns an MtlFile object with the given name.", py::arg("name"), py::return_value_policy::reference)
+        .def("GetTexture",        [](ResourceManager& self, const std::string& name) { return (Texture*)self.Get<Texture>(name); },        "Returns a texture with the given name.",         py::arg("name"), py::return_value_policy::reference)
+        .def("GetDynamicTexture", [](ResourceManager& self, const std::string& name) { return (DynamicTexture*)self.Get<DynamicTexture>(name); }, "Returns a dynamic texture with the given name.", py::arg("name"), py::return_value_policy::reference)
+        .def("GetMaterial",       [](ResourceManager& self, const std::string& name) { return (Material*)self.Get<Material>(name); },       "Returns a material with the given name.",        py::arg("name"), py::return_value_policy::reference)
+        .def("GetMesh",           [](ResourceManager& self, const std::string& name) { return (Mesh*)self.Get<Mesh>(name); },           "Returns a mesh with the given name.",            py::arg("name"), py::return_value_policy::reference)
+        .def("GetVertexShader",   [](ResourceManager& self, const std::string& name) { return (VertexShader*)self.Get<VertexShader>(name); },   "Returns a vertex shader with the given name.",   py::arg("name"), py::return_value_policy::reference)
+        .def("GetFragmentShader", [](ResourceManager& self, const std::string& name) { return (FragmentShader*)self.Get<FragmentShader>(name); }, "Returns a fragment shader with the given name.", py::arg("name"), py::return_value_policy::reference)
+        .def("GetComputeShader",  [](ResourceManager& self, const std::string& name) { return (ComputeShader*)self.Get<ComputeShader>(name); },  "Returns a compute shader with the given name.",  py::arg("name"), py::return_value_policy::reference)
+        .def("GetShaderProgram",  [](ResourceManager& self, const std::string& name) { return (ShaderProgram*)self.Get<ShaderProgram>(name); },  "Returns a shader program with the given name.",  py::arg("name"), py::return_value_policy::reference)
+        .def("GetObjFile",        [](ResourceManager& self, const std::string& name) { return (ObjFile*)self.Get<ObjFile>(name); },        "Returns an ObjFile object with the given name.", py::arg("name"), py::return_value_policy::reference)
+        .def("GetMtlFile",        [](ResourceManager& self, const std::string& name) { return (MtlFile*)self.Get<MtlFile>(name); },        "Returns an MtlFile object with the given name.", py::arg("name"), py::return_value_policy::reference)
         
         .def("FindTexture",        &ResourceManager::Find<Texture>,        "Searches for a texture which has a name that contains the search term, and returns the first one found.",         py::arg("searchTerm"), py::return_value_policy::reference)
         .def("FindDynamicTexture", &ResourceManager::Find<DynamicTexture>, "Searches for a dynamic texture which has a name that contains the search term, and returns the first one found.", py::arg("searchTerm"), py::return_value_policy::reference)
@@ -892,8 +894,8 @@ PYBIND11_MODULE(engine, m)
 
     // ----- Scene Objects ----- //
 
-    py::class_<SceneModel,          SceneNode>(m, "SceneModel"         ).def_readwrite("mesh",      &SceneModel::meshGroup);
-    py::class_<SceneInstancedModel, SceneNode>(m, "SceneInstancedModel").def_readwrite("mesh",      &SceneInstancedModel::meshGroup).def_readwrite("instanceCount", &SceneInstancedModel::instanceCount).def_readwrite("instanceTransforms", &SceneInstancedModel::instanceTransforms);
+    py::class_<SceneModel,          SceneNode>(m, "SceneModel"         ).def_property("mesh", [](const SceneModel& self) { return (Mesh*)self.meshGroup; }, [](SceneModel& self, Mesh* mesh) { self.meshGroup = mesh; }, py::return_value_policy::reference);
+    py::class_<SceneInstancedModel, SceneNode>(m, "SceneInstancedModel").def_property("mesh", [](const SceneInstancedModel& self) { return (Mesh*)self.meshGroup; }, [](SceneInstancedModel& self, Mesh* mesh) { self.meshGroup = mesh; }, py::return_value_policy::reference).def_readwrite("instanceCount", &SceneInstancedModel::instanceCount).def_readwrite("instanceTransforms", &SceneInstancedModel::instanceTransforms);
     py::class_<SceneSkybox,         SceneNode>(m, "SceneSkybox"        ).def_readwrite("cubemap",   &SceneSkybox::cubemap);
     py::class_<SceneCamera,         SceneNode>(m, "SceneCamera"        ).def_readwrite("camera",    &SceneCamera::camera);
     py::class_<SceneDirLight,       SceneNode>(m, "SceneDirLight"      ).def_readwrite("light",     &SceneDirLight::light);
@@ -921,6 +923,10 @@ PYBIND11_MODULE(engine, m)
                               { return self.AddCollider(node, type, pos, rot, scale); }, 
              "Adds a new collider to the given node and returns it as a Primitive.", 
              py::arg("node"), py::arg("primitiveType"), py::arg("position") = Vector3(), py::arg("rotation") = Vector3(), py::arg("scale") = Vector3(1), py::return_value_policy::reference)
+        .def("AddCollider", [](SceneGraph& self, SceneNode* node, const PrimitiveTypes& type, const Mesh* meshGroup)
+                              { return self.AddCollider(node, type, meshGroup); },
+             "Adds a new collider fitting the bounds of the given mesh group to the given node and returns it as a Primitive.",
+             py::arg("node"), py::arg("primitiveType"), py::arg("meshGroup"), py::return_value_policy::reference)
 
         .def("FindId", &SceneGraph::FindId, "If a node has the given id, return it. Returns None if no node is found.",          py::arg("searchId"),   py::return_value_policy::reference)
         .def("Find",   &SceneGraph::Find,   "Returns the first node that has the given name. Returns None if no node is found.", py::arg("searchName"), py::return_value_policy::reference);
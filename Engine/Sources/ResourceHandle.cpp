@@ -0,0 +1,56 @@
+#include "Debug.h"
+#include "IResource.h"
+#include "ResourceHandle.h"
+using namespace Resources;
+
+
+ResourceSlots::~ResourceSlots()
+{
+    for (std::atomic<Slot*>& chunk : chunks)
+        delete[] chunk.load();
+}
+
+void ResourceSlots::Register(IResource* resource)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+
+    // Reuse a free slot or take a new one, allocating its chunk if needed.
+    uint32_t index = 0;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        index = slotCount++;
+        if (index / ChunkSize >= MaxChunks) {
+            DebugLogError("Too many resources registered, unable to create a handle for: " + resource->GetName());
+            slotCount--;
+            return;
+        }
+        if (chunks[index / ChunkSize].load() == nullptr)
+            chunks[index / ChunkSize].store(new Slot[ChunkSize], std::memory_order_release);
+    }
+
+    Slot& slot = chunks[index / ChunkSize].load()[index % ChunkSize];
+    resource->slots          = this;
+    resource->slotIndex      = index;
+    resource->slotGeneration = slot.generation.load();
+    slot.resource.store(resource, std::memory_order_release);
+}
+
+void ResourceSlots::Unregister(IResource* resource)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    Slot* chunk = chunks[resource->slotIndex / ChunkSize].load();
+    if (chunk == nullptr)
+        return;
+
+    // Make sure the slot still belongs to this resource before freeing it.
+    Slot& slot = chunk[resource->slotIndex % ChunkSize];
+    if (slot.resource.load() != resource || slot.generation.load() != resource->slotGeneration)
+        return;
+    slot.resource.store(nullptr, std::memory_order_release);
+    slot.generation.fetch_add(1, std::memory_order_release);
+    freeSlots.push_back(resource->slotIndex);
+    resource->slots = nullptr;
+}
@@ -8,33 +8,100 @@
 #include <sstream>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
 #pragma warning(disable : 4996)
 
 #include "Maths.h"
 #include "ResourceManager.h"
+#include "LoadTimeline.h"
+#include "AssetCache.h"
 using namespace Core::Maths;
 using namespace Resources;
 
 
 bool                       ResourceManager::asyncLoad = false;
 Resources::TextureSampler* ResourceManager::sampler = nullptr;
+Resources::UploadStreamer* ResourceManager::uploadStreamer = nullptr;
+Resources::GpuUploader*    ResourceManager::gpuUploader    = nullptr;
+uint64_t                   ResourceManager::frameIndex     = 0;
 
 ResourceManager::ResourceManager() 
-    : threadManager(10)
+    : threadManager(), hotReloader(*this)
 {
     stbi_set_flip_vertically_on_load(true);
+    LoadMeshSources();
 }
 
 ResourceManager::~ResourceManager()
 {
+    SaveMeshSources();
+    WaitForEvictionJobs();
     while (resourceLock.test_and_set()) {}
-    for (auto& it : resources) 
+    for (auto& it : resources) {
+        Unregister(it.second);
         delete it.second;
+    }
     resources.clear();
     delete sampler;
+    delete uploadStreamer;
+    delete gpuUploader;
+    sampler        = nullptr;
+    uploadStreamer = nullptr;
+    gpuUploader    = nullptr;
 	resourceLock.clear();
 }
 
+// Adds the resource to the name map and gives it a slot for handles (resourceLock should be locked).
+void ResourceManager::Register(const std::string& name, IResource* resource)
+{
+    resources[name] = resource;
+    slots.Register(resource);
+    tracker.Register(resource);
+
+    // The resource isn't evicted anymore if it is created again.
+    std::lock_guard<std::mutex> guard(evictedResourcesMutex);
+    evictedResources.erase(name);
+}
+
+void ResourceManager::Unregister(IResource* resource)
+{
+    tracker.Unregister(resource);
+    slots.Unregister(resource);
+}
+
+void ResourceManager::QueueLoad(IResource* resource)
+{
+    if (loadsCancelled)
+        resource->CancelLoading();
+    else if (AsyncLoading())
+    {
+        // Let the meshes this file created in the previous loads share its importance before it starts.
+        const Core::JobHandle job = threadManager.AddTask(resource);
+        if (resource->GetType() == ResourceTypes::ObjFile)
+        {
+            std::lock_guard<std::mutex> guard(resourceSourcesMutex);
+            std::unordered_map<std::string, std::vector<std::string>>::iterator meshes = fileMeshes.find(resource->GetName());
+            if (meshes != fileMeshes.end())
+                for (const std::string& meshName : meshes->second)
+                    meshLoadingJobs[meshName] = job;
+        }
+    }
+    else {
+        Core::ScopedLoadPhase loadPhase(resource->GetName(), Core::LoadPhase::Load);
+        resource->Load();
+    }
+}
+
+void ResourceManager::CancelLoads()
+{
+    loadsCancelled.store(true);
+    while (resourceLock.test_and_set()) {}
+    for (auto& it : resources)
+        if (!it.second->IsLoaded())
+            threadManager.CancelTask(it.second);
+    resourceLock.clear();
+}
+
 // Attempts to delete the resource that has the specified name.
 void ResourceManager::Delete(const std::string& name)
 {
@@ -44,25 +111,54 @@ void ResourceManager::Delete(const std::string& name)
         resourceLock.clear();
         return;
     }
-    if (!resources[name]->WasSentToOpenGL()) {
-        DebugLogWarning("Unable to delete currently loading resource: " + name);
-        resourceLock.clear();
-        return;
-    }
-    delete resources[name];
+    IResource* resource = resources[name];
     resources.erase(name);
     resourceLock.clear();
+
+    // Stop loading the resource before deleting it.
+    threadManager.CancelTask(resource);
+    threadManager.WaitForTask(resource);
+    Unregister(resource);
+    delete resource;
 }
 
-// Delete all of the loaded resources if all are loaded.
+// Deletes all resources, cancelling the ones that are still loading.
 bool ResourceManager::Reset()
 {
-    if (!AreAllResourcesInOpenGL())
-        return false;
+    CancelLoads();
 
-    for (auto& it : resources)
-        delete it.second;
-    resources.clear();
+    // Reloads in progress would swap data into deleted resources.
+    const bool hotReloading = hotReloader.IsRunning();
+    hotReloader.Stop();
+    WaitForEvictionJobs();
+
+    // Loads that were stopped may have created resources in the meantime, so repeat until none are left.
+    std::unordered_map<std::string, IResource*> oldResources;
+    while (true)
+    {
+        while (resourceLock.test_and_set()) {}
+        oldResources.swap(resources);
+        resourceLock.clear();
+        if (oldResources.empty())
+            break;
+
+        for (auto& it : oldResources)
+            threadManager.CancelTask(it.second);
+        for (auto& it : oldResources)
+            threadManager.WaitForTask(it.second);
+        for (auto& it : oldResources) {
+            Unregister(it.second);
+            delete it.second;
+        }
+        oldResources.clear();
+    }
+    {
+        std::lock_guard<std::mutex> guard(evictedResourcesMutex);
+        evictedResources.clear();
+    }
+    loadsCancelled.store(false);
+    if (hotReloading)
+        hotReloader.Start();
     return true;
 }
 
@@ -74,49 +170,272 @@ void ResourceManager::CreateSampler()
     }
 }
 
-bool ResourceManager::AreAllResourcesLoaded()
+void ResourceManager::CreateUploadStreamer()
 {
-    while (resourceLock.test_and_set()) {}
-    for (auto& it : resources) {
-        if (!it.second->IsLoaded()) {
-	        resourceLock.clear();
-            return false;
-        }
+    if (uploadStreamer == nullptr)
+        uploadStreamer = new UploadStreamer();
+}
+
+void ResourceManager::CreateGpuUploader(GLFWwindow* sharedWindow)
+{
+    if (gpuUploader != nullptr)
+        return;
+    gpuUploader = new GpuUploader(sharedWindow);
+
+    // Fall back to uploading from the render thread if the upload context couldn't be created.
+    if (!gpuUploader->IsRunning()) {
+        delete gpuUploader;
+        gpuUploader = nullptr;
     }
-	resourceLock.clear();
-   return true;
 }
 
-bool ResourceManager::AreAllResourcesInOpenGL()
+void ResourceManager::CreateOfType(const ResourceTypes& type, const std::string& name)
 {
-    while (resourceLock.test_and_set()) {}
-    for (auto& it : resources) {
-        if (!it.second->WasSentToOpenGL()) {
-	        resourceLock.clear();
-            return false;
-        }
+    switch (type)
+    {
+    case ResourceTypes::Texture:        Create<Texture       >(name); break;
+    case ResourceTypes::DynamicTexture: Create<DynamicTexture>(name); break;
+    case ResourceTypes::Material:       Create<Material      >(name); break;
+    case ResourceTypes::Mesh:           Create<Mesh          >(name); break;
+    case ResourceTypes::VertexShader:   Create<VertexShader  >(name); break;
+    case ResourceTypes::FragmentShader: Create<FragmentShader>(name); break;
+    case ResourceTypes::ComputeShader:  Create<ComputeShader >(name); break;
+    case ResourceTypes::ShaderProgram:  Create<ShaderProgram >(name); break;
+    case ResourceTypes::ObjFile:        Create<ObjFile       >(name); break;
+    case ResourceTypes::MtlFile:        Create<MtlFile       >(name); break;
+    default: break;
     }
-	resourceLock.clear();
-   return true;
 }
 
 void ResourceManager::CheckForNewPyResources()
 {
     while (pyResourceCreationQueue.size() > 0)
     {
-        switch (pyResourceCreationQueue[0].first)
+        CreateOfType(pyResourceCreationQueue[0].first, pyResourceCreationQueue[0].second);
+        pyResourceCreationQueue.erase(pyResourceCreationQueue.begin());
+    }
+}
+
+void ResourceManager::SetResourceSource(const std::string& resourceName, const std::string& fileName)
+{
+    std::lock_guard<std::mutex> guard(resourceSourcesMutex);
+    resourceSources[resourceName] = fileName;
+}
+
+void ResourceManager::SetMeshSource(const std::string& meshName, const std::string& fileName, const Core::JobHandle& loadingJob)
+{
+    std::lock_guard<std::mutex> guard(resourceSourcesMutex);
+    resourceSources[meshName] = fileName;
+    if (loadingJob.IsValid())
+        meshLoadingJobs[meshName] = loadingJob;
+    std::vector<std::string>& meshes = fileMeshes[fileName];
+    if (std::find(meshes.begin(), meshes.end(), meshName) == meshes.end())
+        meshes.push_back(meshName);
+}
+
+void ResourceManager::LoadMeshSources()
+{
+    std::ifstream file(std::string(Core::AssetCache::Directory) + "/" + MeshSourcesName);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const size_t separator = line.find('\t');
+        if (separator == std::string::npos)
+            continue;
+        fileMeshes[line.substr(separator + 1)].push_back(line.substr(0, separator));
+    }
+}
+
+void ResourceManager::SaveMeshSources()
+{
+    std::error_code error;
+    std::filesystem::create_directory(Core::AssetCache::Directory, error);
+    std::ofstream file(std::string(Core::AssetCache::Directory) + "/" + MeshSourcesName);
+    std::lock_guard<std::mutex> guard(resourceSourcesMutex);
+    for (const std::pair<const std::string, std::vector<std::string>>& meshes : fileMeshes)
+        for (const std::string& meshName : meshes.second)
+            file << meshName << '\t' << meshes.first << '\n';
+}
+
+void ResourceManager::SetLoadPriorities(const std::unordered_map<std::string, float>& meshPriorities)
+{
+    // Give each loading job the priority of its most important mesh, the job system passes it on to the loads it spawned.
+    std::unordered_map<Core::Job*, std::pair<Core::JobHandle, float>> jobPriorities;
+    {
+        std::lock_guard<std::mutex> guard(resourceSourcesMutex);
+        for (const std::pair<const std::string, float>& it : meshPriorities)
         {
-        case ResourceTypes::Texture:        Create<Texture       >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::DynamicTexture: Create<DynamicTexture>(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::Material:       Create<Material      >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::Mesh:           Create<Mesh          >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::VertexShader:   Create<VertexShader  >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::FragmentShader: Create<FragmentShader>(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::ComputeShader:  Create<ComputeShader >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::ShaderProgram:  Create<ShaderProgram >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::ObjFile:        Create<ObjFile       >(pyResourceCreationQueue[0].second); break;
-        case ResourceTypes::MtlFile:        Create<MtlFile       >(pyResourceCreationQueue[0].second); break;
+            std::unordered_map<std::string, Core::JobHandle>::iterator job = meshLoadingJobs.find(it.first);
+            if (job == meshLoadingJobs.end() || job->second.IsDone())
+                continue;
+            std::pair<Core::JobHandle, float>& jobPriority = jobPriorities.try_emplace(job->second.GetJob().get(), job->second, it.second).first->second;
+            jobPriority.second = std::max(jobPriority.second, it.second);
         }
-        pyResourceCreationQueue.erase(pyResourceCreationQueue.begin());
     }
+
+    for (const std::pair<Core::Job* const, std::pair<Core::JobHandle, float>>& it : jobPriorities)
+        it.second.first.SetImportance(it.second.second);
+}
+
+void ResourceManager::EvictResources()
+{
+    // The memory used is kept up to date by the tracker, but finding what to evict goes through all resources, so only do it every few frames.
+    frameIndex++;
+    if (memoryBudget == 0 || tracker.GetUsedMemory() <= memoryBudget || frameIndex - lastEvictionFrame < EvictionInterval)
+        return;
+    lastEvictionFrame = frameIndex;
+
+    // Resources referenced by the evicted ones are only released once the jobs deleted them, so they are evicted on a later check.
+    EvictLeastRecentlyUsed();
+}
+
+// Deletes the least recently used groups of unreferenced resources until the memory budget is met, returns false if there are none.
+bool ResourceManager::EvictLeastRecentlyUsed()
+{
+    // Obj and mtl files are evicted along with the meshes and materials they created, textures are evicted on their own.
+    // Only resources that can be reloaded from a file are evicted, and files are kept as long as the file that loads them is.
+    struct EvictionGroup
+    {
+        std::vector<std::pair<std::string, ResourceTypes>> members;
+        std::vector<std::string>                           sources;
+        uint64_t lastUsedFrame = 0;
+        bool     evictable     = true;
+    };
+    std::unordered_map<std::string, EvictionGroup> groups;
+
+    while (resourceLock.test_and_set()) {}
+    {
+        std::lock_guard<std::mutex> guard(resourceSourcesMutex);
+        for (auto& it : resources)
+        {
+            std::unordered_map<std::string, std::string>::iterator source = resourceSources.find(it.first);
+            const bool knownSource  = source != resourceSources.end();
+            const bool sourceLoaded = knownSource && resources.count(source->second) > 0;
+
+            std::string groupName = it.first;
+            std::string reloadSource;
+            bool        kept = false;
+            switch (it.second->GetType())
+            {
+            case ResourceTypes::ObjFile:
+            case ResourceTypes::MtlFile:
+                kept = sourceLoaded;
+                break;
+            case ResourceTypes::Texture:
+                if (!knownSource || sourceLoaded) continue;
+                break;
+            case ResourceTypes::Mesh:
+            case ResourceTypes::Material:
+                if (!knownSource) continue;
+                if (sourceLoaded) groupName = source->second;
+                reloadSource = source->second;
+                break;
+            default:
+                continue;
+            }
+
+            EvictionGroup& group = groups[groupName];
+            group.members.push_back({ it.first, it.second->GetType() });
+            group.sources.push_back(reloadSource);
+            group.lastUsedFrame = std::max(group.lastUsedFrame, it.second->GetLastUsedFrame());
+            if (kept || it.second->GetRefCount() > 0 || !it.second->IsLoaded() || !it.second->WasSentToOpenGL())
+                group.evictable = false;
+        }
+    }
+    resourceLock.clear();
+
+    // Evict the groups that were used the longest time ago first, the memory used goes down as soon as they are unregistered.
+    std::vector<const EvictionGroup*> evictableGroups;
+    for (auto& it : groups)
+        if (it.second.evictable)
+            evictableGroups.push_back(&it.second);
+    if (evictableGroups.empty())
+        return false;
+    std::sort(evictableGroups.begin(), evictableGroups.end(), [](const EvictionGroup* a, const EvictionGroup* b) { return a->lastUsedFrame < b->lastUsedFrame; });
+
+    std::vector<std::string> evictedNames;
+    for (const EvictionGroup* group : evictableGroups)
+    {
+        if (tracker.GetUsedMemory() <= memoryBudget)
+            break;
+
+        // Remember where the resources come from to reload them when they are needed again.
+        {
+            std::lock_guard<std::mutex> guard(evictedResourcesMutex);
+            for (size_t i = 0; i < group->members.size(); i++)
+                evictedResources[group->members[i].first] = { group->members[i].second, group->sources[i] };
+        }
+        evictedNames.clear();
+        for (const std::pair<std::string, ResourceTypes>& member : group->members) {
+            DebugLog("Evicted resource " + member.first);
+            evictedNames.push_back(member.first);
+            evictedCount++;
+        }
+        DeleteEvicted(evictedNames);
+    }
+    return true;
+}
+
+// Removes the given resources from the manager and deletes their OpenGL objects, the rest of them is deleted by a job.
+void ResourceManager::DeleteEvicted(const std::vector<std::string>& names)
+{
+    std::vector<IResource*> evicted;
+    while (resourceLock.test_and_set()) {}
+    for (const std::string& name : names)
+    {
+        std::unordered_map<std::string, IResource*>::iterator it = resources.find(name);
+        if (it == resources.end())
+            continue;
+        evicted.push_back(it->second);
+        resources.erase(it);
+    }
+    resourceLock.clear();
+
+    for (IResource* resource : evicted) {
+        Unregister(resource);
+        resource->DeleteOpenGLObjects();
+    }
+
+    // Evicted resources are done loading, but their loading job may still be finishing.
+    evictionJobs.erase(std::remove_if(evictionJobs.begin(), evictionJobs.end(), [](const Core::JobHandle& job) { return job.IsDone(); }), evictionJobs.end());
+    evictionJobs.push_back(threadManager.GetJobSystem().Schedule([this, evicted]()
+    {
+        for (IResource* resource : evicted) {
+            threadManager.WaitForTask(resource);
+            delete resource;
+        }
+    }));
+}
+
+void ResourceManager::WaitForEvictionJobs()
+{
+    for (const Core::JobHandle& job : evictionJobs)
+        job.Wait();
+    evictionJobs.clear();
+}
+
+// Creates the given evicted resource again, or the file that created it, returns false if it wasn't evicted.
+bool ResourceManager::ReloadEvicted(const std::string& name)
+{
+    ResourceTypes type;
+    std::string   fileName = name;
+    {
+        std::lock_guard<std::mutex> guard(evictedResourcesMutex);
+        std::unordered_map<std::string, std::pair<ResourceTypes, std::string>>::iterator it = evictedResources.find(name);
+        if (it == evictedResources.end())
+            return false;
+        type = it->second.first;
+
+        // Meshes and materials are created again by loading their file.
+        std::unordered_map<std::string, std::pair<ResourceTypes, std::string>>::iterator source = evictedResources.find(it->second.second);
+        if (source != evictedResources.end()) {
+            type     = source->second.first;
+            fileName = source->first;
+        }
+        evictedResources.erase(name);
+        evictedResources.erase(fileName);
+    }
+    DebugLog("Reloading evicted resource " + fileName);
+    CreateOfType(type, fileName);
+    return true;
 }
@@ -0,0 +1,88 @@
+#include "IResource.h"
+#include "ResourceTracker.h"
+using namespace Resources;
+
+
+ResourceTracker::~ResourceTracker()
+{
+    ChangedNode* node = changedHead.exchange(nullptr);
+    while (node != nullptr) {
+        ChangedNode* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+void ResourceTracker::Register(IResource* resource)
+{
+    if (!resource->IsLoaded())
+        unloadedCount.fetch_add(1);
+    if (!resource->WasSentToOpenGL())
+        notInOpenGLCount.fetch_add(1);
+    const size_t bytes = resource->GetCpuBytes() + resource->GetGpuBytes();
+    resource->trackedBytes.store(bytes);
+    usedMemory.fetch_add(bytes);
+    resource->tracker.store(this);
+}
+
+void ResourceTracker::Unregister(IResource* resource)
+{
+    ResourceTracker* expected = this;
+    if (!resource->tracker.compare_exchange_strong(expected, nullptr))
+        return;
+    if (!resource->IsLoaded())
+        unloadedCount.fetch_sub(1);
+    if (!resource->WasSentToOpenGL())
+        notInOpenGLCount.fetch_sub(1);
+    usedMemory.fetch_sub(resource->trackedBytes.exchange(0));
+}
+
+void ResourceTracker::OnLoadingDone(IResource* resource)
+{
+    unloadedCount.fetch_sub(1);
+    PushChanged(resource);
+}
+
+void ResourceTracker::OnOpenGLTransferDone()
+{
+    notInOpenGLCount.fetch_sub(1);
+}
+
+void ResourceTracker::OnOpenGLTransferReset()
+{
+    notInOpenGLCount.fetch_add(1);
+}
+
+void ResourceTracker::UpdateUsedMemory(IResource* resource)
+{
+    // The difference wraps around when the resource got smaller, which still gives the right total.
+    const size_t bytes = resource->GetCpuBytes() + resource->GetGpuBytes();
+    usedMemory.fetch_add(bytes - resource->trackedBytes.exchange(bytes));
+}
+
+void ResourceTracker::PushChanged(IResource* resource)
+{
+    // The resource is referenced by its slot, so it can be deleted before the main thread pops it.
+    ChangedNode* node = new ChangedNode{ resource->GetSlotIndex(), resource->GetSlotGeneration(), changedHead.load(std::memory_order_relaxed) };
+    while (!changedHead.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+void ResourceTracker::PopChanged(const ResourceSlots* slots, std::vector<ResourceHandle<IResource>>& changed)
+{
+    // Take the whole stack at once and reverse it to get the oldest changes first.
+    ChangedNode* node = changedHead.exchange(nullptr, std::memory_order_acquire);
+    ChangedNode* reversed = nullptr;
+    while (node != nullptr) {
+        ChangedNode* next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+
+    while (reversed != nullptr) {
+        ChangedNode* next = reversed->next;
+        changed.push_back(ResourceHandle<IResource>(slots, reversed->slotIndex, reversed->slotGeneration));
+        delete reversed;
+        reversed = next;
+    }
+}
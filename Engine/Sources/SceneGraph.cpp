@@ -1,8 +1,11 @@
 ﻿#include <imgui/imgui.h>
 #include <algorithm>
+#include <cmath>
 
 #include "App.h"
 #include "Mesh.h"
+#include "SubMesh.h"
+#include "Camera.h"
 #include "SceneNode.h"
 #include "SceneGraph.h"
 using namespace Scenes;
@@ -268,14 +271,89 @@ Physics::Primitive* SceneGraph::AddCollider(SceneNode* node, const Physics::Prim
     return AddCollider(node, type, center, {}, scale);
 }
 
+Physics::Primitive* SceneGraph::AddCollider(SceneNode* node, const Physics::PrimitiveTypes& type, const Resources::Mesh* meshGroup)
+{
+    if (meshGroup == nullptr || !meshGroup->IsLoaded())
+        return nullptr;
+
+    std::vector<Vector3> corners;
+    for (const Resources::SubMesh* subMesh : meshGroup->subMeshes) {
+        // Sub-meshes without vertices have no bounds, their vertex count is only set once they are in OpenGL.
+        if (!subMesh->IsLoaded() || (subMesh->GetVertexCount() <= 0 && subMesh->GetVertices().empty()))
+            continue;
+        corners.push_back(subMesh->GetBoundsMin());
+        corners.push_back(subMesh->GetBoundsMax());
+    }
+    return AddCollider(node, type, corners);
+}
+
 void SceneGraph::StartPlayMode()
 {
     root->StartPlayMode();
 }
 
+// Recursively sets the loading priority of the meshes used by the node and its children.
+static void EvaluateNodeLoadPriority(const SceneNode* node, const Mat4& viewProjMat, const float& fovScale, std::unordered_map<std::string, float>& meshPriorities, bool& visibleModelsLoaded)
+{
+    Resources::Mesh* meshGroup = nullptr;
+    if (node->type == SceneNodeTypes::Model)          meshGroup = ((SceneModel*)node)->meshGroup;
+    if (node->type == SceneNodeTypes::InstancedModel) meshGroup = ((SceneInstancedModel*)node)->meshGroup;
+
+    if (meshGroup != nullptr)
+    {
+        // Project the world bounding sphere of the loaded sub-meshes, or a unit sphere around the model's origin before any of them is loaded.
+        const Mat4  worldMat   = node->transform.GetModelMat() * node->transform.parentMat;
+        const float worldScale = std::max({ (Vector4(1, 0, 0, 0) * worldMat).toVector3().getLength(),
+                                            (Vector4(0, 1, 0, 0) * worldMat).toVector3().getLength(),
+                                            (Vector4(0, 0, 1, 0) * worldMat).toVector3().getLength() });
+        Vector3 boundsMin, boundsMax;
+        bool    hasBounds = false;
+        for (const SubMesh* subMesh : meshGroup->subMeshes)
+        {
+            if (!subMesh->IsLoaded())
+                continue;
+            const Vector3& subMin = subMesh->GetBoundsMin();
+            const Vector3& subMax = subMesh->GetBoundsMax();
+            boundsMin = (hasBounds ? Vector3(std::min(boundsMin.x, subMin.x), std::min(boundsMin.y, subMin.y), std::min(boundsMin.z, subMin.z)) : subMin);
+            boundsMax = (hasBounds ? Vector3(std::max(boundsMax.x, subMax.x), std::max(boundsMax.y, subMax.y), std::max(boundsMax.z, subMax.z)) : subMax);
+            hasBounds = true;
+        }
+        const Vector3 center  = (hasBounds ? (boundsMin + boundsMax) * 0.5f : Vector3());
+        const float   radius  = (hasBounds ? (boundsMax - boundsMin).getLength() * 0.5f : 1.f) * worldScale;
+        const Vector4 clipPos = Vector4(center, 1) * (worldMat * viewProjMat);
+        const float   depth    = std::max(clipPos.w, 0.01f);
+        const bool    visible  = clipPos.w > -radius && std::abs(clipPos.x) <= depth + radius && std::abs(clipPos.y) <= depth + radius;
+
+        // Models out of view are still loaded, but after the visible ones.
+        float priority = radius * fovScale / depth;
+        if (!visible)
+            priority *= 0.01f;
+        if (meshPriorities.count(meshGroup->GetName()) <= 0 || meshPriorities[meshGroup->GetName()] < priority)
+            meshPriorities[meshGroup->GetName()] = priority;
+
+        if (visible && !meshGroup->WasSentToOpenGL())
+            visibleModelsLoaded = false;
+    }
+
+    for (const SceneNode* child : node->children)
+        EvaluateNodeLoadPriority(child, viewProjMat, fovScale, meshPriorities, visibleModelsLoaded);
+}
+
+bool SceneGraph::EvaluateLoadPriorities(const Render::Camera& camera, std::unordered_map<std::string, float>& meshPriorities)
+{
+    const Mat4  viewProjMat = camera.GetViewMat() * camera.GetProjectionMat();
+    const float fovScale    = 1 / std::tan(degToRad(camera.GetParameters().fov) / 2);
+    bool visibleModelsLoaded = true;
+    EvaluateNodeLoadPriority(root, viewProjMat, fovScale, meshPriorities, visibleModelsLoaded);
+    return visibleModelsLoaded;
+}
+
 void SceneGraph::UpdateAndDrawAll(const Render::Camera& camera, const Render::LightManager& lightManager, const bool& dontUpdateScripts)
 {
     static bool shouldDoPhysics = true;
+    SceneModel::drawnTriangleCount      = 0;
+    SceneModel::culledTriangleCount     = 0;
+    SceneModel::fullDetailTriangleCount = 0;
     root->UpdateAndDrawChildren(camera, lightManager, sceneColliders, dontUpdateScripts , shouldDoPhysics);
     shouldDoPhysics = !shouldDoPhysics;
 
@@ -12,18 +12,43 @@
 #include "PyScript.h"
 #include "ResourceManager.h"
 #include "App.h"
+#include "JobSystem.h"
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <cstring>
 using namespace Scenes;
 using namespace Render;
 using namespace Resources;
 using namespace Core::Physics;
 
 
-void DrawMesh(const ShaderProgram* shaderProgram, const GLuint& vao, const int& vertexCount, const Mat4& worldMat, const Camera& camera, const Material* material, const LightManager* lightManager = nullptr)
+// Tells the shader how to decode the sub-mesh's vertices, primitives (without sub-mesh) use uncompressed vertices.
+static void SendVertexFormatToShader(const unsigned int& shaderProgramId, const SubMesh* subMesh)
+{
+    const bool compact = (subMesh != nullptr && subMesh->IsCompact());
+    glUniform1i(glGetUniformLocation(shaderProgramId, "compactVertices"), compact);
+    glUniform1i(glGetUniformLocation(shaderProgramId, "hasTangents"), (subMesh == nullptr || subMesh->HasTangents()));
+    if (compact)
+    {
+        const Vector3 boundsMin  = subMesh->GetBoundsMin();
+        const Vector3 boundsSize = subMesh->GetBoundsMax() - subMesh->GetBoundsMin();
+        glUniform3f(glGetUniformLocation(shaderProgramId, "boundsMin" ), boundsMin .x, boundsMin .y, boundsMin .z);
+        glUniform3f(glGetUniformLocation(shaderProgramId, "boundsSize"), boundsSize.x, boundsSize.y, boundsSize.z);
+    }
+}
+
+static GLenum GetIndexType(const SubMesh* subMesh)
+{
+    return (subMesh != nullptr && subMesh->HasShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+}
+
+// Sends the mesh's uniforms to its shader, returns false if it can't be drawn.
+static bool BeginMeshDraw(const ShaderProgram* shaderProgram, const GLuint& vao, const Mat4& worldMat, const Camera& camera, const Material* material, const LightManager* lightManager, const SubMesh* subMesh)
 {
     const unsigned int shaderProgramId = shaderProgram->GetId();
     if (shaderProgramId == 0 || vao == 0)
-        return;
+        return false;
 
     glUseProgram(shaderProgramId);
 
@@ -34,6 +59,9 @@ void DrawMesh(const ShaderProgram* shaderProgram, const GLuint& vao, const int&
     // Tell the shader to deal with the mesh as a single element
     glUniform1i(glGetUniformLocation(shaderProgramId, "instanced"), false);
 
+    // Send the vertex format to shader.
+    SendVertexFormatToShader(shaderProgramId, subMesh);
+
     // Send the camera position to shader.
     glUniform3f(glGetUniformLocation(shaderProgramId, "ViewPos"), -camera.transform->GetPosition().x, camera.transform->GetPosition().y, camera.transform->GetPosition().z);
 
@@ -44,14 +72,113 @@ void DrawMesh(const ShaderProgram* shaderProgram, const GLuint& vao, const int&
     // Send lights to shader.
     if (lightManager != nullptr)
         lightManager->SendLightsToShader(shaderProgramId);
+    return true;
+}
+
+void DrawMesh(const ShaderProgram* shaderProgram, const GLuint& vao, const int& indexCount, const Mat4& worldMat, const Camera& camera, const Material* material, const LightManager* lightManager = nullptr, const SubMesh* subMesh = nullptr, const unsigned int& firstIndex = 0)
+{
+    if (!BeginMeshDraw(shaderProgram, vao, worldMat, camera, material, lightManager, subMesh))
+        return;
 
     // Draw the mesh.
     glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, indexCount, GetIndexType(subMesh), (void*)((size_t)firstIndex * (GetIndexType(subMesh) == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int))));
     glBindVertexArray(0);
 }
 
-void DrawInstancedMesh(const ShaderProgram* shaderProgram, const GLuint& vao, const int& vertexCount, const int& instanceCount, const Mat4& worldMat, const Camera& camera, const Material* material, const LightManager* lightManager = nullptr)
+// Draw command read by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+    unsigned int count, instanceCount, firstIndex;
+    int          baseVertex;
+    unsigned int baseInstance;
+};
+
+// Persistently mapped ring of the draw commands of visible meshlets, each draw writes its commands after the previous ones.
+// The ring is split in regions that are fenced once they are filled, and a region is only written to again once the GPU is done reading it.
+// It only grows when a draw doesn't fit in a region, and is deleted by SceneModel::ReleaseDrawBuffers.
+static constexpr int IndirectRegionCount = 3;
+static unsigned int   indirectBuffer     = 0;
+static unsigned char* indirectData       = nullptr;
+static size_t         indirectRegionSize = 0;
+static size_t         indirectOffset     = 0;
+static std::array<GLsync, IndirectRegionCount> indirectFences = {};
+
+static void DeleteIndirectBuffer()
+{
+    for (GLsync& fence : indirectFences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (indirectData != nullptr)
+        glUnmapNamedBuffer(indirectBuffer);
+    if (indirectBuffer != 0)
+        glDeleteBuffers(1, &indirectBuffer);
+    indirectBuffer     = 0;
+    indirectData       = nullptr;
+    indirectRegionSize = 0;
+    indirectOffset     = 0;
+}
+
+// Returns the offset in the ring where the given number of bytes of commands can be written.
+static size_t AllocateIndirectCommands(const size_t& size)
+{
+    if (size > indirectRegionSize)
+    {
+        // Orphan the previous ring, OpenGL only deletes it once the draws reading it are done.
+        const size_t regionSize = std::max(size, std::max(indirectRegionSize * 2, (size_t)64 * 1024));
+        DeleteIndirectBuffer();
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &indirectBuffer);
+        glNamedBufferStorage(indirectBuffer, regionSize * IndirectRegionCount, nullptr, flags);
+        indirectData = (unsigned char*)glMapNamedBufferRange(indirectBuffer, 0, regionSize * IndirectRegionCount, flags);
+        if (indirectData == nullptr) {
+            DebugLogError("Unable to map the meshlet draw commands buffer.");
+            DeleteIndirectBuffer();
+            return 0;
+        }
+        indirectRegionSize = regionSize;
+    }
+
+    // Move to the start of the next region when the commands don't fit in the current one, after fencing the draws that read it.
+    const size_t region = indirectOffset / indirectRegionSize;
+    if (indirectOffset + size > (region + 1) * indirectRegionSize)
+    {
+        indirectFences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        const size_t nextRegion = (region + 1) % IndirectRegionCount;
+        if (indirectFences[nextRegion] != nullptr) {
+            while (glClientWaitSync(indirectFences[nextRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(indirectFences[nextRegion]);
+            indirectFences[nextRegion] = nullptr;
+        }
+        indirectOffset = nextRegion * indirectRegionSize;
+    }
+    const size_t offset = indirectOffset;
+    indirectOffset += size;
+    return offset;
+}
+
+void DrawMeshlets(const ShaderProgram* shaderProgram, const GLuint& vao, const std::vector<DrawElementsIndirectCommand>& commands, const Mat4& worldMat, const Camera& camera, const Material* material, const LightManager* lightManager, const SubMesh* subMesh)
+{
+    if (commands.empty() || !BeginMeshDraw(shaderProgram, vao, worldMat, camera, material, lightManager, subMesh))
+        return;
+
+    const size_t commandsSize   = commands.size() * sizeof(DrawElementsIndirectCommand);
+    const size_t commandsOffset = AllocateIndirectCommands(commandsSize);
+    if (indirectData == nullptr)
+        return;
+    memcpy(indirectData + commandsOffset, commands.data(), commandsSize);
+
+    // Draw the visible ranges of the mesh.
+    glBindVertexArray(vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GetIndexType(subMesh), (void*)commandsOffset, (GLsizei)commands.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void DrawInstancedMesh(const ShaderProgram* shaderProgram, const GLuint& vao, const int& indexCount, const int& instanceCount, const Mat4& worldMat, const Camera& camera, const Material* material, const LightManager* lightManager = nullptr, const SubMesh* subMesh = nullptr)
 {
     const unsigned int shaderProgramId = shaderProgram->GetId();
     if (shaderProgramId == 0 || vao == 0)
@@ -63,6 +190,9 @@ void DrawInstancedMesh(const ShaderProgram* shaderProgram, const GLuint& vao, co
     glUniformMatrix4fv(glGetUniformLocation(shaderProgramId, "mvpMatrix"), 1, GL_FALSE, (worldMat * camera.GetViewMat() * camera.GetProjectionMat()).ptr);
     glUniformMatrix4fv(glGetUniformLocation(shaderProgramId, "modelMat"), 1, GL_FALSE, worldMat.ptr);
 
+    // Send the vertex format to shader.
+    SendVertexFormatToShader(shaderProgramId, subMesh);
+
     // Send the camera position to shader.
     glUniform3f(glGetUniformLocation(shaderProgramId, "ViewPos"), -camera.transform->GetPosition().x, camera.transform->GetPosition().y, camera.transform->GetPosition().z);
 
@@ -76,7 +206,7 @@ void DrawInstancedMesh(const ShaderProgram* shaderProgram, const GLuint& vao, co
 
     // Draw the mesh.
     glBindVertexArray(vao);
-    glDrawElementsInstanced(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, 0, instanceCount);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, GetIndexType(subMesh), 0, instanceCount);
     glBindVertexArray(0);
 }
 
@@ -474,27 +604,160 @@ const Material*      SceneNode::defaultMaterial      = nullptr;
 const Material*      SceneNode::colliderMaterial     = nullptr;
 const Material*      SceneNode::boundingBoxMaterial  = nullptr;
 
+bool   SceneModel::useLods                 = true;
+bool   SceneModel::useMeshletCulling       = true;
+float  SceneModel::lodPixelError           = 1.f;
+size_t SceneModel::drawnTriangleCount      = 0;
+size_t SceneModel::culledTriangleCount     = 0;
+size_t SceneModel::fullDetailTriangleCount = 0;
+
+void SceneModel::ReleaseDrawBuffers()
+{
+    DeleteIndirectBuffer();
+}
+
 SceneModel::SceneModel(const size_t& _id, const std::string& _name, Mesh* _meshGroup, SceneNode* _parent)
            : SceneNode(_id, _name, _parent, SceneNodeTypes::Model)
 {
     meshGroup = _meshGroup;
 }
 
+// Picks the level of detail of the sub-mesh from the size of a mesh unit on screen, starting from the level drawn in the last frame.
+static unsigned int SelectLod(const SubMesh* subMesh, const unsigned int& currentLevel, const float& pixelsPerUnit)
+{
+    if (!SceneModel::useLods)
+        return 0;
+    const float        maxError = SceneModel::lodPixelError / pixelsPerUnit;
+    const unsigned int lodCount = subMesh->GetLodCount();
+    unsigned int level = std::min(currentLevel, lodCount - 1);
+    while (level > 0 && subMesh->GetLod(level).error > maxError)
+        level--;
+    while (level + 1 < lodCount && subMesh->GetLod(level + 1).error <= maxError * (1 - SceneModel::LodHysteresis))
+        level++;
+    return level;
+}
+
+// View frustum planes and camera position in the space of a model's mesh, to test its meshlets' bounds without transforming them.
+struct MeshletCullingData
+{
+    Vector4 planes[6];
+    Vector3 cameraPos;
+    float   frontSign; // Triangles are front facing when the camera is on this side of their normal.
+};
+
+static MeshletCullingData GetMeshletCullingData(const Mat4& worldMat, const Camera& camera)
+{
+    MeshletCullingData data;
+    Mat4 worldViewMat = worldMat * camera.GetViewMat();
+    Mat4 mvpMat       = worldViewMat * camera.GetProjectionMat();
+
+    // Points are drawn between -w and w in clip space, each plane is the sum or difference of the w column and another one.
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 2; j++)
+        {
+            const float sign = (j == 0 ? 1.f : -1.f);
+            Vector4 plane(mvpMat[0][3] + sign * mvpMat[0][i], mvpMat[1][3] + sign * mvpMat[1][i], mvpMat[2][3] + sign * mvpMat[2][i], mvpMat[3][3] + sign * mvpMat[3][i]);
+            const float length = Vector3(plane.x, plane.y, plane.z).getLength();
+            data.planes[i * 2 + j] = (length > 0 ? Vector4(plane.x / length, plane.y / length, plane.z / length, plane.w / length) : Vector4(0, 0, 0, 1));
+        }
+    }
+    data.cameraPos = (Vector4(0, 0, 0, 1) * worldViewMat.inv4()).toVector3(true);
+
+    // OpenGL keeps the triangles that are counter-clockwise on screen, which are the ones facing the camera unless the transform mirrors them.
+    data.frontSign = (mvpMat.det4() < 0 ? 1.f : -1.f);
+    return data;
+}
+
+// Meshlets are culled when their bounding sphere is out of the frustum, or when all of their triangles face away from the camera.
+static bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullingData& data, const bool& cullBackFaces)
+{
+    for (const Vector4& plane : data.planes)
+        if (plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.w < -meshlet.radius)
+            return false;
+
+    if (!cullBackFaces || meshlet.coneCutoff <= 0)
+        return true;
+
+    // The camera sees every point of the sphere from behind every normal of the cone if the cone's widest normal
+    // still points away from the camera by more than the sphere's radius.
+    const Vector3 toCenter = meshlet.center - data.cameraPos;
+    const float   distance = toCenter.getLength();
+    if (distance <= meshlet.radius)
+        return true;
+    const float cosAngle = ((meshlet.coneAxis * data.frontSign) & toCenter) / distance;
+    const float sinAngle = std::sqrt(std::max(1 - cosAngle * cosAngle, 0.f));
+    const float coneSin  = std::sqrt(std::max(1 - meshlet.coneCutoff * meshlet.coneCutoff, 0.f));
+    return cosAngle * meshlet.coneCutoff - sinAngle * coneSin <= meshlet.radius / distance;
+}
+
 void SceneModel::Draw(const Camera& camera, const LightManager& lightManager)
 {
     if (meshGroup != nullptr)
     {
+        meshGroup->MarkUsed(ResourceManager::GetFrameIndex());
         Mat4 worldMat = transform.GetModelMat() * transform.parentMat;
+
+        // Pixels covered by a world unit at a distance of 1, and world units per mesh unit.
+        const Mat4  viewProjMat = camera.GetViewMat() * camera.GetProjectionMat();
+        const float pixelScale  = camera.GetParameters().height * 0.5f / std::tan(degToRad(camera.GetParameters().fov) / 2);
+        const float worldScale  = std::max({ (Vector4(1, 0, 0, 0) * worldMat).toVector3().getLength(),
+                                             (Vector4(0, 1, 0, 0) * worldMat).toVector3().getLength(),
+                                             (Vector4(0, 0, 1, 0) * worldMat).toVector3().getLength() });
+        subMeshLods.resize(meshGroup->subMeshes.size(), 0);
+        MeshletCullingData cullingData;
+        bool hasCullingData = false;
+
         for (size_t i = 0; i < meshGroup->subMeshes.size(); i++)
         {
             if (meshGroup->subMeshes[i]->WasSentToOpenGL())
             {
+                const SubMesh* subMesh = meshGroup->subMeshes[i];
+
+                // Measure the error at the point of the sub-mesh's bounding sphere closest to the camera.
+                const Vector3 center   = (subMesh->GetBoundsMin() + subMesh->GetBoundsMax()) * 0.5f;
+                const float   radius   = (subMesh->GetBoundsMax() - subMesh->GetBoundsMin()).getLength() * 0.5f * worldScale;
+                const float   depth    = std::max((Vector4(center, 1) * (worldMat * viewProjMat)).w - radius, camera.GetParameters().near);
+                subMeshLods[i] = SelectLod(subMesh, subMeshLods[i], pixelScale * worldScale / depth);
+                const SubMeshLod lod = subMesh->GetLod(subMeshLods[i]);
+                drawnTriangleCount      += lod.indexCount / 3;
+                fullDetailTriangleCount += subMesh->GetLod(0).indexCount / 3;
+
                 const ShaderProgram* shaderProgram = meshGroup->subMeshes[i]->GetShaderProgram();
                 const Material*      material      = meshGroup->subMeshes[i]->GetMaterial();
                 if (!shaderProgram)  shaderProgram = defaultShaderProgram;
                 if (!material)       material      = defaultMaterial;
-                DrawMesh(shaderProgram, meshGroup->subMeshes[i]->VAO, meshGroup->subMeshes[i]->GetVertexCount(),
-                         worldMat, camera, material, &lightManager);
+
+                // Draw the visible meshlets of the full detail level with one indirect draw, merging the adjacent ones.
+                // Meshlets are ranges of the full detail indices, so lower levels of detail are drawn whole.
+                if (useMeshletCulling && subMeshLods[i] == 0 && subMesh->GetMeshlets().size() > 1)
+                {
+                    if (!hasCullingData) {
+                        cullingData    = GetMeshletCullingData(worldMat, camera);
+                        hasCullingData = true;
+                    }
+                    static std::vector<DrawElementsIndirectCommand> drawCommands;
+                    drawCommands.clear();
+                    const bool cullBackFaces = (material != nullptr && material->CullsBackFaces());
+                    for (const Meshlet& meshlet : subMesh->GetMeshlets())
+                    {
+                        if (!IsMeshletVisible(meshlet, cullingData, cullBackFaces)) {
+                            drawnTriangleCount  -= meshlet.indexCount / 3;
+                            culledTriangleCount += meshlet.indexCount / 3;
+                        }
+                        else if (!drawCommands.empty() && drawCommands.back().firstIndex + drawCommands.back().count == meshlet.firstIndex) {
+                            drawCommands.back().count += meshlet.indexCount;
+                        }
+                        else {
+                            drawCommands.push_back({ meshlet.indexCount, 1, meshlet.firstIndex, 0, 0 });
+                        }
+                    }
+                    DrawMeshlets(shaderProgram, meshGroup->subMeshes[i]->VAO, drawCommands, worldMat, camera, material, &lightManager, meshGroup->subMeshes[i]);
+                    continue;
+                }
+
+                DrawMesh(shaderProgram, meshGroup->subMeshes[i]->VAO, lod.indexCount,
+                         worldMat, camera, material, &lightManager, meshGroup->subMeshes[i], lod.firstIndex);
             }
         }
     }
@@ -607,9 +870,10 @@ void SceneInstancedModel::UpdateMatrixBuffer()
     if (matrixBufferId == 0)
         return;
 
-    std::vector<Mat4> instanceMatrices; instanceMatrices.reserve(instanceCount);
-    for (Transform& t : instanceTransforms)
-        instanceMatrices.push_back(t.GetModelMat());
+    std::vector<Mat4> instanceMatrices(instanceTransforms.size());
+    Core::JobSystem::Get()->ParallelFor(0, instanceTransforms.size(), 1024, [this, &instanceMatrices](const size_t& i) {
+        instanceMatrices[i] = instanceTransforms[i].GetModelMat();
+    });
     glBindBuffer(GL_ARRAY_BUFFER, matrixBufferId);
     glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(Mat4), instanceMatrices.data(), GL_STATIC_DRAW);
 }
@@ -618,6 +882,7 @@ void SceneInstancedModel::Draw(const Camera& camera, const LightManager& lightMa
 {
     if (meshGroup != nullptr)
     {
+        meshGroup->MarkUsed(ResourceManager::GetFrameIndex());
         Mat4 worldMat = transform.GetModelMat() * transform.parentMat;
         for (size_t i = 0; i < meshGroup->subMeshes.size(); i++)
         {
@@ -628,7 +893,7 @@ void SceneInstancedModel::Draw(const Camera& camera, const LightManager& lightMa
                 if (!shaderProgram)  shaderProgram = defaultShaderProgram;
                 if (!material)       material = defaultMaterial;
 
-                DrawInstancedMesh(shaderProgram, meshGroup->subMeshes[i]->VAO, meshGroup->subMeshes[i]->GetVertexCount(), (int)instanceTransforms.size(), worldMat, camera, material, &lightManager);
+                DrawInstancedMesh(shaderProgram, meshGroup->subMeshes[i]->VAO, meshGroup->subMeshes[i]->GetLod(0).indexCount, (int)instanceTransforms.size(), worldMat, camera, material, &lightManager, meshGroup->subMeshes[i]);
             }
         }
     }
@@ -761,6 +1026,7 @@ void SceneSkybox::Draw(const Render::Camera& camera)
 {
     if (!skyboxMesh || skyboxMesh->subMeshes.size() <= 0)
         return;
+    skyboxMesh->MarkUsed(ResourceManager::GetFrameIndex());
 
     const SubMesh* skyboxSubMesh = skyboxMesh->subMeshes[0];
     const unsigned int shaderProgramId = skyboxSubMesh->GetShaderProgram()->GetId();
@@ -773,11 +1039,12 @@ void SceneSkybox::Draw(const Render::Camera& camera)
 
     // Send matrices to shader.
     glUniformMatrix4fv(glGetUniformLocation(shaderProgramId, "viewProjMat"), 1, GL_FALSE, (transform.GetModelMat() * GetRotationMatrix(camera.transform->GetRotation(), true) * camera.GetProjectionMat()).ptr);
+    SendVertexFormatToShader(shaderProgramId, skyboxSubMesh);
 
     // Draw the mesh.
     glBindVertexArray(skyboxSubMesh->VAO);
     glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap->GetId());
-    glDrawElements(GL_TRIANGLES, skyboxSubMesh->GetVertexCount(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, skyboxSubMesh->GetLod(0).indexCount, GetIndexType(skyboxSubMesh), 0);
     glBindVertexArray(0);
     glCullFace(GL_BACK);
 }
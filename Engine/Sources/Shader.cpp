@@ -3,10 +3,12 @@
 #include <sstream>
 #include <string>
 #include <cstdarg>
+#include <algorithm>
 
 #include "Debug.h"
 #include "Shader.h"
 #include "ResourceManager.h"
+#include "LoadTimeline.h"
 using namespace Core::Debug;
 using namespace Resources;
 
@@ -15,6 +17,7 @@ using namespace Resources;
 static std::string LoadShader(const std::string& filename)
 {
     // Load shader source.
+    Core::ScopedLoadPhase readPhase(filename, Core::LoadPhase::Read);
     std::string fileStr;
     {
         std::stringstream fileContents;
@@ -80,7 +83,7 @@ VertexShader::VertexShader(const std::string& filename)
 
 VertexShader::~VertexShader()
 {
-    if (WasSentToOpenGL())
+    if (id != 0)
         glDeleteShader(id);
 }
 
@@ -110,7 +113,7 @@ FragmentShader::FragmentShader(const std::string& filename)
 
 FragmentShader::~FragmentShader()
 {
-    if (WasSentToOpenGL())
+    if (id != 0)
         glDeleteShader(id);
 }
 
@@ -140,7 +143,7 @@ ComputeShader::ComputeShader(const std::string& filename)
 
 ComputeShader::~ComputeShader()
 {
-    if (WasSentToOpenGL())
+    if (id != 0)
         glDeleteShader(id);
 }
 
@@ -161,6 +164,17 @@ void ComputeShader::SendToOpenGL()
 
 // ----- Shader Program ----- //
 
+static unsigned int GetShaderId(const IResource* shader)
+{
+    switch (shader->GetType())
+    {
+    case ResourceTypes::VertexShader:   return ((const VertexShader*  )shader)->GetId();
+    case ResourceTypes::FragmentShader: return ((const FragmentShader*)shader)->GetId();
+    case ResourceTypes::ComputeShader:  return ((const ComputeShader* )shader)->GetId();
+    default:                            return 0;
+    }
+}
+
 ShaderProgram::ShaderProgram(const std::string& _name)
 {
     name = _name;
@@ -196,23 +210,8 @@ void ShaderProgram::SendToOpenGL()
 
     // Create the program, attach all shaders and link.
     id = glCreateProgram();
-    for (IResource* shader : attachedShaders) 
-    {
-        switch (shader->GetType())
-        {
-        case ResourceTypes::VertexShader:
-            glAttachShader(id, ((VertexShader*)shader)->GetId());
-            break;
-        case ResourceTypes::FragmentShader:
-            glAttachShader(id, ((FragmentShader*)shader)->GetId());
-            break;
-        case ResourceTypes::ComputeShader:
-            glAttachShader(id, ((ComputeShader*)shader)->GetId());
-            break;
-        default:
-            break;
-        }
-    }
+    for (IResource* shader : attachedShaders)
+        glAttachShader(id, GetShaderId(shader));
     glLinkProgram(id);
 
     // Check for linking errors.
@@ -226,6 +225,33 @@ void ShaderProgram::SendToOpenGL()
     SetOpenGLTransferDone();
 }
 
+bool ShaderProgram::UsesShader(const IResource* shader) const
+{
+    return std::find(attachedShaders.begin(), attachedShaders.end(), shader) != attachedShaders.end();
+}
+
+bool ShaderProgram::Relink()
+{
+    // Link a new program and only replace the current one if it succeeds, so a broken shader doesn't stop rendering.
+    unsigned int newId = glCreateProgram();
+    for (IResource* shader : attachedShaders)
+        glAttachShader(newId, GetShaderId(shader));
+    glLinkProgram(newId);
+
+    int success;
+    char infoLog[512];
+    glGetProgramiv(newId, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(newId, 512, NULL, infoLog);
+        DebugLogError("Shader program " + name + " linking failed, keeping the previous version:\n" + infoLog);
+        glDeleteProgram(newId);
+        return false;
+    }
+    glDeleteProgram(id);
+    id = newId;
+    return true;
+}
+
 ShaderProgram::~ShaderProgram()
 {
     glDeleteProgram(id);
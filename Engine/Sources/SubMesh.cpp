@@ -1,200 +1,538 @@
-#include <fstream>
 #include <filesystem>
 #include <cstdlib>
 #include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <unordered_map>
 
 #include <glad/glad.h>
 
 #include "Maths.h"
 #include "SubMesh.h"
 #include "Material.h"
+#include "ResourceManager.h"
+#include "LoadTimeline.h"
+#include "TangentSpace.h"
 using namespace Core::Maths;
 using namespace Resources;
 
 
-VertexIndices ParseObjIndices(std::string indicesStr)
+std::atomic_bool SubMesh::vertexCompression = true;
+std::atomic_bool SubMesh::indexOptimization = true;
+std::atomic_bool SubMesh::lodGeneration     = true;
+std::atomic<GeometryRetention> SubMesh::geometryRetention = GeometryRetention::Positions;
+
+// Sub-meshes with fewer triangles are drawn at full detail.
+static constexpr size_t MinLodTriangleCount = 256;
+
+// Error allowed for the first simplified level, relative to the sub-mesh's radius, doubled at each level.
+static constexpr float LodRelativeError = 0.01f;
+
+SubMesh::SubMesh(const std::string& _name, const ShaderProgram* _shaderProgram)
+{
+    name = _name;
+    shaderProgram = _shaderProgram;
+}
+
+SubMesh::~SubMesh()
+{
+    DeleteOpenGLObjects();
+}
+
+void SubMesh::DeleteOpenGLObjects()
+{
+    // Wait for the upload thread to be done with the buffers.
+    if (upload != nullptr && ResourceManager::GetGpuUploader() != nullptr)
+        ResourceManager::GetGpuUploader()->Release(upload);
+
+    // Sub-meshes that were never sent to OpenGL can be deleted by threads without an OpenGL context.
+    if (VAO != 0) glDeleteVertexArrays(1, &VAO);
+    if (VBO != 0) glDeleteBuffers(1, &VBO);
+    if (EBO != 0) glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
+}
+
+// Hashes arrays of 32 bit words (vertex indices or attribute bits).
+struct WordArrayHash
 {
-    VertexIndices vertex = { 0, 0, 0 };
-    size_t start = 0;
-    size_t end = indicesStr.find('/', start);
-    for (int i = 0; i < 3 && indicesStr[start] != '\0'; i++)
+    template <size_t N> size_t operator()(const std::array<uint32_t, N>& words) const
     {
-        // Find the current coordinate value.
-        std::string index = indicesStr.substr(start, end - start);
+        uint64_t hash = 14695981039346656037ull;
+        for (const uint32_t& word : words)
+            hash = (hash ^ word) * 1099511628211ull;
+        return (size_t)(hash ^ (hash >> 32));
+    }
+};
+
+void SubMesh::LoadVertices(const ObjVertexData& vertexData, const ObjVertexIndices& vertexIndices, const size_t& first, const size_t& count)
+{
+    auto getPos    = [&](const size_t& i) { return Vector3(vertexData[0][vertexIndices[0][i] * 3], vertexData[0][vertexIndices[0][i] * 3+1], vertexData[0][vertexIndices[0][i] * 3+2]); };
+    auto getUv     = [&](const size_t& i) { return Vector2(vertexData[1][vertexIndices[1][i] * 2], vertexData[1][vertexIndices[1][i] * 2+1]); };
+    auto getNormal = [&](const size_t& i) { return Vector3(vertexData[2][vertexIndices[2][i] * 3], vertexData[2][vertexIndices[2][i] * 3+1], vertexData[2][vertexIndices[2][i] * 3+2]); };
+
+    // Face corners with the same position, uv and normal indices use the same vertex.
+    std::unordered_map<std::array<uint32_t, 3>, uint32_t, WordArrayHash> corners;
+    corners.reserve(count);
+    indices.reserve(indices.size() + count);
 
-        // Set the current index and skip double slashes.
-        if (start != end)
-            *((&vertex.pos) + i) = std::atoi(index.c_str()) - 1;
+    for (size_t i = first; i < first + count - count % 3; i++)
+    {
+        const std::array<uint32_t, 3> corner = { vertexIndices[0][i], vertexIndices[1][i], vertexIndices[2][i] };
+        std::pair<std::unordered_map<std::array<uint32_t, 3>, uint32_t, WordArrayHash>::iterator, bool> inserted = corners.insert({ corner, (uint32_t)vertices.size() });
+        indices.push_back(inserted.first->second);
+        if (!inserted.second)
+            continue;
 
-        // Update the start and end indices.
-        start = end + 1;
-        end = indicesStr.find('/', start);
+        // Create a new vertex with the corner's data, its tangent and bitangent are computed once the vertices are welded.
+        Vector2 curUv;
+        Vector3 curNormal;
+        if (vertexData[1].size() > 0) curUv     = getUv(i);
+        if (vertexData[2].size() > 0) curNormal = getNormal(i);
+        vertices.push_back(TangentVertex{ getPos(i), curUv, curNormal, Vector3(), Vector3() });
     }
-    return vertex;
 }
 
-void ParseObjTriangle(std::string line, std::array<std::vector<uint32_t>, 3>& indices)
+void SubMesh::WeldVertices()
 {
-    size_t start = 2;
-    size_t end = line.find(' ', start);
-    if (end == start) {
-        start++;
-        end = line.find(' ', start);
+    unweldedVertexCount = (unsigned int)indices.size();
+
+    // Vertices with the same position, uv and normal bits are merged (duplicated values in the file give different index triples).
+    static_assert(sizeof(Vector3) * 2 + sizeof(Vector2) == 8 * sizeof(uint32_t), "Vertex attributes are expected to be tightly packed floats.");
+    std::unordered_map<std::array<uint32_t, 8>, uint32_t, WordArrayHash> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+    std::vector<uint32_t>      remap(vertices.size());
+    std::vector<TangentVertex> welded;
+    welded.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        std::array<uint32_t, 8> attributes;
+        std::memcpy(attributes.data(), &vertices[i].pos, sizeof(attributes));
+        std::pair<std::unordered_map<std::array<uint32_t, 8>, uint32_t, WordArrayHash>::iterator, bool> inserted = uniqueVertices.insert({ attributes, (uint32_t)welded.size() });
+        if (inserted.second)
+            welded.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
     }
+    welded.shrink_to_fit();
+    vertices.swap(welded);
 
-    for (int i = 0; i < 3; i++)
+    // Compute the bounding box.
+    if (!vertices.empty())
     {
-        // Find the current coordinate value.
-        std::string indicesStr = line.substr(start, end - start) + '/';
+        boundsMin = vertices[0].pos;
+        boundsMax = vertices[0].pos;
+        for (const TangentVertex& vertex : vertices)
+        {
+            boundsMin = Vector3(std::min(boundsMin.x, vertex.pos.x), std::min(boundsMin.y, vertex.pos.y), std::min(boundsMin.z, vertex.pos.z));
+            boundsMax = Vector3(std::max(boundsMax.x, vertex.pos.x), std::max(boundsMax.y, vertex.pos.y), std::max(boundsMax.z, vertex.pos.z));
+        }
+    }
 
-        // Set the current index.
-        VertexIndices vertexIndices = ParseObjIndices(indicesStr);
-        for (int i = 0; i < 3; i++)
-            indices[i].push_back(*((&vertexIndices.pos) + i));
+    for (unsigned int& index : indices)
+        index = remap[index];
+}
+
+void SubMesh::GenerateTangents(Core::JobSystem* jobSystem)
+{
+    TangentSpace::Generate(vertices, indices, jobSystem);
+}
 
-        // Update the start and end line of the coord val.
-        start = end + 1;
-        end = line.find(' ', start);
+void SubMesh::OptimizeIndices()
+{
+    cacheStatsBefore = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
+    if (IndexOptimization())
+    {
+        MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+        MeshOptimizer::OptimizeOverdraw   (indices, vertices);
+        MeshOptimizer::OptimizeVertexFetch(vertices, indices);
     }
+    cacheStatsAfter = MeshOptimizer::AnalyzeVertexCache(indices, vertices.size());
 }
 
-SubMesh::SubMesh(const std::string& _name, const ShaderProgram* _shaderProgram)
+void SubMesh::BuildMeshlets()
 {
-    name = _name;
-    shaderProgram = _shaderProgram;
+    // Meshlets are ranges of the final triangle order, so the vertex cache stats of OptimizeIndices still apply.
+    meshlets = MeshOptimizer::BuildMeshlets(indices, vertices);
+    meshlets.shrink_to_fit();
 }
 
-SubMesh::~SubMesh()
+void SubMesh::GenerateLods()
 {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
+    lods.assign(1, { 0, (unsigned int)indices.size(), 0 });
+    if (!LodGeneration() || indices.size() < MinLodTriangleCount * 3)
+        return;
+
+    // Each level simplifies the previous one, until it can't remove a quarter of its triangles without exceeding its error.
+    const float radius = (boundsMax - boundsMin).getLength() * 0.5f;
+    std::vector<unsigned int> lodIndices = indices;
+    float lodError = 0;
+    for (unsigned int level = 1; level < MaxLodCount; level++)
+    {
+        const size_t previousCount = lodIndices.size();
+        const float  targetError   = radius * LodRelativeError * (float)(1 << (level - 1));
+        lodError += MeshOptimizer::Simplify(lodIndices, vertices, previousCount / 6 * 3, targetError);
+        if (lodIndices.size() > previousCount * 3 / 4)
+            break;
+
+        if (IndexOptimization())
+            MeshOptimizer::OptimizeVertexCache(lodIndices, vertices.size());
+        lods.push_back({ (unsigned int)indices.size(), (unsigned int)lodIndices.size(), lodError });
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+    indices.shrink_to_fit();
 }
 
-void SubMesh::LoadVertices(std::stringstream& fileContents, const std::array<std::vector<float>, 3>& vertexData)
+void SubMesh::SetCachedVertices(const TangentVertex* cachedVertices, const size_t& cachedVertexCount, const unsigned int* cachedIndices, const size_t& cachedIndexCount,
+                                const unsigned int& cachedUnweldedVertexCount, const Vector3& cachedBoundsMin, const Vector3& cachedBoundsMax)
 {
-    // Holds all vertex data as indices to the vertexData array.
-    // Format: indices[0] = pos, indices[1] = uvs, indices[3] = normals.
-    std::array<std::vector<uint32_t>, 3> vertexIndices;
+    vertices.assign(cachedVertices, cachedVertices + cachedVertexCount);
+    indices .assign(cachedIndices,  cachedIndices  + cachedIndexCount);
+    unweldedVertexCount = cachedUnweldedVertexCount;
+    boundsMin = cachedBoundsMin;
+    boundsMax = cachedBoundsMax;
+}
 
-    // Read file line by line to create vertex data.
-    std::string line;
-    while (std::getline(fileContents, line)) 
+// Compact vertex attributes, decoded by the vertex shaders.
+struct CompactVertex
+{
+    uint16_t pos[4];    // Normalized in the sub-mesh's bounds, the last one is padding.
+    uint16_t uv[2];     // Half floats.
+    int16_t  normal[2]; // Octahedral encoding.
+};
+struct CompactTangent
+{
+    int16_t tangent[2];    // Octahedral encoding.
+    int16_t bitangentSign; // Sign of the bitangent compared to the cross product of the normal and tangent.
+    int16_t padding;
+};
+static_assert(sizeof(CompactVertex) == 16 && sizeof(CompactTangent) == 8, "Compact vertex attributes are expected to be tightly packed.");
+
+// Converts the given float to a half float, rounding to the nearest.
+static uint16_t FloatToHalf(const float& value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const int      exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t       mantissa = bits & 0x7fffff;
+
+    // Infinities and NaNs.
+    if (((bits >> 23) & 0xff) == 0xff)
+        return (uint16_t)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7c00);
+
+    // Values too small for a normalized half float become subnormal.
+    uint32_t half, rest, halfway;
+    if (exponent <= 0)
     {
-        line += ' ';
-        switch (line[0])
-        {
-        // Parse object indices.
-        case 'f':
-            ParseObjTriangle(line, vertexIndices);
-            continue;
-        // Skip comments, smooth lighting statements and empty lines.
-        case '#':
-        case 's':
-        case ' ':
-        case '\n':
-        case '\0':
-            continue;
-        // Stop whenever another symbol is encountered.
-        default:
-            fileContents.seekg(fileContents.tellg() - std::streamoff(line.size()));
-            break;
-        }
-        break;
+        if (exponent < -10)
+            return (uint16_t)sign;
+        const int shift = 14 - exponent;
+        mantissa |= 0x800000;
+        half    = mantissa >> shift;
+        rest    = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
     }
+    else
+    {
+        half    = ((uint32_t)exponent << 10) | (mantissa >> 13);
+        rest    = mantissa & 0x1fff;
+        halfway = 0x1000;
+    }
+    if (rest > halfway || (rest == halfway && (half & 1)))
+        half++;
+    return (uint16_t)(sign | half);
+}
 
-    // Get the first index.
-    uint32_t startIndex = 0;
-    if (indices.size() > 0)
-        startIndex = indices[indices.size()-1] + 1;
-    
-    // Add all parsed data to the vertices array.
-    for (size_t i = 0; i < vertexIndices[0].size(); i++)
+// Projects the given direction on an octahedron unfolded in a square, stored as two normalized shorts.
+static void OctahedralEncode(const Vector3& direction, int16_t* encoded)
+{
+    float x = 0, y = 0;
+    const float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (length > 0)
     {
-        // Get the current vertex's position.
-        Vector3 curPos = Vector3(vertexData[0][vertexIndices[0][i] * 3], vertexData[0][vertexIndices[0][i] * 3+1], vertexData[0][vertexIndices[0][i] * 3+2]);
+        x = direction.x / length;
+        y = direction.y / length;
+        if (direction.z < 0) {
+            const float foldedX = (1 - std::abs(y)) * (x >= 0 ? 1.f : -1.f);
+            const float foldedY = (1 - std::abs(x)) * (y >= 0 ? 1.f : -1.f);
+            x = foldedX;
+            y = foldedY;
+        }
+    }
+    encoded[0] = (int16_t)std::lround(std::clamp(x, -1.f, 1.f) * 32767.f);
+    encoded[1] = (int16_t)std::lround(std::clamp(y, -1.f, 1.f) * 32767.f);
+}
 
-        // Get the current vertex's texture coordinates.
-        Vector2 curUv;
-        if (vertexData[1].size() > 0) curUv = Vector2(vertexData[1][vertexIndices[1][i] * 2], vertexData[1][vertexIndices[1][i] * 2+1]);
+// Scale from positions relative to the bounds' minimum to 16-bit integers, flat axes are mapped to 0.
+static Vector3 GetPositionScale(const Vector3& boundsMin, const Vector3& boundsMax)
+{
+    const Vector3 boundsSize = boundsMax - boundsMin;
+    return { boundsSize.x > 0 ? 65535 / boundsSize.x : 0,
+             boundsSize.y > 0 ? 65535 / boundsSize.y : 0,
+             boundsSize.z > 0 ? 65535 / boundsSize.z : 0 };
+}
 
-        // Get the current vertex's normal.
-        Vector3 curNormal;
-        if (vertexData[2].size() > 0) curNormal = Vector3(vertexData[2][vertexIndices[2][i] * 3], vertexData[2][vertexIndices[2][i] * 3+1], vertexData[2][vertexIndices[2][i] * 3+2]);
+static void QuantizePosition(const Vector3& pos, const Vector3& boundsMin, const Vector3& posScale, uint16_t* quantized)
+{
+    const float relativePos[3] = { (pos.x - boundsMin.x) * posScale.x, (pos.y - boundsMin.y) * posScale.y, (pos.z - boundsMin.z) * posScale.z };
+    for (int j = 0; j < 3; j++)
+        quantized[j] = (uint16_t)std::clamp(std::lround(relativePos[j]), 0l, 65535l);
+}
 
-        // Get the current face's tangent and bitangent.
-        static Vector3 curTangent, curBitangent;
-        if (i % 3 == 0)
-        {
-            Vector3 edge1    = Vector3(vertexData[0][vertexIndices[0][i+1] * 3], vertexData[0][vertexIndices[0][i+1] * 3+1], vertexData[0][vertexIndices[0][i+1] * 3+2]) - curPos;
-            Vector3 edge2    = Vector3(vertexData[0][vertexIndices[0][i+2] * 3], vertexData[0][vertexIndices[0][i+2] * 3+1], vertexData[0][vertexIndices[0][i+2] * 3+2]) - curPos;
-            Vector2 deltaUv1 = Vector2(vertexData[1][vertexIndices[1][i+1] * 2], vertexData[1][vertexIndices[1][i+1] * 2+1]) - curUv;
-            Vector2 deltaUv2 = Vector2(vertexData[1][vertexIndices[1][i+2] * 2], vertexData[1][vertexIndices[1][i+2] * 2+1]) - curUv;
+void SubMesh::CompressVertices()
+{
+    std::vector<unsigned char>().swap(compactVertices);
+    std::vector<unsigned short>().swap(compactIndices);
+    if (!VertexCompression() || vertices.empty())
+        return;
+
+    // The tangent stream is placed after the other attributes so that it can be left out of the buffer.
+    const size_t count = vertices.size();
+    compactVertices.resize(count * (sizeof(CompactVertex) + sizeof(CompactTangent)));
+    CompactVertex*  compactAttributes = (CompactVertex* )compactVertices.data();
+    CompactTangent* compactTangents   = (CompactTangent*)(compactVertices.data() + count * sizeof(CompactVertex));
+
+    const Vector3 posScale = GetPositionScale(boundsMin, boundsMax);
+    for (size_t i = 0; i < count; i++)
+    {
+        const TangentVertex& vertex = vertices[i];
+        CompactVertex&  compactVertex  = compactAttributes[i];
+        CompactTangent& compactTangent = compactTangents[i];
+
+        QuantizePosition(vertex.pos, boundsMin, posScale, compactVertex.pos);
+        compactVertex.pos[3] = 0;
+        compactVertex.uv[0]  = FloatToHalf(vertex.uv.x);
+        compactVertex.uv[1]  = FloatToHalf(vertex.uv.y);
+        OctahedralEncode(vertex.normal, compactVertex.normal);
+
+        // The tangent is made orthogonal to the normal, the bitangent is rebuilt from their cross product.
+        const Vector3 normal  = vertex.normal.getNormalized();
+        const Vector3 tangent = vertex.tangent - normal * (normal & vertex.tangent);
+        OctahedralEncode(tangent, compactTangent.tangent);
+        compactTangent.bitangentSign = (((normal ^ tangent) & vertex.bitangent) < 0 ? -32767 : 32767);
+        compactTangent.padding       = 0;
+    }
 
-            float f = 1.0f / (deltaUv1.x * deltaUv2.y - deltaUv2.x * deltaUv1.y);
+    if (count <= 65536)
+        compactIndices.assign(indices.begin(), indices.end());
+}
 
-            curTangent.x = f * (deltaUv2.y * edge1.x - deltaUv1.y * edge2.x);
-            curTangent.y = f * (deltaUv2.y * edge1.y - deltaUv1.y * edge2.y);
-            curTangent.z = f * (deltaUv2.y * edge1.z - deltaUv1.y * edge2.z);
+// Copies as much data to the buffer as this frame's upload budget allows, returns true once all of it is uploaded.
+static bool StreamToBuffer(UploadStreamer* streamer, const unsigned int& buffer, const void* data, const size_t& size, size_t& uploadedSize)
+{
+    while (uploadedSize < size)
+    {
+        size_t chunkSize = std::min(size - uploadedSize, streamer->GetAvailableBytes());
+        if (chunkSize <= 0)
+            return false;
+        size_t offset = streamer->Stage((const unsigned char*)data + uploadedSize, chunkSize);
+        glCopyNamedBufferSubData(streamer->GetBufferId(), buffer, offset, uploadedSize, chunkSize);
+        uploadedSize += chunkSize;
+    }
+    return true;
+}
 
-            curBitangent.x = f * (-deltaUv2.x * edge1.x + deltaUv1.x * edge2.x);
-            curBitangent.y = f * (-deltaUv2.x * edge1.y + deltaUv1.x * edge2.y);
-            curBitangent.z = f * (-deltaUv2.x * edge1.z + deltaUv1.x * edge2.z);
-        }
+void SubMesh::SetMaterial(Material* _material)
+{
+    material = _material;
+}
 
-        // Create a new vertex with the computed data.
-        vertices.push_back(TangentVertex{ curPos, curUv, curNormal, curTangent, curBitangent });
-        indices .push_back(startIndex + (uint32_t)i);
+SubMeshLod SubMesh::GetLod(const unsigned int& level) const
+{
+    if (lods.empty())
+        return { 0, indexCount, 0 };
+    return lods[std::min(level, (unsigned int)lods.size() - 1)];
+}
+
+const char* SubMesh::GetGeometryRetentionName(const GeometryRetention& _retention)
+{
+    switch (_retention)
+    {
+    case GeometryRetention::Bounds:    return "Bounds";
+    case GeometryRetention::Positions: return "Positions";
+    case GeometryRetention::Full:      return "Full";
+    default:                           return "Unknown";
     }
 }
 
+std::vector<Vector3> SubMesh::GetPositions() const
+{
+    std::vector<Vector3> positions;
+    if (!vertices.empty())
+    {
+        positions.reserve(vertices.size());
+        for (const TangentVertex& vertex : vertices)
+            positions.push_back(vertex.pos);
+        return positions;
+    }
+
+    // Decode the quantized positions in the bounds.
+    const Vector3 boundsSize = boundsMax - boundsMin;
+    const Vector3 posStep    = boundsSize / 65535;
+    positions.reserve(retainedPositions.size() / 3);
+    for (size_t i = 0; i + 2 < retainedPositions.size(); i += 3)
+        positions.push_back({ boundsMin.x + retainedPositions[i]   * posStep.x,
+                              boundsMin.y + retainedPositions[i+1] * posStep.y,
+                              boundsMin.z + retainedPositions[i+2] * posStep.z });
+    return positions;
+}
+
+size_t SubMesh::GetCpuBytes() const
+{
+    if (!IsLoaded())
+        return 0;
+    return vertices.capacity() * sizeof(TangentVertex) + indices.capacity() * sizeof(unsigned int) + retainedPositions.capacity() * sizeof(uint16_t)
+         + compactVertices.capacity() + compactIndices.capacity() * sizeof(unsigned short) + meshlets.capacity() * sizeof(Meshlet) + lods.capacity() * sizeof(SubMeshLod);
+}
+
+size_t SubMesh::GetGpuBytes() const
+{
+    if (!WasSentToOpenGL())
+        return 0;
+    return uploadedVertexBytes + uploadedIndexBytes;
+}
+
+size_t SubMesh::GetUncompressedGpuBytes() const
+{
+    if (!WasSentToOpenGL())
+        return 0;
+    return vertexCount * sizeof(TangentVertex) + indexCount * sizeof(unsigned int);
+}
+
+size_t SubMesh::GetUnweldedGpuBytes() const
+{
+    if (!WasSentToOpenGL())
+        return 0;
+    return unweldedVertexCount * (sizeof(TangentVertex) + sizeof(unsigned int));
+}
+
 bool SubMesh::SendVerticesToOpenGL(size_t& totalVertexCount)
 {
     if (vertices.size() <= 0 || !IsLoaded() || WasSentToOpenGL())
         return false;
 
-    // Store the number of vertices in the model.
+    // Choose the uploaded data, the compact tangent stream is left out for materials without normal maps.
+    if (!uploadSubmitted && VBO == 0)
+    {
+        const Material* mat = material;
+        compact      = !compactVertices.empty();
+        hasTangents  = !compact || (mat != nullptr && (!mat->IsDefined() || mat->normalMap != nullptr));
+        shortIndices = compact && !compactIndices.empty();
+    }
+    const void*  vertexData  = (compact      ? (const void*)compactVertices.data() : (const void*)vertices.data());
+    const void*  indexData   = (shortIndices ? (const void*)compactIndices .data() : (const void*)indices .data());
+    const size_t vertexBytes = (compact      ? vertices.size() * (sizeof(CompactVertex) + (hasTangents ? sizeof(CompactTangent) : 0)) : vertices.size() * sizeof(TangentVertex));
+    const size_t indexBytes  = (shortIndices ? indices.size() * sizeof(unsigned short) : indices.size() * sizeof(unsigned int));
+
+    // Let the upload thread create and fill the buffers if there is one.
+    GpuUploader*    uploader = ResourceManager::GetGpuUploader();
+    UploadStreamer* streamer = ResourceManager::GetUploadStreamer();
+    if (uploader != nullptr && !uploadSubmitted)
+    {
+        uploadSubmitted = true;
+        upload = uploader->Submit([this, vertexData, indexData, vertexBytes, indexBytes]()
+        {
+            Core::ScopedLoadPhase uploadPhase(name, Core::LoadPhase::Upload);
+            glCreateBuffers(1, &VBO);
+            glCreateBuffers(1, &EBO);
+            glNamedBufferStorage(VBO, vertexBytes, vertexData, 0);
+            glNamedBufferStorage(EBO, indexBytes,  indexData,  0);
+            uploadedVertexBytes = vertexBytes;
+            uploadedIndexBytes  = indexBytes;
+        });
+        return false;
+    }
+    if (upload != nullptr)
+    {
+        if (!GpuUploader::IsReady(upload))
+            return false;
+        upload = nullptr;
+    }
+
+    // Create the vertex and index buffers, filled directly when there is no upload streamer.
+    if (VBO == 0)
+    {
+        glCreateBuffers(1, &VBO);
+        glCreateBuffers(1, &EBO);
+        glNamedBufferStorage(VBO, vertexBytes, (streamer != nullptr ? nullptr : vertexData), 0);
+        glNamedBufferStorage(EBO, indexBytes,  (streamer != nullptr ? nullptr : indexData),  0);
+        uploadedVertexBytes = (streamer != nullptr ? 0 : vertexBytes);
+        uploadedIndexBytes  = (streamer != nullptr ? 0 : indexBytes);
+    }
+
+    // Stream the buffers' data, the rest will be uploaded in the next frames.
+    if (uploadedVertexBytes < vertexBytes && !StreamToBuffer(streamer, VBO, vertexData, vertexBytes, uploadedVertexBytes))
+        return false;
+    if (uploadedIndexBytes  < indexBytes  && !StreamToBuffer(streamer, EBO, indexData,  indexBytes,  uploadedIndexBytes))
+        return false;
+
+    // Store the number of vertices and indices in the model.
     vertexCount = (unsigned int)vertices.size();
+    indexCount  = (unsigned int)indices .size();
 
     // Create and bind the Vertex Array Object.
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
-
-    // Create, bind and set the vertex buffer.
-    glGenBuffers(1, &VBO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(TangentVertex), vertices.data(), GL_STATIC_DRAW);
-
-    // Create, bind and set the index buffer.
-    glGenBuffers(1, &EBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
-    // Set the position attribute pointer.
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)0);
-    glEnableVertexAttribArray(0);
+    if (compact)
+    {
+        // Set the normalized position, half float uv and octahedral normal attribute pointers.
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE,  sizeof(CompactVertex), (void*)offsetof(CompactVertex, pos));
+        glVertexAttribPointer(1, 2, GL_HALF_FLOAT,     GL_FALSE, sizeof(CompactVertex), (void*)offsetof(CompactVertex, uv));
+        glVertexAttribPointer(2, 2, GL_SHORT,          GL_TRUE,  sizeof(CompactVertex), (void*)offsetof(CompactVertex, normal));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+
+        // Set the octahedral tangent and bitangent sign attribute pointer, the bitangent is computed by the shader.
+        if (hasTangents) {
+            glVertexAttribPointer(3, 3, GL_SHORT, GL_TRUE, sizeof(CompactTangent), (void*)(vertices.size() * sizeof(CompactVertex)));
+            glEnableVertexAttribArray(3);
+        }
+    }
+    else
+    {
+        // Set the position attribute pointer.
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)0);
+        glEnableVertexAttribArray(0);
 
-    // Set the uv attribute pointer.
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+        // Set the uv attribute pointer.
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
 
-    // Set the normal attribute pointer.
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(5 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+        // Set the normal attribute pointer.
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(5 * sizeof(float)));
+        glEnableVertexAttribArray(2);
 
-    // Set the tangent attribute pointer.
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
+        // Set the tangent attribute pointer.
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(8 * sizeof(float)));
+        glEnableVertexAttribArray(3);
 
-    // Set the bitTangent attribute pointer.
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(11 * sizeof(float)));
-    glEnableVertexAttribArray(4);
+        // Set the bitTangent attribute pointer.
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(TangentVertex), (void*)(11 * sizeof(float)));
+        glEnableVertexAttribArray(4);
+    }
 
     totalVertexCount += vertexCount;
 
-    // Free vertex arrays.
-    // vertices.clear();
-    indices.clear();
+    // Keep the retained geometry and free the rest of the vertex arrays.
+    retention = GetGeometryRetention();
+    if (retention == GeometryRetention::Positions)
+    {
+        const Vector3 posScale = GetPositionScale(boundsMin, boundsMax);
+        retainedPositions.resize(vertices.size() * 3);
+        for (size_t i = 0; i < vertices.size(); i++)
+            QuantizePosition(vertices[i].pos, boundsMin, posScale, &retainedPositions[i * 3]);
+    }
+    if (retention != GeometryRetention::Full)
+        std::vector<TangentVertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+    std::vector<unsigned char>().swap(compactVertices);
+    std::vector<unsigned short>().swap(compactIndices);
     sentToOpenGL.store(true);
     return true;
 }
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TANGENTS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TANGENTS_AVX2_TARGET
+#else
+#define TANGENTS_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "Debug.h"
+#include "Maths.h"
+#include "JobSystem.h"
+#include "TangentSpace.h"
+using namespace Core::Maths;
+using namespace Resources;
+
+
+// Vertex positions and uvs in separate arrays, so that batches of triangles can load them in SIMD registers.
+struct TangentVertexArrays
+{
+    std::vector<float> px, py, pz, u, v;
+};
+
+// Tangents and bitangents of the triangles, in separate arrays.
+struct FaceTangentArrays
+{
+    std::vector<float> tx, ty, tz, bx, by, bz;
+};
+
+// Number of triangles and vertices processed by each job.
+static constexpr size_t TriangleBatchSize = 8192;
+static constexpr size_t VertexBatchSize   = 8192;
+
+// ----- Triangle tangents ----- //
+
+// Tangent and bitangent of the given triangles, degenerate uvs don't give any.
+static void ComputeFaceTangentsScalar(const TangentVertexArrays& vertices, const unsigned int* indices, const size_t& first, const size_t& end, FaceTangentArrays& faces)
+{
+    for (size_t t = first; t < end; t++)
+    {
+        const unsigned int i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+        const float e1x = vertices.px[i1] - vertices.px[i0], e1y = vertices.py[i1] - vertices.py[i0], e1z = vertices.pz[i1] - vertices.pz[i0];
+        const float e2x = vertices.px[i2] - vertices.px[i0], e2y = vertices.py[i2] - vertices.py[i0], e2z = vertices.pz[i2] - vertices.pz[i0];
+        const float du1 = vertices.u[i1] - vertices.u[i0], dv1 = vertices.v[i1] - vertices.v[i0];
+        const float du2 = vertices.u[i2] - vertices.u[i0], dv2 = vertices.v[i2] - vertices.v[i0];
+
+        const float determinant = du1 * dv2 - du2 * dv1;
+        const float f = (determinant != 0 ? 1.f / determinant : 0.f);
+        faces.tx[t] = f * (dv2 * e1x - dv1 * e2x);
+        faces.ty[t] = f * (dv2 * e1y - dv1 * e2y);
+        faces.tz[t] = f * (dv2 * e1z - dv1 * e2z);
+        faces.bx[t] = f * (du1 * e2x - du2 * e1x);
+        faces.by[t] = f * (du1 * e2y - du2 * e1y);
+        faces.bz[t] = f * (du1 * e2z - du2 * e1z);
+    }
+}
+
+#ifdef TANGENTS_X86
+// Same as the scalar version, 4 triangles at a time. The operations are done in the same order so the results are identical.
+static void ComputeFaceTangentsSse(const TangentVertexArrays& vertices, const unsigned int* indices, const size_t& first, const size_t& end, FaceTangentArrays& faces)
+{
+    size_t t = first;
+    for (; t + 4 <= end; t += 4)
+    {
+        const unsigned int* tri = indices + t * 3;
+        auto load = [tri](const std::vector<float>& values, const int& corner) {
+            return _mm_setr_ps(values[tri[corner]], values[tri[3 + corner]], values[tri[6 + corner]], values[tri[9 + corner]]);
+        };
+        const __m128 p0x = load(vertices.px, 0), p0y = load(vertices.py, 0), p0z = load(vertices.pz, 0), u0 = load(vertices.u, 0), v0 = load(vertices.v, 0);
+        const __m128 e1x = _mm_sub_ps(load(vertices.px, 1), p0x), e1y = _mm_sub_ps(load(vertices.py, 1), p0y), e1z = _mm_sub_ps(load(vertices.pz, 1), p0z);
+        const __m128 e2x = _mm_sub_ps(load(vertices.px, 2), p0x), e2y = _mm_sub_ps(load(vertices.py, 2), p0y), e2z = _mm_sub_ps(load(vertices.pz, 2), p0z);
+        const __m128 du1 = _mm_sub_ps(load(vertices.u, 1), u0), dv1 = _mm_sub_ps(load(vertices.v, 1), v0);
+        const __m128 du2 = _mm_sub_ps(load(vertices.u, 2), u0), dv2 = _mm_sub_ps(load(vertices.v, 2), v0);
+
+        const __m128 determinant = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+        const __m128 f = _mm_and_ps(_mm_cmpneq_ps(determinant, _mm_setzero_ps()), _mm_div_ps(_mm_set1_ps(1.f), determinant));
+        _mm_storeu_ps(&faces.tx[t], _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(dv2, e1x), _mm_mul_ps(dv1, e2x))));
+        _mm_storeu_ps(&faces.ty[t], _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(dv2, e1y), _mm_mul_ps(dv1, e2y))));
+        _mm_storeu_ps(&faces.tz[t], _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(dv2, e1z), _mm_mul_ps(dv1, e2z))));
+        _mm_storeu_ps(&faces.bx[t], _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(du1, e2x), _mm_mul_ps(du2, e1x))));
+        _mm_storeu_ps(&faces.by[t], _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(du1, e2y), _mm_mul_ps(du2, e1y))));
+        _mm_storeu_ps(&faces.bz[t], _mm_mul_ps(f, _mm_sub_ps(_mm_mul_ps(du1, e2z), _mm_mul_ps(du2, e1z))));
+    }
+    ComputeFaceTangentsScalar(vertices, indices, t, end, faces);
+}
+
+// Loads the values of the given vertices.
+TANGENTS_AVX2_TARGET static inline __m256 GatherAvx2(const std::vector<float>& values, const __m256i& vertexIndices)
+{
+    return _mm256_i32gather_ps(values.data(), vertexIndices, 4);
+}
+
+// Same as the scalar version, 8 triangles at a time with gathered loads.
+TANGENTS_AVX2_TARGET static void ComputeFaceTangentsAvx2(const TangentVertexArrays& vertices, const unsigned int* indices, const size_t& first, const size_t& end, FaceTangentArrays& faces)
+{
+    const __m256i triangleOffsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    size_t t = first;
+    for (; t + 8 <= end; t += 8)
+    {
+        const int*    tri = (const int*)(indices + t * 3);
+        const __m256i i0  = _mm256_i32gather_epi32(tri,     triangleOffsets, 4);
+        const __m256i i1  = _mm256_i32gather_epi32(tri + 1, triangleOffsets, 4);
+        const __m256i i2  = _mm256_i32gather_epi32(tri + 2, triangleOffsets, 4);
+
+        const __m256 p0x = GatherAvx2(vertices.px, i0), p0y = GatherAvx2(vertices.py, i0), p0z = GatherAvx2(vertices.pz, i0), u0 = GatherAvx2(vertices.u, i0), v0 = GatherAvx2(vertices.v, i0);
+        const __m256 e1x = _mm256_sub_ps(GatherAvx2(vertices.px, i1), p0x), e1y = _mm256_sub_ps(GatherAvx2(vertices.py, i1), p0y), e1z = _mm256_sub_ps(GatherAvx2(vertices.pz, i1), p0z);
+        const __m256 e2x = _mm256_sub_ps(GatherAvx2(vertices.px, i2), p0x), e2y = _mm256_sub_ps(GatherAvx2(vertices.py, i2), p0y), e2z = _mm256_sub_ps(GatherAvx2(vertices.pz, i2), p0z);
+        const __m256 du1 = _mm256_sub_ps(GatherAvx2(vertices.u, i1), u0), dv1 = _mm256_sub_ps(GatherAvx2(vertices.v, i1), v0);
+        const __m256 du2 = _mm256_sub_ps(GatherAvx2(vertices.u, i2), u0), dv2 = _mm256_sub_ps(GatherAvx2(vertices.v, i2), v0);
+
+        const __m256 determinant = _mm256_sub_ps(_mm256_mul_ps(du1, dv2), _mm256_mul_ps(du2, dv1));
+        const __m256 f = _mm256_and_ps(_mm256_cmp_ps(determinant, _mm256_setzero_ps(), _CMP_NEQ_UQ), _mm256_div_ps(_mm256_set1_ps(1.f), determinant));
+        _mm256_storeu_ps(&faces.tx[t], _mm256_mul_ps(f, _mm256_sub_ps(_mm256_mul_ps(dv2, e1x), _mm256_mul_ps(dv1, e2x))));
+        _mm256_storeu_ps(&faces.ty[t], _mm256_mul_ps(f, _mm256_sub_ps(_mm256_mul_ps(dv2, e1y), _mm256_mul_ps(dv1, e2y))));
+        _mm256_storeu_ps(&faces.tz[t], _mm256_mul_ps(f, _mm256_sub_ps(_mm256_mul_ps(dv2, e1z), _mm256_mul_ps(dv1, e2z))));
+        _mm256_storeu_ps(&faces.bx[t], _mm256_mul_ps(f, _mm256_sub_ps(_mm256_mul_ps(du1, e2x), _mm256_mul_ps(du2, e1x))));
+        _mm256_storeu_ps(&faces.by[t], _mm256_mul_ps(f, _mm256_sub_ps(_mm256_mul_ps(du1, e2y), _mm256_mul_ps(du2, e1y))));
+        _mm256_storeu_ps(&faces.bz[t], _mm256_mul_ps(f, _mm256_sub_ps(_mm256_mul_ps(du1, e2z), _mm256_mul_ps(du2, e1z))));
+    }
+    ComputeFaceTangentsScalar(vertices, indices, t, end, faces);
+}
+
+// AVX2 needs to be supported by both the processor and the OS (which saves the 256 bit registers).
+static bool IsAvx2Supported()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+using FaceTangentsFunction = void(*)(const TangentVertexArrays&, const unsigned int*, const size_t&, const size_t&, FaceTangentArrays&);
+
+static FaceTangentsFunction GetFaceTangentsFunction(const bool& useSimd)
+{
+#ifdef TANGENTS_X86
+    static const bool avx2Supported = IsAvx2Supported();
+    if (useSimd)
+        return (avx2Supported ? ComputeFaceTangentsAvx2 : ComputeFaceTangentsSse);
+#endif
+    return ComputeFaceTangentsScalar;
+}
+
+const char* TangentSpace::GetSimdName()
+{
+    const FaceTangentsFunction function = GetFaceTangentsFunction(true);
+#ifdef TANGENTS_X86
+    if (function == ComputeFaceTangentsAvx2) return "AVX2";
+    if (function == ComputeFaceTangentsSse)  return "SSE2";
+#endif
+    return "scalar";
+}
+
+// ----- Vertex tangents ----- //
+
+// Makes the tangent orthogonal to the normal and rebuilds the bitangent from them, keeping its side.
+static void Orthonormalize(TangentVertex& vertex)
+{
+    const Vector3 normal = vertex.normal.getNormalized();
+    if (normal == Vector3())
+        return;
+
+    // Vertices without tangent (no uvs) get any direction orthogonal to the normal.
+    Vector3 tangent = vertex.tangent - normal * (normal & vertex.tangent);
+    if (tangent.getLength() <= 1e-12f)
+        tangent = normal ^ (std::abs(normal.x) < 0.9f ? Vector3(1, 0, 0) : Vector3(0, 1, 0));
+    tangent = tangent.getNormalized();
+
+    const Vector3 bitangent = normal ^ tangent;
+    vertex.tangent   = tangent;
+    vertex.bitangent = ((bitangent & vertex.bitangent) < 0 ? -bitangent : bitangent);
+}
+
+void TangentSpace::Generate(std::vector<TangentVertex>& vertices, const std::vector<unsigned int>& indices, Core::JobSystem* jobSystem, const bool& useSimd)
+{
+    const size_t vertexCount   = vertices.size();
+    const size_t triangleCount = indices.size() / 3;
+    auto parallelFor = [jobSystem](const size_t& count, const size_t& batchSize, const auto& body)
+    {
+        const size_t batchCount = (count + batchSize - 1) / batchSize;
+        auto batch = [&body, count, batchSize](const size_t& i) { body(i * batchSize, std::min((i + 1) * batchSize, count)); };
+        if (jobSystem != nullptr) jobSystem->ParallelFor(0, batchCount, 1, batch);
+        else for (size_t i = 0; i < batchCount; i++) batch(i);
+    };
+
+    // Copy the positions and uvs to separate arrays.
+    TangentVertexArrays vertexArrays;
+    for (std::vector<float>* values : { &vertexArrays.px, &vertexArrays.py, &vertexArrays.pz, &vertexArrays.u, &vertexArrays.v })
+        values->resize(vertexCount);
+    parallelFor(vertexCount, VertexBatchSize, [&vertices, &vertexArrays](const size_t& first, const size_t& end)
+    {
+        for (size_t i = first; i < end; i++) {
+            vertexArrays.px[i] = vertices[i].pos.x;
+            vertexArrays.py[i] = vertices[i].pos.y;
+            vertexArrays.pz[i] = vertices[i].pos.z;
+            vertexArrays.u [i] = vertices[i].uv .x;
+            vertexArrays.v [i] = vertices[i].uv .y;
+        }
+    });
+
+    // Compute the tangent and bitangent of each triangle.
+    FaceTangentArrays faces;
+    for (std::vector<float>* values : { &faces.tx, &faces.ty, &faces.tz, &faces.bx, &faces.by, &faces.bz })
+        values->resize(triangleCount);
+    const FaceTangentsFunction computeFaceTangents = GetFaceTangentsFunction(useSimd);
+    parallelFor(triangleCount, TriangleBatchSize, [&](const size_t& first, const size_t& end) { computeFaceTangents(vertexArrays, indices.data(), first, end, faces); });
+
+    // List the triangles of each vertex in order, so that each vertex sums its triangles' tangents in the same order whatever the batches.
+    std::vector<unsigned int> vertexTriangleOffsets(vertexCount + 1, 0);
+    std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        vertexTriangleOffsets[indices[i] + 1]++;
+    for (size_t i = 0; i < vertexCount; i++)
+        vertexTriangleOffsets[i + 1] += vertexTriangleOffsets[i];
+    std::vector<unsigned int> vertexTriangleEnds(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        vertexTriangles[vertexTriangleEnds[indices[i]]++] = (unsigned int)(i / 3);
+
+    // Sum the tangents of each vertex's triangles and make them orthonormal, each vertex being written by a single job.
+    parallelFor(vertexCount, VertexBatchSize, [&](const size_t& first, const size_t& end)
+    {
+        for (size_t i = first; i < end; i++)
+        {
+            Vector3 tangent, bitangent;
+            for (unsigned int j = vertexTriangleOffsets[i]; j < vertexTriangleOffsets[i + 1]; j++) {
+                const unsigned int triangle = vertexTriangles[j];
+                tangent   += Vector3(faces.tx[triangle], faces.ty[triangle], faces.tz[triangle]);
+                bitangent += Vector3(faces.bx[triangle], faces.by[triangle], faces.bz[triangle]);
+            }
+            vertices[i].tangent   = tangent;
+            vertices[i].bitangent = bitangent;
+            Orthonormalize(vertices[i]);
+        }
+    });
+}
+
+// ----- Benchmark ----- //
+
+void TangentSpace::Benchmark(Core::JobSystem& jobSystem)
+{
+    // Grid with wavy positions and uvs, so that the tangents vary.
+    const size_t gridSize = 1024;
+    std::vector<TangentVertex> grid;
+    std::vector<unsigned int>  indices;
+    grid.reserve((gridSize + 1) * (gridSize + 1));
+    for (size_t y = 0; y <= gridSize; y++)
+    {
+        for (size_t x = 0; x <= gridSize; x++)
+        {
+            const float fx = (float)x / gridSize, fy = (float)y / gridSize;
+            grid.push_back(TangentVertex{ Vector3(fx, std::sin(fx * 20) * std::cos(fy * 15) * 0.05f, fy), Vector2(fx * 4 + fy * 0.3f, fy * 4), Vector3(0, 1, 0), Vector3(), Vector3() });
+        }
+    }
+    for (size_t y = 0; y < gridSize; y++)
+    {
+        for (size_t x = 0; x < gridSize; x++)
+        {
+            const unsigned int corner = (unsigned int)(y * (gridSize + 1) + x);
+            indices.insert(indices.end(), { corner, corner + (unsigned int)gridSize + 1, corner + 1, corner + 1, corner + (unsigned int)gridSize + 1, corner + (unsigned int)gridSize + 2 });
+        }
+    }
+    DebugLog("Tangent generation benchmark (" + std::to_string(indices.size() / 3) + " triangles, " + GetSimdName() + ", " + std::to_string(jobSystem.GetThreadCount()) + " workers):");
+
+    // Time each path, and make sure they all give the same tangents.
+    const int iterations = 5;
+    std::vector<TangentVertex> reference;
+    double scalarMs = 0;
+    for (int path = 0; path < 4; path++)
+    {
+        const bool       useSimd  = (path % 2 == 1);
+        Core::JobSystem* workers  = (path >= 2 ? &jobSystem : nullptr);
+        std::vector<TangentVertex> vertices = grid;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            Generate(vertices, indices, workers, useSimd);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        if (path == 0) {
+            scalarMs  = ms;
+            reference = vertices;
+        }
+        const bool identical = (std::memcmp(vertices.data(), reference.data(), vertices.size() * sizeof(TangentVertex)) == 0);
+        DebugLog(std::string(useSimd ? "SIMD" : "Scalar") + (workers != nullptr ? ", all workers: " : ", one thread: ") + std::to_string(ms) + " ms (x" + std::to_string(scalarMs / ms) + ")"
+                 + (identical ? "" : ", different results"));
+    }
+}
@@ -0,0 +1,243 @@
+#define STB_DXT_IMPLEMENTATION
+#include <stb-master/stb_dxt.h>
+#include <STB_Image/stb_image.h>
+#include <glad/glad.h>
+
+#include <mutex>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "Debug.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+using namespace Resources;
+
+
+// Block rows compressed by each job.
+static constexpr size_t BlockRowsPerJob = 8;
+
+// stb_dxt fills its tables on the first compressed block, which must be done before compressing from multiple threads.
+static void InitDxtTables()
+{
+    static std::once_flag initFlag;
+    std::call_once(initFlag, []()
+    {
+        unsigned char pixels[16 * 4] = {}, block[8];
+        stb_compress_dxt_block(block, pixels, 0, STB_DXT_NORMAL);
+    });
+}
+
+// Number of channels given to stb_dxt for each format.
+static int GetWorkingChannels(const TextureCompression& format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC4: return 1;
+    case TextureCompression::BC5: return 2;
+    default:                      return 4;
+    }
+}
+
+TextureCompression TextureCompressor::ChooseFormat(const unsigned char* pixels, const int& width, const int& height, const int& colorChannels, const bool& isNormalMap)
+{
+    if (isNormalMap && colorChannels >= 2)
+        return TextureCompression::BC5;
+    switch (colorChannels)
+    {
+    case 1: return TextureCompression::BC4;
+    case 3: return TextureCompression::BC1;
+    case 2:
+    case 4:
+    {
+        // Grey and alpha textures are expanded to RGBA, the alpha channel is only kept if some pixels aren't opaque.
+        const size_t pixelCount = (size_t)width * height;
+        for (size_t i = 0; i < pixelCount; i++)
+            if (pixels[i * colorChannels + colorChannels - 1] != 255)
+                return TextureCompression::BC3;
+        return TextureCompression::BC1;
+    }
+    default:
+        return TextureCompression::None;
+    }
+}
+
+// Compresses the given range of block rows of a level, blocks on the edges repeat the last row and column of pixels.
+static void CompressBlockRows(const std::vector<unsigned char>& level, const int& width, const int& height, const TextureCompression& format,
+                              unsigned char* blocks, const size_t& firstRow, const size_t& lastRow)
+{
+    const int    channels   = GetWorkingChannels(format);
+    const size_t blockBytes = TextureCompressor::GetBlockBytes(format);
+    const int    blocksX    = (width + 3) / 4;
+    unsigned char texels[16 * 4];
+    for (size_t blockY = firstRow; blockY < lastRow; blockY++)
+    {
+        for (int blockX = 0; blockX < blocksX; blockX++)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                const int py = std::min((int)blockY * 4 + y, height - 1);
+                for (int x = 0; x < 4; x++)
+                {
+                    const int px = std::min(blockX * 4 + x, width - 1);
+                    std::memcpy(texels + (y * 4 + x) * channels, level.data() + ((size_t)py * width + px) * channels, channels);
+                }
+            }
+
+            unsigned char* block = blocks + (blockY * blocksX + blockX) * blockBytes;
+            switch (format)
+            {
+            case TextureCompression::BC1: stb_compress_dxt_block(block, texels, 0, STB_DXT_NORMAL); break;
+            case TextureCompression::BC3: stb_compress_dxt_block(block, texels, 1, STB_DXT_NORMAL); break;
+            case TextureCompression::BC4: stb_compress_bc4_block(block, texels); break;
+            case TextureCompression::BC5: stb_compress_bc5_block(block, texels); break;
+            default: break;
+            }
+        }
+    }
+}
+
+void TextureCompressor::Compress(const std::vector<unsigned char>& levels, const std::vector<size_t>& levelOffsets, const int& width, const int& height, const int& colorChannels,
+                                 const TextureCompression& format, std::vector<unsigned char>& blocks, std::vector<size_t>& blockOffsets, Core::JobSystem* jobSystem)
+{
+    blocks.clear();
+    blockOffsets.clear();
+    if (format == TextureCompression::None || levelOffsets.size() < 2 || width <= 0 || height <= 0)
+        return;
+    InitDxtTables();
+
+    // Reserve the blocks of all levels.
+    const int levelCount = (int)levelOffsets.size() - 1;
+    blockOffsets.resize(levelCount + 1);
+    blockOffsets[0] = 0;
+    for (int i = 0; i < levelCount; i++)
+        blockOffsets[i + 1] = blockOffsets[i] + GetLevelBytes(format, std::max(width >> i, 1), std::max(height >> i, 1));
+    blocks.resize(blockOffsets[levelCount]);
+
+    const int channels = GetWorkingChannels(format);
+    std::vector<unsigned char> level;
+    for (int i = 0; i < levelCount; i++)
+    {
+        // Convert the level to the channels compressed by the format: RGBA for BC1 and BC3 (grey and alpha pixels give a grey color), the first two channels for BC5.
+        const int    levelWidth  = std::max(width  >> i, 1);
+        const int    levelHeight = std::max(height >> i, 1);
+        const size_t pixelCount  = (size_t)levelWidth * levelHeight;
+        const unsigned char* pixels = levels.data() + levelOffsets[i];
+        const bool   greyAlpha   = (colorChannels == 2 && channels == 4);
+        level.resize(pixelCount * channels);
+        for (size_t j = 0; j < pixelCount; j++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                if      (greyAlpha)         level[j * channels + c] = pixels[j * 2 + (c == 3)];
+                else if (c < colorChannels) level[j * channels + c] = pixels[j * colorChannels + c];
+                else if (c == 3)            level[j * channels + c] = 255;
+                else                        level[j * channels + c] = pixels[j * colorChannels + colorChannels - 1];
+            }
+        }
+
+        // Compress the level's block rows.
+        const size_t   blockRows   = (size_t)(levelHeight + 3) / 4;
+        unsigned char* levelBlocks = blocks.data() + blockOffsets[i];
+        if (jobSystem != nullptr && blockRows > BlockRowsPerJob)
+        {
+            const size_t jobCount = (blockRows + BlockRowsPerJob - 1) / BlockRowsPerJob;
+            jobSystem->ParallelFor(0, jobCount, 1, [&](const size_t& job) {
+                CompressBlockRows(level, levelWidth, levelHeight, format, levelBlocks, job * BlockRowsPerJob, std::min((job + 1) * BlockRowsPerJob, blockRows));
+            });
+        }
+        else
+        {
+            CompressBlockRows(level, levelWidth, levelHeight, format, levelBlocks, 0, blockRows);
+        }
+    }
+}
+
+size_t TextureCompressor::GetLevelBytes(const TextureCompression& format, const int& width, const int& height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+size_t TextureCompressor::GetBlockBytes(const TextureCompression& format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1:
+    case TextureCompression::BC4: return 8;
+    case TextureCompression::BC3:
+    case TextureCompression::BC5: return 16;
+    default:                      return 0;
+    }
+}
+
+unsigned int TextureCompressor::GetGlFormat(const TextureCompression& format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureCompression::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureCompression::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case TextureCompression::BC5: return GL_COMPRESSED_RG_RGTC2;
+    default:                      return 0;
+    }
+}
+
+const char* TextureCompressor::GetFormatName(const TextureCompression& format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1: return "BC1";
+    case TextureCompression::BC3: return "BC3";
+    case TextureCompression::BC4: return "BC4";
+    case TextureCompression::BC5: return "BC5";
+    default:                      return "uncompressed";
+    }
+}
+
+void TextureCompressor::Benchmark(const std::vector<std::string>& filenames, Core::JobSystem& jobSystem)
+{
+    DebugLog("Texture compression benchmark (" + std::to_string(filenames.size()) + " file(s), " + std::to_string(jobSystem.GetThreadCount()) + " workers):");
+
+    size_t totalRawBytes = 0, totalCompressedBytes = 0;
+    for (const std::string& filename : filenames)
+    {
+        int width, height, colorChannels;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned char* pixels = stbi_load(filename.c_str(), &width, &height, &colorChannels, 0);
+        const double decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (pixels == nullptr) {
+            DebugLogWarning("Unable to open texture file: " + filename);
+            continue;
+        }
+
+        // Generate the mipmaps, then compress them on one thread and on all workers.
+        start = std::chrono::steady_clock::now();
+        std::vector<unsigned char> levels;
+        std::vector<size_t>        levelOffsets;
+        MipGenerator::Generate(pixels, width, height, colorChannels, TextureUsage::Color, levels, levelOffsets);
+        const double mipMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const TextureCompression format = ChooseFormat(pixels, width, height, colorChannels, false);
+        std::vector<unsigned char> blocks;
+        std::vector<size_t>        blockOffsets;
+        double compressMs[2];
+        for (int path = 0; path < 2; path++)
+        {
+            start = std::chrono::steady_clock::now();
+            Compress(levels, levelOffsets, width, height, colorChannels, format, blocks, blockOffsets, (path == 1 ? &jobSystem : nullptr));
+            compressMs[path] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        stbi_image_free(pixels);
+
+        const size_t rawBytes = levels.size();
+        totalRawBytes        += rawBytes;
+        totalCompressedBytes += blocks.size();
+        DebugLog(filename + " (" + std::to_string(width) + "x" + std::to_string(height) + ", " + GetFormatName(format) + "): decode " + std::to_string(decodeMs) + " ms, "
+                 + "mipmaps " + std::to_string(mipMs) + " ms, compression " + std::to_string(compressMs[0]) + " ms on one thread, " + std::to_string(compressMs[1]) + " ms on all workers, "
+                 + std::to_string(rawBytes >> 10) + " KB -> " + std::to_string(blocks.size() >> 10) + " KB of VRAM and uploads.");
+    }
+    DebugLog("Total: " + std::to_string(totalRawBytes >> 20) + " MB -> " + std::to_string(totalCompressedBytes >> 20) + " MB ("
+             + std::to_string(totalCompressedBytes > 0 ? (double)totalRawBytes / totalCompressedBytes : 0) + "x smaller).");
+}
@@ -6,12 +6,18 @@
 #include <string>
 #include <cstdio>
 #include <functional>
-#include <direct.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 #pragma warning(disable : 4996)
 
 #include "Maths.h"
 #include "Arithmetic.h"
 #include "ResourceManager.h"
+#include "LoadTimeline.h"
+#include "AssetCache.h"
 #include "Textures.h"
 using namespace Core::Maths;
 using namespace Resources;
@@ -20,6 +26,23 @@ using namespace Resources;
 
 // ----- Static Texture ----- //
 
+// Reads the image file for stbi, stopping when the texture's loading is cancelled.
+struct TextureFileReader
+{
+    FILE*          file;
+    const Texture* texture;
+
+    static int Read(void* user, char* data, int size)
+    {
+        TextureFileReader* reader = (TextureFileReader*)user;
+        if (reader->texture->IsLoadingCancelled())
+            return 0;
+        return (int)fread(data, 1, size, reader->file);
+    }
+    static void Skip(void* user, int n) { fseek(((TextureFileReader*)user)->file, n, SEEK_CUR); }
+    static int  Eof (void* user)        { TextureFileReader* reader = (TextureFileReader*)user; return feof(reader->file) || reader->texture->IsLoadingCancelled(); }
+};
+
 // Creates a texture out of the specified image file.
 Texture::Texture(const std::string& _name)
 {
@@ -43,31 +66,101 @@ Texture::Texture(const int& _width, const int& _height)
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
 }
 
+// Header of the cached textures, followed by the pixels or blocks of the mip levels.
+struct TextureCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    int32_t  width, height, colorChannels;
+    uint32_t compression;
+    uint64_t dataSize;
+};
+static_assert(sizeof(TextureCacheHeader) % 8 == 0, "The mip levels of cached textures should stay aligned.");
+
+// Usage of the textures that aren't colors.
+static std::mutex                                    textureUsagesMutex;
+static std::unordered_map<std::string, TextureUsage> textureUsages;
+
+std::atomic_bool Texture::compressionEnabled = true;
+
+void Texture::MarkUsage(const std::string& textureName, const TextureUsage& usage)
+{
+    std::lock_guard<std::mutex> guard(textureUsagesMutex);
+    textureUsages[textureName] = usage;
+}
+
+TextureUsage Texture::GetUsage(const std::string& textureName)
+{
+    std::lock_guard<std::mutex> guard(textureUsagesMutex);
+    std::unordered_map<std::string, TextureUsage>::iterator it = textureUsages.find(textureName);
+    return (it != textureUsages.end() ? it->second : TextureUsage::Color);
+}
+
 void Texture::Load()
 {
     int w, h, nrChannels;
 
-    // Load texture data from binary file.
-    if (FILE* f = fopen(("Binaries/" + std::to_string(std::hash<std::string>{}(name)) + ".bin").c_str(), "rb"))
+    // Load the mip levels from the asset cache, their key changes when the image file is modified.
+    const TextureUsage        usage = GetUsage(name);
+    const Core::AssetCacheKey cacheKey(name, "texture", CacheVersion, (uint64_t)CompressionEnabled() | (uint64_t)usage << 1);
+    if (ReadCache(cacheKey))
     {
-        hashed = true;
-        fread(&w, sizeof(int), 1, f);
-        fread(&h, sizeof(int), 1, f);
-        fread(&nrChannels, sizeof(int), 1, f);
-
-        data = new unsigned char[w * h * nrChannels];
-        fread(data, sizeof(unsigned char), w * h * nrChannels, f);
-        fclose(f);
+        w          = width;
+        h          = height;
+        nrChannels = colorChannels;
     }
 
     // Load texture data with stbi.
-    else
+    else if (FILE* f = fopen(name.c_str(), "rb"))
     {
-        data = stbi_load(name.c_str(), &w, &h, &nrChannels, 0);
+        unsigned char* data = nullptr;
+        {
+            Core::ScopedLoadPhase decodePhase(name, Core::LoadPhase::Decode);
+            TextureFileReader   reader    = { f, this };
+            stbi_io_callbacks   callbacks = { TextureFileReader::Read, TextureFileReader::Skip, TextureFileReader::Eof };
+            data = stbi_load_from_callbacks(&callbacks, &reader, &w, &h, &nrChannels, 0);
+            fclose(f);
+        }
+
+        // Generate the mipmaps, and compress them with the loading job's workers.
+        if (data != nullptr && !IsLoadingCancelled())
+        {
+            Core::ScopedLoadPhase mipPhase(name, Core::LoadPhase::Mipmaps);
+            MipGenerator::Generate(data, w, h, nrChannels, usage, levels, levelOffsets);
+            if (CompressionEnabled())
+            {
+                Core::JobHandle  currentJob = Core::JobSystem::CurrentJob();
+                Core::JobSystem* jobSystem  = (currentJob.IsValid() ? currentJob.GetJob()->system : nullptr);
+                compression = TextureCompressor::ChooseFormat(data, w, h, nrChannels, usage == TextureUsage::NormalMap);
+                std::vector<unsigned char> blocks;
+                std::vector<size_t>        blockOffsets;
+                TextureCompressor::Compress(levels, levelOffsets, w, h, nrChannels, compression, blocks, blockOffsets, jobSystem);
+                if (compression != TextureCompression::None) {
+                    levels      .swap(blocks);
+                    levelOffsets.swap(blockOffsets);
+                }
+            }
+        }
+        stbi_image_free(data);
+
+        // Let the cache writer save the levels for the next loads.
+        if (!levels.empty() && !IsLoadingCancelled()) {
+            width         = w;
+            height        = h;
+            colorChannels = nrChannels;
+            WriteCache(cacheKey);
+        }
+    }
+
+    // Drop the decoded data if the loading was cancelled.
+    if (IsLoadingCancelled())
+    {
+        FreeData();
+        return;
     }
 
     // Check if the data was correctly loaded.
-    if (!data)
+    if (levelOffsets.empty())
     {
         DebugLogWarning("Unable to open texture file: " + name);
         glDeleteTextures(1, &id);
@@ -82,48 +175,266 @@ void Texture::Load()
     SetLoadingDone();
 }
 
+void Texture::ComputeLevelOffsets()
+{
+    const int levelCount = MipGenerator::GetLevelCount(width, height);
+    levelOffsets.resize(levelCount + 1);
+    levelOffsets[0] = 0;
+    for (int i = 0; i < levelCount; i++)
+    {
+        const int levelWidth = std::max(width >> i, 1), levelHeight = std::max(height >> i, 1);
+        levelOffsets[i + 1] = levelOffsets[i] + (compression == TextureCompression::None ? (size_t)levelWidth * levelHeight * colorChannels
+                                                                                         : TextureCompressor::GetLevelBytes(compression, levelWidth, levelHeight));
+    }
+}
+
+const unsigned char* Texture::GetLevelData() const
+{
+    if (cachedLevels != nullptr)
+        return (const unsigned char*)cachedLevels->GetData() + sizeof(TextureCacheHeader);
+    return levels.data();
+}
+
+bool Texture::ReadCache(const Core::AssetCacheKey& cacheKey)
+{
+    Core::ScopedLoadPhase readPhase(name, Core::LoadPhase::Read);
+    std::unique_ptr<Core::CachedAsset> cached = std::make_unique<Core::CachedAsset>();
+    if (!cached->Open(cacheKey))
+        return false;
+
+    // Cached textures written by another version of the header or truncated are ignored, the image is then decoded again.
+    if (cached->GetSize() < sizeof(TextureCacheHeader))
+        return false;
+    const TextureCacheHeader& header = *(const TextureCacheHeader*)cached->GetData();
+    if (std::memcmp(header.magic, "TEXR", 4) != 0 || header.version != CacheVersion
+        || header.width <= 0 || header.height <= 0 || header.colorChannels <= 0 || header.colorChannels > 4
+        || header.compression > (uint32_t)TextureCompression::BC5 || header.dataSize != cached->GetSize() - sizeof(TextureCacheHeader))
+        return false;
+    width         = header.width;
+    height        = header.height;
+    colorChannels = header.colorChannels;
+    compression   = (TextureCompression)header.compression;
+    ComputeLevelOffsets();
+    if (header.dataSize != levelOffsets.back()) {
+        levelOffsets.clear();
+        compression = TextureCompression::None;
+        return false;
+    }
+
+    // The levels are read from the mapped file when they are uploaded.
+    cachedLevels = std::move(cached);
+    return true;
+}
+
+void Texture::WriteCache(const Core::AssetCacheKey& cacheKey) const
+{
+    TextureCacheHeader header;
+    std::memcpy(header.magic, "TEXR", 4);
+    header.version       = CacheVersion;
+    header.width         = width;
+    header.height        = height;
+    header.colorChannels = colorChannels;
+    header.compression   = (uint32_t)compression;
+    header.dataSize      = levels.size();
+
+    std::vector<char> data(sizeof(header) + levels.size());
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + sizeof(header), levels.data(), levels.size());
+    Core::AssetCache::Write(cacheKey, std::move(data));
+}
+
 void Texture::SendToOpenGL()
 {
     if (!IsLoaded() || WasSentToOpenGL())
         return;
 
-    // Create OpenGL texture from data.
-    DebugLog("Sending texture to openGL: " + name);
+    // Let the upload thread create and fill the texture if there is one.
+    GpuUploader* uploader = ResourceManager::GetGpuUploader();
+    if (uploader != nullptr && !uploadSubmitted)
+    {
+        DebugLog("Sending texture to openGL: " + name);
+        uploadSubmitted = true;
+        upload = uploader->Submit([this]()
+        {
+            Core::ScopedLoadPhase uploadPhase(name, Core::LoadPhase::Upload);
+            if (!CreateStorage())
+                return;
+            UploadLevels(nullptr);
+            FinishUpload();
+        });
+        return;
+    }
+    if (upload != nullptr)
+    {
+        if (!GpuUploader::IsReady(upload))
+            return;
+        upload = nullptr;
+
+        // The data is only left if the upload thread was stopped before uploading it, then upload it from here.
+        if (levelOffsets.empty()) {
+            SetOpenGLTransferDone();
+            return;
+        }
+    }
+
+    // Create the OpenGL texture and its storage for all mip levels.
+    if (id == 0) {
+        if (!uploadSubmitted)
+            DebugLog("Sending texture to openGL: " + name);
+        if (!CreateStorage())
+            return;
+    }
+
+    // Upload the rows that fit in this frame's budget, the rest will be uploaded in the next frames.
+    if (!UploadLevels(ResourceManager::GetUploadStreamer()))
+        return;
+    FinishUpload();
+    SetOpenGLTransferDone();
+}
+
+size_t Texture::GetCpuBytes() const
+{
+    // The levels are freed once they are uploaded, cached levels are mapped from their file.
+    if (!IsLoaded() || WasSentToOpenGL() || levelOffsets.empty())
+        return 0;
+    return levelOffsets.back();
+}
+
+size_t Texture::GetGpuBytes() const
+{
+    if (!WasSentToOpenGL())
+        return 0;
+    return gpuBytes;
+}
+
+size_t Texture::GetUncompressedGpuBytes() const
+{
+    // Mipmaps add a third to the size of the texture.
+    if (!WasSentToOpenGL())
+        return 0;
+    return (size_t)width * height * std::clamp(colorChannels, 1, 4) * 4 / 3;
+}
+
+bool Texture::CreateStorage()
+{
+    // Create the OpenGL texture and its storage for all mip levels.
     glGenTextures(1, &id);
     if (id == 0) {
         DebugLogWarning("Unable to generate an OpenGL texture ID.");
-        return;
+        return false;
     }
+    const GLenum internalFormats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    const GLenum internalFormat     = (compression != TextureCompression::None ? TextureCompressor::GetGlFormat(compression) : internalFormats[std::clamp(colorChannels, 1, 4) - 1]);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, (colorChannels == 3 ? GL_RGB : GL_RGBA), width, height, 0, (colorChannels == 3 ? GL_RGB : GL_RGBA), GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)levelOffsets.size() - 1, internalFormat, width, height);
 
-    // Save texture data to hashed binary file.
-    if (!hashed)
-    {
-        _mkdir("Binaries");
-        FILE* f = fopen(("Binaries/" + std::to_string(std::hash<std::string>{}(name)) + ".bin").c_str(), "wb");
-        if (f != nullptr) {
-            fwrite(&width, sizeof(int), 1, f);
-            fwrite(&height, sizeof(int), 1, f);
-            fwrite(&colorChannels, sizeof(int), 1, f);
-            fwrite(data, sizeof(unsigned char), width * height * colorChannels, f);
-            fclose(f);
-        }
-        stbi_image_free(data);
+    // Grey textures are stored in the red channel, and uncompressed grey and alpha textures in the red and green channels (compressed ones are expanded to RGBA).
+    if (colorChannels == 1) {
+        const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
     }
+    else if (colorChannels == 2 && compression == TextureCompression::None && GetUsage(name) != TextureUsage::NormalMap) {
+        const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    gpuBytes      = levelOffsets.back();
+    uploadedRows  = 0;
+    uploadedLevel = 0;
+    return true;
+}
+
+bool Texture::UploadLevels(UploadStreamer* streamer)
+{
+    // Compressed levels are uploaded by rows of 4x4 blocks.
+    const bool   compressed  = (compression != TextureCompression::None);
+    const GLenum formats[4]  = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    const GLenum format      = (compressed ? TextureCompressor::GetGlFormat(compression) : formats[std::clamp(colorChannels, 1, 4) - 1]);
+    const int    rowHeight   = (compressed ? 4 : 1);
+    const int    levelCount  = (int)levelOffsets.size() - 1;
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, (streamer != nullptr ? streamer->GetBufferId() : 0));
+
+    // Uploads the given rows of the current level from the given data or staging buffer offset.
+    auto uploadRows = [&](const int& levelWidth, const int& levelHeight, const int& firstRow, const int& rowCount, const size_t& rowSize, const void* rowData)
+    {
+        const int firstY = firstRow * rowHeight, rowsHeight = std::min(rowCount * rowHeight, levelHeight - firstY);
+        if (compressed) glCompressedTexSubImage2D(GL_TEXTURE_2D, uploadedLevel, 0, firstY, levelWidth, rowsHeight, format, (GLsizei)(rowCount * rowSize), rowData);
+        else            glTexSubImage2D          (GL_TEXTURE_2D, uploadedLevel, 0, firstY, levelWidth, rowsHeight, format, GL_UNSIGNED_BYTE, rowData);
+    };
 
-    // Simply free texture data.
-    else
+    bool done = true;
+    for (; uploadedLevel < levelCount; uploadedLevel++, uploadedRows = 0)
     {
-        delete[] data;
+        const int    levelWidth  = std::max(width  >> uploadedLevel, 1);
+        const int    levelHeight = std::max(height >> uploadedLevel, 1);
+        const int    rowCount    = (levelHeight + rowHeight - 1) / rowHeight;
+        const size_t rowSize     = (levelOffsets[uploadedLevel + 1] - levelOffsets[uploadedLevel]) / rowCount;
+        const unsigned char* levelData = GetLevelData() + levelOffsets[uploadedLevel];
+
+        // Upload each level at once without a streamer.
+        if (streamer == nullptr) {
+            uploadRows(levelWidth, levelHeight, 0, rowCount, rowSize, levelData);
+            continue;
+        }
+
+        // Otherwise, copy rows to the staging buffer and upload them from there.
+        while (uploadedRows < rowCount)
+        {
+            const int stagedRowCount = std::min(rowCount - uploadedRows, (int)(streamer->GetAvailableBytes() / rowSize));
+            if (stagedRowCount <= 0)
+                break;
+            const size_t offset = streamer->Stage(levelData + uploadedRows * rowSize, stagedRowCount * rowSize);
+            uploadRows(levelWidth, levelHeight, uploadedRows, stagedRowCount, rowSize, (void*)offset);
+            uploadedRows += stagedRowCount;
+        }
+        if (uploadedRows < rowCount) {
+            done = false;
+            break;
+        }
     }
-    SetOpenGLTransferDone();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return done;
+}
+
+void Texture::FinishUpload()
+{
+    FreeData();
+}
+
+void Texture::SwapData(Texture& reloaded)
+{
+    std::swap(id,            reloaded.id);
+    std::swap(width,         reloaded.width);
+    std::swap(height,        reloaded.height);
+    std::swap(colorChannels, reloaded.colorChannels);
+    std::swap(compression,   reloaded.compression);
+    std::swap(gpuBytes,      reloaded.gpuBytes);
 }
 
 Texture::~Texture()
 {
-    glDeleteTextures(1, &id);
+    DeleteOpenGLObjects();
+    FreeData();
+}
+
+void Texture::DeleteOpenGLObjects()
+{
+    // Wait for the upload thread to be done with the texture.
+    if (upload != nullptr && ResourceManager::GetGpuUploader() != nullptr)
+        ResourceManager::GetGpuUploader()->Release(upload);
+
+    // Textures that were never sent to OpenGL can be deleted by threads without an OpenGL context.
+    if (id != 0) glDeleteTextures(1, &id);
+    id = 0;
+}
+
+void Texture::FreeData()
+{
+    std::vector<unsigned char>().swap(levels);
+    cachedLevels.reset();
+    levelOffsets.clear();
 }
 
 
@@ -137,19 +448,28 @@ DynamicTexture::DynamicTexture(const std::string& _name)
     type = ResourceTypes::DynamicTexture;
 }
 
+std::mutex                   DynamicTexture::updatedTexturesMutex;
+std::vector<DynamicTexture*> DynamicTexture::updatedTextures;
+
 DynamicTexture::~DynamicTexture()
 {
+    {
+        std::lock_guard<std::mutex> lock(updatedTexturesMutex);
+        updatedTextures.erase(std::remove(updatedTextures.begin(), updatedTextures.end(), this), updatedTextures.end());
+    }
+    rebuildJob.Wait();
     glDeleteTextures(1, &id);
-    stbi_image_free(data);
 }
 
 void DynamicTexture::Load()
 {
     int w, h, nrChannels;
 
-    // Load texture.
-    data = stbi_load(name.c_str(), &w, &h, &nrChannels, 0);
+    // Load texture and generate its mipmaps.
+    unsigned char* data = stbi_load(name.c_str(), &w, &h, &nrChannels, 0);
     Assert(data != NULL, "Unable to open texture: " + name);
+    MipGenerator::Generate(data, w, h, nrChannels, TextureUsage::Color, levels, levelOffsets);
+    stbi_image_free(data);
 
     // Save image parameters.
     width = w;
@@ -165,20 +485,30 @@ void DynamicTexture::SendToOpenGL()
 
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, (colorChannels == 3 ? GL_RGB : GL_RGBA), width, height, 0, (colorChannels == 3 ? GL_RGB : GL_RGBA), GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexStorage2D(GL_TEXTURE_2D, (GLsizei)levelOffsets.size() - 1, (colorChannels == 3 ? GL_RGB8 : GL_RGBA8), width, height);
+    UploadLevels();
     SetOpenGLTransferDone();
 }
 
+void DynamicTexture::UploadLevels()
+{
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t i = 0; i + 1 < levelOffsets.size(); i++)
+        glTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, std::max(width >> i, 1), std::max(height >> i, 1), (colorChannels == 3 ? GL_RGB : GL_RGBA), GL_UNSIGNED_BYTE, levels.data() + levelOffsets[i]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
 RGBA DynamicTexture::GetPixel(const int& x, const int& y)
 {
+    const unsigned char* data = levels.data();
     int index = (y * width + x) * colorChannels;
     return RGBA(data[index] / 255.f, data[index + 1] / 255.f, data[index + 2] / 255.f, (colorChannels == 3 ? 255 : data[index + 3]) / 255.f);
 }
 
 void DynamicTexture::SetPixel(const int& x, const int& y, const RGBA& color, bool updateTexture)
 {
-    unsigned char* pixelOffset = data + ((height - y) * width + x) * colorChannels;
+    unsigned char* pixelOffset = levels.data() + ((height - y) * width + x) * colorChannels;
     pixelOffset[0] = (unsigned int)(color.r * 255);
     pixelOffset[1] = (unsigned int)(color.g * 255);
     pixelOffset[2] = (unsigned int)(color.b * 255);
@@ -190,8 +520,56 @@ void DynamicTexture::SetPixel(const int& x, const int& y, const RGBA& color, boo
 
 void DynamicTexture::UpdateTexture()
 {
-    glDeleteTextures(1, &id);
-    SendToOpenGL();
+    std::lock_guard<std::mutex> lock(updatedTexturesMutex);
+    if (!dirty && !rebuilding)
+        updatedTextures.push_back(this);
+    dirty = true;
+}
+
+void DynamicTexture::UpdateTextures()
+{
+    std::lock_guard<std::mutex> lock(updatedTexturesMutex);
+    for (size_t i = 0; i < updatedTextures.size();)
+    {
+        DynamicTexture* texture = updatedTextures[i];
+
+        // Upload the rebuilt mipmaps with the current pixels, which may have been updated again since the rebuild started.
+        if (texture->rebuilding && texture->rebuildJob.IsDone())
+        {
+            texture->rebuilding = false;
+            texture->rebuildJob = Core::JobHandle();
+            std::copy(texture->rebuiltLevels.begin() + texture->rebuiltLevelOffsets[1], texture->rebuiltLevels.end(), texture->levels.begin() + texture->levelOffsets[1]);
+            if (texture->id == 0)
+                texture->SendToOpenGL();
+            else
+                texture->UploadLevels();
+        }
+
+        // Generate the mipmaps of a copy of the updated pixels on a worker, so the render thread never filters them.
+        if (texture->dirty && !texture->rebuilding)
+        {
+            texture->dirty      = false;
+            texture->rebuilding = true;
+            texture->rebuiltLevels.assign(texture->levels.begin(), texture->levels.begin() + texture->levelOffsets[1]);
+            auto rebuild = [texture]()
+            {
+                const std::vector<unsigned char> pixels = std::move(texture->rebuiltLevels);
+                MipGenerator::Generate(pixels.data(), texture->width, texture->height, texture->colorChannels, TextureUsage::Color, texture->rebuiltLevels, texture->rebuiltLevelOffsets);
+            };
+            if (Core::JobSystem* jobSystem = Core::JobSystem::Get())
+                texture->rebuildJob = jobSystem->Schedule(rebuild);
+            else
+                rebuild();
+        }
+
+        if (!texture->dirty && !texture->rebuilding) {
+            updatedTextures[i] = updatedTextures.back();
+            updatedTextures.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
 }
 
 
@@ -279,7 +657,7 @@ void RenderTexture::SetWidth(const int& _width )
         glDeleteRenderbuffers(1, &rbo);
         glDeleteTextures(1, &id);
         glDeleteFramebuffers(1, &fbo);
-        sentToOpenGL = false;
+        ResetOpenGLTransfer();
         SendToOpenGL();
     }
 }
@@ -292,7 +670,7 @@ void RenderTexture::SetHeight(const int& _height)
         glDeleteRenderbuffers(1, &rbo);
         glDeleteTextures(1, &id);
         glDeleteFramebuffers(1, &fbo);
-        sentToOpenGL = false;
+        ResetOpenGLTransfer();
         SendToOpenGL();
     }
 }
@@ -306,7 +684,7 @@ void RenderTexture::SetSize(const int& _width, const int& _height)
         glDeleteRenderbuffers(1, &rbo);
         glDeleteTextures(1, &id);
         glDeleteFramebuffers(1, &fbo);
-        sentToOpenGL = false;
+        ResetOpenGLTransfer();
         SendToOpenGL();
     }
 }
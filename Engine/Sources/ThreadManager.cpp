@@ -1,54 +1,65 @@
 #include "ThreadManager.h"
+#include "LoadTimeline.h"
 #include "App.h"
 using namespace Resources;
 using namespace Core;
 
 
 Core::ThreadManager::ThreadManager(const int& maxThread)
+	: jobSystem(maxThread)
 {
-	LaunchThreads(maxThread);
 }
 
 ThreadManager::~ThreadManager()
 {
-	stopThreads.store(true);
-	for (std::thread& t : threads)
-		t.join();
-	threads.clear();
+	Stop();
 }
 
-void ThreadManager::LaunchThreads(int maxthread)
+void ThreadManager::Stop()
 {
-	for (int i = 0; i < maxthread; i++)
+	jobSystem.Stop();
+}
+
+JobHandle ThreadManager::AddTask(IResource* resource)
+{
+	// Don't load a resource twice at the same time.
+	JobHandle current = resource->GetLoadingJob();
+	if (current.IsValid() && !current.IsDone())
+		return current;
+
+	// Resources created while loading another one (materials and textures of an obj file for example) are its children,
+	// so the parent's loading job is only done once all of its dependencies are loaded.
+	JobHandle parent = JobSystem::CurrentJob();
+	if (parent.IsValid() && parent.GetJob()->system != &jobSystem)
+		parent = JobHandle();
+
+	const LoadTimeline::Clock::time_point queueTime = LoadTimeline::Clock::now();
+	JobHandle job = jobSystem.Schedule([resource, queueTime]()
 	{
-		std::thread b  { &ThreadManager::Life, this};
-		threads.push_back(std::move(b));
-	}
+		if (!resource->IsLoaded() && !resource->IsLoadingCancelled())
+		{
+			LoadTimeline::Record(resource->GetName(), LoadPhase::Queued, queueTime, LoadTimeline::Clock::now());
+			ScopedLoadPhase loadPhase(resource->GetName(), LoadPhase::Load);
+			resource->Load();
+		}
+	}, JobPriority::Background, parent);
+	resource->SetLoadingJob(job);
+	return job;
 }
 
-void ThreadManager::AddTask(IResource* resource)
+void ThreadManager::CancelTask(IResource* resource)
 {
-	while (lock.test_and_set()) {}
-	tasks.push_back(resource);
-	lock.clear();
+	resource->CancelLoading();
+	jobSystem.Cancel(resource->GetLoadingJob());
 }
 
-void ThreadManager::Life()
+void ThreadManager::WaitForTask(IResource* resource)
 {
-	while (!stopThreads)
+	// The loading job can be replaced while it runs (by a continuation for example), so check it again once it is done.
+	JobHandle job = resource->GetLoadingJob();
+	while (!job.IsDone())
 	{
-		while (lock.test_and_set()) {}
-		if(tasks.size() > 0)
-		{
-			IResource* resource = tasks[0];
-			tasks.erase(tasks.begin());
-			lock.clear();
-			if (resource != nullptr && !resource->IsLoaded())
-				resource->Load();
-		}
-		else
-		{
-			lock.clear();
-		}
+		jobSystem.Wait(job);
+		job = resource->GetLoadingJob();
 	}
 }
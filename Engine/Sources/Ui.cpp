@@ -9,13 +9,16 @@
 #include "App.h"
 #include "Ui.h"
 #include "KeyBindings.h"
+#include "LoadTimeline.h"
+#include "AssetCache.h"
+#include "TangentSpace.h"
 using namespace Core;
 using namespace Core::Maths;
 using namespace Resources;
 using namespace Scenes;
 
 ImVec2 Ui::windowPositions [8] = { { 460,  90  }, { 0,   0   }, { 1550, 0    }, { 1180, 0    }, { 390, 0 }, { 0,    850 }, { 215, 0   }, { 915, 0  } };
-ImVec2 Ui::windowSizes     [8] = { { 1000, 900 }, { 215, 850 }, { 370,  1080 }, { 370,  1080 }, { 0,   0 }, { 1180, 230 }, { 175, 300 }, { 101, 58 } };
+ImVec2 Ui::windowSizes     [8] = { { 1000, 900 }, { 215, 850 }, { 370,  1080 }, { 370,  1080 }, { 0,   0 }, { 1180, 230 }, { 175, 550 }, { 101, 58 } };
 bool   Ui::windowsCollapsed[8] = { false, false, false, false, false, false, false };
 int    Ui::windowWidth         = 1920;
 int    Ui::windowHeight        = 1080;
@@ -217,8 +220,8 @@ void Ui::ShowMaterialUi(Material* material)
     ImGui::DragFloat("Transparency", &material->transparency, 0.01f, 0, 1);
     ImGui::PopItemWidth();
 
-    Texture**   materialTextures[]     = { &material->ambientTexture, &material->diffuseTexture, &material->specularTexture, &material->emissionTexture, &material->shininessMap, &material->alphaMap, &material->normalMap };
-    const char* materialTextureNames[] = { "Ambient texture", "Diffuse texture", "Specular texture", "Emission texture", "Shininess map", "Alpha map", "Normal map" };
+    ResourceRef<Texture>* materialTextures[] = { &material->ambientTexture, &material->diffuseTexture, &material->specularTexture, &material->emissionTexture, &material->shininessMap, &material->alphaMap, &material->normalMap };
+    const char*           materialTextureNames[] = { "Ambient texture", "Diffuse texture", "Specular texture", "Emission texture", "Shininess map", "Alpha map", "Normal map" };
     for (int i = 0; i < 7; i++)
     {
         // Add texture button.
@@ -243,7 +246,7 @@ void Ui::ShowMaterialUi(Material* material)
                     // Enable dropping textures onto materials.
                     if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("ResourceTexture"))
                     {
-                        Assert(payload->DataSize == sizeof(materialTextures[i]), "Texture drag/drop payload of wrong size.");
+                        Assert(payload->DataSize == sizeof(Texture*), "Texture drag/drop payload of wrong size.");
                         Texture* droppedNode = *(Texture**)payload->Data;
                         *materialTextures[i] = droppedNode;
                     }
@@ -303,6 +306,83 @@ void Ui::ShowRemoveNodeUi(SceneNode*& node)
     }
 }
 
+void Ui::ShowLoadTimelineUi()
+{
+    const std::vector<LoadEvent>   events      = LoadTimeline::GetEvents();
+    const std::vector<std::string> threadNames = LoadTimeline::GetThreadNames();
+    if (events.empty()) {
+        ImGui::TextWrapped("No resource was loaded yet.");
+        return;
+    }
+
+    // Export button.
+    if (ImGui::Button("Export Chrome trace"))
+    {
+        if (LoadTimeline::ExportChromeTrace("LoadingTrace.json"))
+            DebugLog("Loading timeline exported to LoadingTrace.json (open it in chrome://tracing or Perfetto).");
+        else
+            DebugLogWarning("Unable to export the loading timeline.");
+    }
+
+    // Phase colors.
+    static const ImU32 phaseColors[(int)LoadPhase::Count] = {
+        IM_COL32(110, 110, 110, 255), IM_COL32( 60, 100, 170, 255), IM_COL32(220, 160,  40, 255),
+        IM_COL32( 60, 180,  90, 255), IM_COL32(190,  80, 180, 255), IM_COL32( 60, 190, 200, 255),
+        IM_COL32(220,  70,  60, 255),
+    };
+    for (int i = 0; i < (int)LoadPhase::Count; i++)
+    {
+        if (i > 0) ImGui::SameLine();
+        ImGui::TextColored(ImColor(phaseColors[i]), "%s", LoadTimeline::GetPhaseName((LoadPhase)i));
+    }
+
+    // Time range of the timeline.
+    long long startNs = events[0].startNs, endNs = events[0].endNs;
+    for (const LoadEvent& event : events) {
+        startNs = std::min(startNs, event.startNs);
+        endNs   = std::max(endNs,   event.endNs);
+    }
+    ImGui::Text("Duration: %.1f ms", (endNs - startNs) * 1e-6);
+
+    // One row per thread, with the phases done during a load drawn inside of it.
+    const float   rowHeight  = 16, labelWidth = 90;
+    const float   width      = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 50.f);
+    const double  nsToPixels = width / (double)std::max(endNs - startNs, 1LL);
+    const ImVec2  origin     = ImGui::GetCursorScreenPos();
+    const ImVec2  mousePos   = ImGui::GetIO().MousePos;
+    ImDrawList*   drawList   = ImGui::GetWindowDrawList();
+    for (size_t i = 0; i < threadNames.size(); i++)
+        drawList->AddText({ origin.x, origin.y + i * rowHeight }, IM_COL32_WHITE, threadNames[i].c_str());
+
+    const LoadEvent* hoveredEvent = nullptr;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (const LoadEvent& event : events)
+        {
+            const bool isOuterPhase = (event.phase == LoadPhase::Load || event.phase == LoadPhase::Queued);
+            if (isOuterPhase != (pass == 0))
+                continue;
+
+            const float inset = (isOuterPhase ? 1.f : 4.f);
+            const ImVec2 min = { origin.x + labelWidth + (float)((event.startNs - startNs) * nsToPixels), origin.y + event.threadIndex * rowHeight + inset };
+            const ImVec2 max = { std::max(min.x + 1, origin.x + labelWidth + (float)((event.endNs - startNs) * nsToPixels)), origin.y + (event.threadIndex + 1) * rowHeight - inset };
+            drawList->AddRectFilled(min, max, phaseColors[(int)event.phase]);
+            if (mousePos.x >= min.x && mousePos.x <= max.x && mousePos.y >= min.y && mousePos.y <= max.y)
+                hoveredEvent = &event;
+        }
+    }
+    ImGui::Dummy({ labelWidth + width, threadNames.size() * rowHeight });
+
+    // Show the hovered phase in a tooltip.
+    if (hoveredEvent != nullptr && ImGui::IsWindowHovered())
+    {
+        ImGui::BeginTooltip();
+        ImGui::Text("%s", hoveredEvent->resource.c_str());
+        ImGui::Text("%s: %.2f ms (at %.1f ms)", LoadTimeline::GetPhaseName(hoveredEvent->phase), (hoveredEvent->endNs - hoveredEvent->startNs) * 1e-6, (hoveredEvent->startNs - startNs) * 1e-6);
+        ImGui::EndTooltip();
+    }
+}
+
 void Ui::ShowStartMenu()
 {
     bool windowOpen = ImGui::Begin("Start Menu", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize);
@@ -589,8 +669,13 @@ void Ui::ShowResourcesWindow()
         // Primitive.
         if (ImGui::CollapsingHeader("Primitives"))
         {
-            Material*       defaultMat   = app->resourceManager.Get<Material>("DefaultMat");             // TODO: Temporary (should be done automatically).
-            ShaderProgram* shaderProgram = app->resourceManager.Get<ShaderProgram>("MeshShaderProgram"); // TODO: Temporary (should be done automatically).
+            // The handles are only looked up by name again when their resource was deleted.
+            static ResourceHandle<Material>      defaultMatHandle;
+            static ResourceHandle<ShaderProgram> shaderProgramHandle;
+            if (!defaultMatHandle   .IsValid()) defaultMatHandle    = app->resourceManager.Get<Material>("DefaultMat");             // TODO: Temporary (should be done automatically).
+            if (!shaderProgramHandle.IsValid()) shaderProgramHandle = app->resourceManager.Get<ShaderProgram>("MeshShaderProgram"); // TODO: Temporary (should be done automatically).
+            Material*      defaultMat    = defaultMatHandle;
+            ShaderProgram* shaderProgram = shaderProgramHandle;
 
             ImGui::Indent(3);
 
@@ -613,6 +698,28 @@ void Ui::ShowResourcesWindow()
         // Meshes.
         if (ImGui::CollapsingHeader("Meshes"))
         {
+            // Vertices and buffer sizes of the uploaded sub-meshes, with and without welding and compression.
+            size_t vertexCount = 0, unweldedVertexCount = 0, gpuBytes = 0, uncompressedGpuBytes = 0, unweldedGpuBytes = 0, cpuBytes = 0;
+            for (resource = resources.begin(); resource != resources.end(); resource++)
+            {
+                if (resource->second->GetType() != ResourceTypes::Mesh)
+                    continue;
+                for (const SubMesh* subMesh : ((Mesh*)resource->second)->subMeshes)
+                {
+                    if (!subMesh->WasSentToOpenGL())
+                        continue;
+                    vertexCount          += subMesh->GetVertexCount();
+                    unweldedVertexCount  += subMesh->GetUnweldedVertexCount();
+                    gpuBytes             += subMesh->GetGpuBytes();
+                    uncompressedGpuBytes += subMesh->GetUncompressedGpuBytes();
+                    unweldedGpuBytes     += subMesh->GetUnweldedGpuBytes();
+                    cpuBytes             += subMesh->GetCpuBytes();
+                }
+            }
+            ImGui::TextWrapped(("Welded vertices: " + std::to_string(vertexCount) + " (from " + std::to_string(unweldedVertexCount) + ")").c_str());
+            ImGui::TextWrapped(("Mesh buffers: " + std::to_string(gpuBytes >> 10) + " KB (" + std::to_string(uncompressedGpuBytes >> 10) + " KB uncompressed, " + std::to_string(unweldedGpuBytes >> 10) + " KB unwelded)").c_str());
+            ImGui::TextWrapped(("Resident CPU geometry: " + std::to_string(cpuBytes >> 10) + " KB").c_str());
+
             for (resource = resources.begin(); resource != resources.end(); resource++)
             {
                 // Skip resources that are not mesh groups.
@@ -632,7 +739,15 @@ void Ui::ShowResourcesWindow()
                     for (SubMesh* subMesh : ((Mesh*)resource->second)->subMeshes)
                     {
                         ImGui::Bullet();
-                        ImGui::TextWrapped((subMesh->GetName() + " (" + std::to_string(subMesh->GetVertexCount()) + " vertices)").c_str());
+                        ImGui::TextWrapped((subMesh->GetName() + " (" + std::to_string(subMesh->GetVertexCount()) + " vertices, " + std::to_string(subMesh->GetUnweldedVertexCount()) + " before welding" + (subMesh->IsCompact() ? ", compact" : "") + ")").c_str());
+                        ImGui::Indent(10);
+                        ImGui::TextWrapped("ACMR %.2f -> %.2f, ATVR %.2f -> %.2f", subMesh->GetCacheStatsBefore().acmr, subMesh->GetCacheStatsAfter().acmr,
+                                                                                   subMesh->GetCacheStatsBefore().atvr, subMesh->GetCacheStatsAfter().atvr);
+                        std::string lodTriangles = "LOD triangles:";
+                        for (unsigned int i = 0; i < subMesh->GetLodCount(); i++)
+                            lodTriangles += " " + std::to_string(subMesh->GetLod(i).indexCount / 3);
+                        ImGui::TextWrapped(lodTriangles.c_str());
+                        ImGui::Unindent(10);
                     }
                     ImGui::Unindent(5);
                     ImGui::TreePop();
@@ -694,9 +809,23 @@ void Ui::ShowResourcesWindow()
             }
         }
 
+        // Loading phases of the resources on each thread.
+        if (ImGui::CollapsingHeader("Loading timeline"))
+            ShowLoadTimelineUi();
+
         // Textures.
         if (ImGui::CollapsingHeader("Textures"))
         {
+            // VRAM of the uploaded textures, with and without block compression.
+            size_t gpuBytes = 0, uncompressedGpuBytes = 0;
+            for (resource = resources.begin(); resource != resources.end(); resource++) {
+                if (resource->second->GetType() != ResourceTypes::Texture)
+                    continue;
+                gpuBytes             += ((Texture*)resource->second)->GetGpuBytes();
+                uncompressedGpuBytes += ((Texture*)resource->second)->GetUncompressedGpuBytes();
+            }
+            ImGui::TextWrapped(("Texture memory: " + std::to_string(gpuBytes >> 10) + " KB (" + std::to_string(uncompressedGpuBytes >> 10) + " KB uncompressed)").c_str());
+
             int i = 0;
             for (resource = resources.begin(); resource != resources.end(); resource++)
             {
@@ -725,6 +854,8 @@ void Ui::ShowResourcesWindow()
                 {
                     ImGui::BeginTooltip();
                     ImGui::Text(resource->first.c_str());
+                    if (resource->second->GetType() == ResourceTypes::Texture)
+                        ImGui::Text(TextureCompressor::GetFormatName(((Texture*)resource->second)->GetCompression()));
                     ImGui::EndTooltip();
                 }
                 i++;
@@ -875,6 +1006,54 @@ void Ui::ShowStatsWindow()
         // Vertex count.
         ImGui::TextWrapped(("Vertex count: " + std::to_string(app->sceneGraph.totalVertexCount)).c_str());
 
+        // Loading threads activity.
+        ThreadManager& threadManager = app->resourceManager.threadManager;
+        ImGui::TextWrapped(("Load queue: " + std::to_string(threadManager.GetQueuedTaskCount())).c_str());
+        ImGui::TextWrapped(("Busy workers: " + std::to_string(threadManager.GetBusyWorkerCount()) + "/" + std::to_string(threadManager.GetThreadCount())).c_str());
+        ImGui::TextWrapped("Worker usage: %d%%", (int)(threadManager.SampleUtilization() * 100));
+
+        // GPU upload streaming.
+        if (UploadStreamer* streamer = ResourceManager::GetUploadStreamer())
+        {
+            ImGui::TextWrapped(("Uploads: " + std::to_string((int)streamer->GetThroughput()) + " MB/s").c_str());
+            ImGui::TextWrapped(("Upload hitches: " + std::to_string(streamer->GetHitchCount())).c_str());
+            if (GpuUploader* uploader = ResourceManager::GetGpuUploader())
+                ImGui::TextWrapped(("Upload thread queue: " + std::to_string(uploader->GetQueuedTaskCount())).c_str());
+
+            int byteBudget = (int)(streamer->GetByteBudget() >> 20);
+            ImGui::AlignTextToFramePadding(); ImGui::Text("MB/frame:"); ImGui::SameLine();
+            ImGui::SetNextItemWidth(55);
+            if (ImGui::DragInt("##uploadByteBudget", &byteBudget, 0.1f, 1, (int)(streamer->GetSegmentSize() >> 20)))
+                streamer->SetByteBudget((size_t)std::max(byteBudget, 1) << 20);
+
+            float timeBudget = streamer->GetTimeBudget();
+            ImGui::AlignTextToFramePadding(); ImGui::Text("ms/frame:"); ImGui::SameLine();
+            ImGui::SetNextItemWidth(55);
+            if (ImGui::DragFloat("##uploadTimeBudget", &timeBudget, 0.05f, 0.5f, 16.f, "%.1f"))
+                streamer->SetTimeBudget(std::max(timeBudget, 0.5f));
+        }
+
+        // Resource memory and eviction.
+        ResourceManager& resourceManager = app->resourceManager;
+        ImGui::TextWrapped(("Resource memory: " + std::to_string(resourceManager.GetUsedMemory() >> 20) + " MB").c_str());
+        ImGui::TextWrapped(("Evicted resources: " + std::to_string(resourceManager.GetEvictedCount())).c_str());
+        int memoryBudget = (int)(resourceManager.GetMemoryBudget() >> 20);
+        ImGui::AlignTextToFramePadding(); ImGui::Text("Budget MB:"); ImGui::SameLine();
+        ImGui::SetNextItemWidth(55);
+        if (ImGui::DragInt("##memoryBudget", &memoryBudget, 1.f, 0, 65536))
+            resourceManager.SetMemoryBudget((size_t)std::max(memoryBudget, 0) << 20);
+
+        // Asset cache size and cap, the least recently used entries are removed above it.
+        ImGui::TextWrapped(("Asset cache: " + std::to_string(AssetCache::GetTotalBytes() >> 20) + " MB (" + std::to_string(AssetCache::GetEntryCount()) + " entries)").c_str());
+        int cacheSizeCap = (int)(AssetCache::GetSizeCap() >> 20);
+        ImGui::AlignTextToFramePadding(); ImGui::Text("Cache cap MB:"); ImGui::SameLine();
+        ImGui::SetNextItemWidth(55);
+        if (ImGui::DragInt("##cacheSizeCap", &cacheSizeCap, 4.f, 16, 65536))
+            AssetCache::SetSizeCap((uint64_t)std::max(cacheSizeCap, 16) << 20);
+        ImGui::SameLine();
+        if (ImGui::Button("Clear cache"))
+            AssetCache::Clear();
+
         // Engine camera speed.
         std::string cameraSpeed = std::to_string((int)(app->cameraManager.engineCamera->moveSpeed * 20));
         ImGui::TextWrapped(("Camera speed: " + cameraSpeed).c_str());
@@ -899,6 +1078,51 @@ void Ui::ShowStatsWindow()
         if (ImGui::Checkbox("Async loading", &asyncLoading))
             app->resourceManager.SetAsyncLoading(asyncLoading);
 
+        // Vertex compression toggle, used by the meshes loaded afterwards.
+        static bool vertexCompression = SubMesh::VertexCompression();
+        if (ImGui::Checkbox("Compact vertices", &vertexCompression))
+            SubMesh::SetVertexCompression(vertexCompression);
+
+        // Geometry kept in RAM by the meshes sent to OpenGL afterwards.
+        static int geometryRetention = (int)SubMesh::GetGeometryRetention();
+        const char* retentionNames[3] = { SubMesh::GetGeometryRetentionName(GeometryRetention::Bounds), SubMesh::GetGeometryRetentionName(GeometryRetention::Positions), SubMesh::GetGeometryRetentionName(GeometryRetention::Full) };
+        ImGui::AlignTextToFramePadding(); ImGui::Text("CPU geometry:"); ImGui::SameLine();
+        ImGui::SetNextItemWidth(90);
+        if (ImGui::Combo("##geometryRetention", &geometryRetention, retentionNames, 3))
+            SubMesh::SetGeometryRetention((GeometryRetention)geometryRetention);
+
+        // Texture block compression toggle, used by the textures loaded afterwards (disabled without S3TC support).
+        const bool s3tcUnsupported = !GLAD_GL_EXT_texture_compression_s3tc;
+        bool textureCompression = Texture::CompressionEnabled();
+        if (s3tcUnsupported) ImGui::BeginDisabled();
+        if (ImGui::Checkbox("Compress textures", &textureCompression) && !s3tcUnsupported)
+            Texture::SetCompressionEnabled(textureCompression);
+        if (s3tcUnsupported) ImGui::EndDisabled();
+
+        // Vertex cache and overdraw optimization toggle, used by the meshes loaded afterwards.
+        static bool indexOptimization = SubMesh::IndexOptimization();
+        if (ImGui::Checkbox("Optimize mesh indices", &indexOptimization))
+            SubMesh::SetIndexOptimization(indexOptimization);
+
+        // Level of detail generation toggle, used by the meshes loaded afterwards.
+        static bool lodGeneration = SubMesh::LodGeneration();
+        if (ImGui::Checkbox("Generate mesh LODs", &lodGeneration))
+            SubMesh::SetLodGeneration(lodGeneration);
+
+        // Level of detail selection and the triangles it saves this frame.
+        ImGui::Checkbox("Use LODs", &SceneModel::useLods);
+        ImGui::AlignTextToFramePadding(); ImGui::Text("LOD pixel error:"); ImGui::SameLine();
+        ImGui::SetNextItemWidth(55);
+        ImGui::DragFloat("##lodPixelError", &SceneModel::lodPixelError, 0.05f, 0.1f, 32.f, "%.1f");
+        const size_t savedTriangles = SceneModel::fullDetailTriangleCount - SceneModel::drawnTriangleCount - SceneModel::culledTriangleCount;
+        ImGui::TextWrapped("Triangles: %zu (%zu saved by LODs, %d%%)", SceneModel::drawnTriangleCount, savedTriangles,
+                           SceneModel::fullDetailTriangleCount > 0 ? (int)(savedTriangles * 100 / SceneModel::fullDetailTriangleCount) : 0);
+
+        // Meshlet culling toggle and the triangles it skips this frame.
+        ImGui::Checkbox("Cull meshlets", &SceneModel::useMeshletCulling);
+        ImGui::TextWrapped("Culled triangles: %zu (%d%%)", SceneModel::culledTriangleCount,
+                           SceneModel::fullDetailTriangleCount > 0 ? (int)(SceneModel::culledTriangleCount * 100 / SceneModel::fullDetailTriangleCount) : 0);
+
         // Reload Resources
         ImGui::AlignTextToFramePadding();
         if (ImGui::Button("Reload Resources")) {
@@ -918,6 +1142,53 @@ void Ui::ShowStatsWindow()
             ImGui::SliderInt("##benchmartIterations", &app->maxLoad, 2, 20);
         }
 
+        // Draw time with and without index optimization, the meshes are reloaded for each of them.
+        if (!app->IsInRenderBenchmark()) {
+            if (ImGui::Button("Benchmark rendering"))
+                app->StartRenderBenchmark();
+        }
+        else {
+            ImGui::Text("Benchmarking rendering...");
+        }
+
+        // The next benchmarks run on the app's benchmark thread to keep rendering, one at a time.
+        const bool benchmarkRunning = app->IsBenchmarkTaskRunning();
+        if (benchmarkRunning) ImGui::BeginDisabled();
+
+        // Job system scaling benchmark.
+        if (ImGui::Button("Benchmark Jobs"))
+            app->StartBenchmarkTask(Core::JobSystem::Benchmark);
+
+        // Tangent generation with the scalar and SIMD paths.
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark tangents"))
+            app->StartBenchmarkTask([&resourceManager]() { TangentSpace::Benchmark(resourceManager.threadManager.GetJobSystem()); });
+
+        // Texture compression time and size on the loaded textures.
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark textures"))
+        {
+            std::vector<std::string> textureFiles;
+            resourceManager.ForEachResource([&textureFiles](const std::string& name, IResource* resource) {
+                if (resource->GetType() == ResourceTypes::Texture && resource->IsLoaded())
+                    textureFiles.push_back(name);
+            });
+            app->StartBenchmarkTask([&resourceManager, textureFiles]() { TextureCompressor::Benchmark(textureFiles, resourceManager.threadManager.GetJobSystem()); });
+        }
+
+        // Obj parser throughput on the loaded obj files.
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark OBJ parser"))
+        {
+            std::vector<std::string> objFiles;
+            resourceManager.ForEachResource([&objFiles](const std::string& name, IResource* resource) {
+                if (resource->GetType() == ResourceTypes::ObjFile && resource->IsLoaded())
+                    objFiles.push_back(name);
+            });
+            app->StartBenchmarkTask([&resourceManager, objFiles]() { ObjFile::Benchmark(resourceManager, objFiles, 5); });
+        }
+        if (benchmarkRunning) ImGui::EndDisabled();
+
         ImGui::AlignTextToFramePadding();
     }
     ImGui::End();
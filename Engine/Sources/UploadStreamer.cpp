@@ -0,0 +1,100 @@
+#include <glad/glad.h>
+#include <cstring>
+#include <algorithm>
+
+#include "Debug.h"
+#include "UploadStreamer.h"
+using namespace Resources;
+
+
+UploadStreamer::UploadStreamer(const size_t& stagingSize)
+{
+    segmentSize = (stagingSize / FramesInFlight) & ~(Alignment - 1);
+
+    // Create a staging buffer that stays mapped for its whole lifetime.
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, segmentSize * FramesInFlight, nullptr, flags);
+    mappedData = (unsigned char*)glMapNamedBufferRange(buffer, 0, segmentSize * FramesInFlight, flags);
+    if (mappedData == nullptr)
+        DebugLogError("Unable to map the upload staging buffer.");
+
+    throughputStart = std::chrono::steady_clock::now();
+}
+
+UploadStreamer::~UploadStreamer()
+{
+    for (void*& fence : segmentFences)
+        if (fence != nullptr)
+            glDeleteSync((GLsync)fence);
+    if (mappedData != nullptr)
+        glUnmapNamedBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+}
+
+void UploadStreamer::BeginFrame()
+{
+    frameStart    = std::chrono::steady_clock::now();
+    uploadedBytes = 0;
+    segmentOffset = 0;
+
+    // Move to the next segment, which can only be written to once the GPU has read its previous contents.
+    segment = (segment + 1) % FramesInFlight;
+    segmentAvailable = (mappedData != nullptr);
+    if (segmentFences[segment] != nullptr)
+    {
+        GLenum status = glClientWaitSync((GLsync)segmentFences[segment], 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glDeleteSync((GLsync)segmentFences[segment]);
+            segmentFences[segment] = nullptr;
+        }
+        else {
+            segmentAvailable = false;
+        }
+    }
+}
+
+void UploadStreamer::EndFrame()
+{
+    // Protect the segment until the GPU is done with the uploads that read from it.
+    if (segmentOffset > 0)
+        segmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    lastFrameTime = std::chrono::duration<float, std::milli>(now - frameStart).count();
+    if (uploadedBytes > 0 && lastFrameTime > timeBudget)
+        hitchCount++;
+
+    // Update the throughput every second.
+    totalUploadedBytes += uploadedBytes;
+    throughputBytes    += uploadedBytes;
+    float elapsed = std::chrono::duration<float>(now - throughputStart).count();
+    if (elapsed >= 1.f) {
+        throughput      = (float)throughputBytes / elapsed / (1 << 20);
+        throughputBytes = 0;
+        throughputStart = now;
+    }
+}
+
+bool UploadStreamer::HasTimeLeft() const
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count() < timeBudget;
+}
+
+size_t UploadStreamer::GetAvailableBytes() const
+{
+    if (!segmentAvailable || uploadedBytes >= byteBudget || !HasTimeLeft())
+        return 0;
+    return std::min(byteBudget - uploadedBytes, segmentSize - segmentOffset);
+}
+
+size_t UploadStreamer::Stage(const void* data, const size_t& size)
+{
+    size_t offset = (size_t)segment * segmentSize + segmentOffset;
+    memcpy(mappedData + offset, data, size);
+
+    // Keep the next offset aligned for texture and buffer copies.
+    segmentOffset  = std::min(segmentSize, (segmentOffset + size + Alignment - 1) & ~(Alignment - 1));
+    uploadedBytes += size;
+    return offset;
+}